@@ -0,0 +1,82 @@
+#include "../common/fill_archive.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace trading_api;
+
+///Measures size and scan speed of FillArchive
+/**
+ * Usage: fill_archive [fills]
+ *
+ * Fills emulate trading of few instruments - decimal prices and amounts,
+ * numeric increasing ids, milliseconds timestamps
+ */
+
+template<typename Fn>
+static double measure(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1?std::strtoul(argv[1], nullptr, 10):1000000;
+    const char *labels[] = {"btcusdt.grid", "ethusdt.grid", "solusdt.mm", "btcusdt.hedge"};
+    std::mt19937 rnd(1);
+    Fills fills;
+    fills.reserve(count);
+    auto t = Timestamp(std::chrono::seconds(1700000000));
+    double price = 30000;
+    std::uint64_t id = 3000000000000ULL;
+    for (std::size_t i = 0; i < count; ++i) {
+        Fill f;
+        t += std::chrono::milliseconds(rnd() % 2000);
+        f.time = t;
+        id += 1 + rnd() % 5;
+        f.id = std::to_string(id);
+        f.label = labels[rnd() % 4];
+        price += static_cast<double>(static_cast<int>(rnd() % 21) - 10) / 10.0;
+        f.price = std::round(price * 10) / 10;
+        f.amount = static_cast<double>(1 + rnd() % 500) / 1000.0;
+        f.fees = std::round(f.amount * f.price * 0.0002 * 1e8) / 1e8;
+        fills.push_back(std::move(f));
+    }
+    std::size_t mem = fills.capacity() * sizeof(Fill);
+    for (const Fill &f: fills) {
+        //strings longer than small string buffer are allocated
+        if (f.id.size() > 15) mem += f.id.capacity() + 1;
+        if (f.label.size() > 15) mem += f.label.capacity() + 1;
+    }
+
+    FillArchive ar;
+    double write_time = measure([&]{
+        FillArchiveWriter wr;
+        for (const Fill &f: fills) wr.append(f);
+        ar = FillArchive(wr.finish());
+    });
+    std::printf("fills: %zu\n", count);
+    std::printf("memory: %12zu bytes %8.2f bytes/fill\n", mem, static_cast<double>(mem) / static_cast<double>(count));
+    std::printf("archive: %11zu bytes %8.2f bytes/fill (%.1fx smaller)\n", ar.get_data_size(),
+            static_cast<double>(ar.get_data_size()) / static_cast<double>(count),
+            static_cast<double>(mem) / static_cast<double>(ar.get_data_size()));
+    std::printf("write: %10.1f ns/fill\n", write_time * 1e9 / static_cast<double>(count));
+
+    double volume = 0;
+    double scan_time = measure([&]{
+        Function<void(const FillArchive::Columns &)> fn = [&](const FillArchive::Columns &c) {
+            for (std::size_t i = 0; i < c.size(); ++i) volume += c.price[i] * c.amount[i];
+        };
+        ar.scan(Timestamp::min(), fn);
+    });
+    std::printf("column scan: %4.1f ns/fill (volume %.0f)\n", scan_time * 1e9 / static_cast<double>(count), volume);
+
+    std::size_t found = 0;
+    double load_time = measure([&]{
+        found = ar.load_fills(Timestamp::min(), "solusdt").size();
+    });
+    std::printf("load_fills: %5.1f ns/fill (%zu fills)\n", load_time * 1e9 / static_cast<double>(count), found);
+    return 0;
+}
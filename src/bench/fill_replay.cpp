@@ -0,0 +1,87 @@
+#include "../common/wal_storage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace trading_api;
+
+///Measures duplicate fill detection during reconnect replay
+/**
+ * Usage: fill_replay [fills]
+ *
+ * Storage contains given count of fills, then the exchange replays all of them
+ * (as after reconnect), every fill is checked by is_duplicate_fill(). Linear
+ * search (the previous implementation) is measured on the newest 5000 fills only,
+ * because it is quadratic
+ */
+
+static Fill make_fill(std::size_t i) {
+    Fill f = {};
+    f.time = Timestamp(std::chrono::seconds(1700000000) + std::chrono::milliseconds(i * 100));
+    f.id = "T" + std::to_string(1000000000 + i);
+    f.label = "bench";
+    f.price = 100;
+    f.amount = 1;
+    return f;
+}
+
+static bool linear_search(const Fills &fills, const Fill &fill) {
+    auto iter = fills.rbegin();
+    auto end = fills.rend();
+    while (iter != end && iter->time >= fill.time) {
+        if (*iter == fill) return true;
+        ++iter;
+    }
+    return false;
+}
+
+template<typename Fn>
+static void run(const char *name, std::size_t first, std::size_t fills, Fn &&is_duplicate) {
+    std::size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = first; i < first + fills; ++i) {
+        found += is_duplicate(make_fill(i));
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-14s %8zu fills %12.0f ns/fill %8zu found\n", name, fills,
+            secs * 1e9 / static_cast<double>(fills), found);
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t fills = argc > 1?std::strtoul(argv[1], nullptr, 10):100000;
+    std::size_t linear_fills = std::min<std::size_t>(fills, 5000);
+
+    MemoryStorage mem;
+    Fills copy;
+    for (std::size_t i = 0; i < fills; ++i) {
+        Fill f = make_fill(i);
+        mem.put_fill(f);
+        copy.push_back(std::move(f));
+    }
+    run("memory", 0, fills, [&](const Fill &f) {return mem.is_duplicate_fill(f);});
+
+    auto pathname = (std::filesystem::temp_directory_path() / "fill_replay.log").string();
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+    {
+        WalStorage wal(pathname);
+        wal.begin_transaction();
+        for (const Fill &f: copy) wal.put_fill(f);
+        wal.commit();
+    }
+    {
+        WalStorage wal(pathname);
+        run("wal_reopened", 0, fills, [&](const Fill &f) {return wal.is_duplicate_fill(f);});
+    }
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+
+    //replay of the newest fills is the best case of linear search
+    run("linear_search", fills - linear_fills, linear_fills, [&](const Fill &f) {
+        return linear_search(copy, f);
+    });
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "../common/async_log.h"
+#include "../common/latency_histogram.h"
+#include "../common/tsc_clock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace trading_api;
+
+///Measures cost of Log::output on the calling thread
+/**
+ * Usage: log_latency [count] [burst]
+ *
+ * Every call writes log line with context and few arguments (integer,
+ * double, string). Compares synchronous formatting and output with
+ * AsyncLog, where the calling thread only copies arguments to the ring buffer.
+ * Lines are written to /dev/null
+ *
+ * Lines are written in bursts (as a strategy writes few lines per event),
+ * the background thread is flushed between bursts (not measured)
+ */
+
+class FileLog: public ILog {
+public:
+    FileLog():_f(std::fopen("/dev/null", "w")) {}
+    ~FileLog() {std::fclose(_f);}
+    virtual void output(Serverity, std::string_view msg) override {
+        std::fwrite(msg.data(), 1, msg.size(), _f);
+        std::fputc('\n', _f);
+    }
+    virtual Serverity get_min_level() const override {return Serverity::debug;}
+protected:
+    std::FILE *_f;
+};
+
+static void run(const char *name, const TscClock &clk, std::size_t count, std::size_t burst,
+                Log log, AsyncLog *async) {
+    LatencyHistogram hist;
+    std::string symbol = "BTCUSDT";
+    for (std::size_t i = 0; i < count; ++i) {
+        auto start = TscClock::now();
+        log.output(Log::Serverity::info, "order {} placed: {} price={} amount={}",
+                i, symbol, 100.25 + static_cast<double>(i & 0xFF), 0.5);
+        hist.record(TscClock::now() - start);
+        if (async && (i + 1) % burst == 0) async->flush();
+    }
+    auto ns = [&](std::uint64_t ticks) {return clk.to_ns(ticks);};
+    std::printf("%-8s mean %8.1f ns  p50 %8.1f ns  p99 %8.1f ns  p99.9 %8.1f ns  max %10.1f ns\n", name,
+            clk.to_ns(static_cast<std::uint64_t>(hist.mean())), ns(hist.percentile(50)),
+            ns(hist.percentile(99)), ns(hist.percentile(99.9)), ns(hist.max()));
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1?std::strtoul(argv[1], nullptr, 10):1000000;
+    std::size_t burst = std::max<std::size_t>(argc > 2?std::strtoul(argv[2], nullptr, 10):1000, 1);
+    auto clk = TscClock::calibrate();
+    std::printf("calls: %zu, burst: %zu\n", count, burst);
+
+    run("sync", clk, count, burst, Log(Log(std::make_shared<FileLog>()), "strategy"), nullptr);
+
+    auto async = std::make_shared<AsyncLog>(std::make_shared<FileLog>());
+    run("async", clk, count, burst, Log(Log(async), "strategy"), async.get());
+    async->flush();
+    auto st = async->get_stats();
+    std::printf("async written: %llu, dropped: %llu\n",
+            static_cast<unsigned long long>(st.written), static_cast<unsigned long long>(st.dropped));
+}
@@ -0,0 +1,210 @@
+#include "loopback_exchange.h"
+
+#include "../common/basic_order.h"
+
+namespace trading_api {
+
+namespace {
+
+class LoopbackInstrument: public IInstrument {
+public:
+    LoopbackInstrument(std::string id, Exchange ex):_id(std::move(id)),_ex(std::move(ex)) {}
+    virtual const Config &get_config() const override {return _cfg;}
+    virtual std::string get_id() const override {return _id;}
+    virtual std::string get_label() const override {return _id;}
+    virtual std::string get_category() const override {return {};}
+    virtual Exchange get_exchange() const override {return _ex;}
+protected:
+    Config _cfg = {};
+    std::string _id;
+    Exchange _ex;
+};
+
+class LoopbackAccount: public IAccount::Null {
+public:
+    LoopbackAccount(std::string id, Exchange ex):_id(std::move(id)),_ex(std::move(ex)) {}
+    virtual std::string get_label() const override {return _id;}
+    virtual Exchange get_exchange() const override {return _ex;}
+    virtual std::string get_id() const override {return _id;}
+protected:
+    std::string _id;
+    Exchange _ex;
+};
+
+}
+
+void LoopbackExchange::inject(const Instrument &i, const Ticker &tk) {
+    std::uint64_t expected = 0;
+    //keep stamp of oldest unprocessed tick
+    _tick_stamp.compare_exchange_strong(expected, TscClock::now(), std::memory_order_release, std::memory_order_relaxed);
+    _ctx.income_data(i, tk);
+}
+
+void LoopbackExchange::mark_tick() {
+    auto now = TscClock::now();
+    auto stamp = _tick_stamp.exchange(0, std::memory_order_acquire);
+    std::lock_guard _(_mx);
+    if (!stamp) {
+        //no tick was injected since last mark, there is nothing to measure
+        _tick_processed = 0;
+        _strategy_stamp = 0;
+        return;
+    }
+    _tick_processed = stamp;
+    _strategy_stamp = now;
+    record(Stage::tick, _tick_processed, now);
+}
+
+void LoopbackExchange::mark_ack(const Order &order) {
+    auto now = TscClock::now();
+    std::lock_guard _(_mx);
+    auto iter = _pending_acks.find(order.get_handle().get());
+    if (iter == _pending_acks.end()) return;
+    record(Stage::ack, iter->second.second, now);
+    record(Stage::total, iter->second.first, now);
+    _pending_acks.erase(iter);
+}
+
+void LoopbackExchange::clear_stats() {
+    std::lock_guard _(_mx);
+    for (auto &s: _stats) s.clear();
+    _pending_acks.clear();
+}
+
+std::string_view LoopbackExchange::stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::tick: return "tick";
+        case Stage::strategy: return "strategy";
+        case Stage::ack: return "ack";
+        case Stage::place: return "place";
+        case Stage::total: return "total";
+        default: return "unknown";
+    }
+}
+
+void LoopbackExchange::record(Stage stage, std::uint64_t from, std::uint64_t to) {
+    if (from == 0 || to < from) return;
+    _stats[static_cast<int>(stage)].record(static_cast<std::uint64_t>(_clock.to_ns(to - from)));
+}
+
+void LoopbackExchange::init(ExchangeContext context, const StrategyConfig &) {
+    _ctx = std::move(context);
+}
+
+StrategyConfigSchema LoopbackExchange::get_config_schema() const {
+    return {};
+}
+
+void LoopbackExchange::subscribe(SubscriptionType , const Instrument &) {}
+void LoopbackExchange::unsubscribe(SubscriptionType , const Instrument &) {}
+
+void LoopbackExchange::update_account(const Account &a) {
+    _ctx.object_updated(a);
+}
+
+void LoopbackExchange::update_instrument(const Instrument &i) {
+    _ctx.object_updated(i);
+}
+
+void LoopbackExchange::batch_place(std::span<Order> orders) {
+    auto now = TscClock::now();
+    {
+        std::lock_guard _(_mx);
+        record(Stage::strategy, _strategy_stamp, now);
+        record(Stage::place, _tick_processed, now);
+        for (const auto &o: orders) {
+            //replaced order is canceled, it will never be acknowledged
+            const BasicOrder *bo = dynamic_cast<const BasicOrder *>(o.get_handle().get());
+            if (bo) _pending_acks.erase(bo->get_replaced_order().get_handle().get());
+            _pending_acks[o.get_handle().get()] = {_tick_processed, now};
+        }
+    }
+    for (const auto &o: orders) {
+        const BasicOrder *bo = dynamic_cast<const BasicOrder *>(o.get_handle().get());
+        if (bo) {
+            Order replaced = bo->get_replaced_order();
+            if (replaced) _ctx.order_state_changed(replaced, {Order::State::canceled, Order::Reason::no_reason, {}});
+        }
+        _ctx.order_state_changed(o, {Order::State::active, Order::Reason::no_reason, {}});
+    }
+}
+
+void LoopbackExchange::batch_cancel(std::span<Order> orders) {
+    {
+        std::lock_guard _(_mx);
+        for (const auto &o: orders) _pending_acks.erase(o.get_handle().get());
+    }
+    for (const auto &o: orders) {
+        _ctx.order_state_changed(o, {Order::State::canceled, Order::Reason::no_reason, {}});
+    }
+}
+
+void LoopbackExchange::create_accounts(std::vector<std::string> account_idents,
+        Function<void(std::vector<Account>)> cb) {
+    std::vector<Account> out;
+    {
+        std::lock_guard _(_mx);
+        for (auto &id: account_idents) {
+            auto iter = _accounts.find(id);
+            if (iter == _accounts.end()) {
+                Account a(std::make_shared<LoopbackAccount>(id, _ctx.get_exchange()));
+                iter = _accounts.emplace(id, a).first;
+            }
+            out.push_back(iter->second);
+        }
+    }
+    cb(std::move(out));
+}
+
+void LoopbackExchange::create_instruments(std::vector<std::string> instruments,
+        Account , Function<void(std::vector<Instrument>)> cb) {
+    std::vector<Instrument> out;
+    {
+        std::lock_guard _(_mx);
+        for (auto &id: instruments) {
+            auto iter = _instruments.find(id);
+            if (iter == _instruments.end()) {
+                Instrument i(std::make_shared<LoopbackInstrument>(id, _ctx.get_exchange()));
+                iter = _instruments.emplace(id, i).first;
+            }
+            out.push_back(iter->second);
+        }
+    }
+    cb(std::move(out));
+}
+
+std::string LoopbackExchange::get_name() const {
+    return "Loopback";
+}
+
+std::string LoopbackExchange::get_id() const {
+    return "loopback";
+}
+
+std::optional<IExchange::Icon> LoopbackExchange::get_icon() const {
+    return {};
+}
+
+Order LoopbackExchange::create_order(const Instrument &instrument,
+        const Account &account, const Order::Setup &setup) {
+    return Order(std::make_shared<BasicOrder>(instrument, account, setup, Order::Origin::strategy));
+}
+
+Order LoopbackExchange::create_order_replace(const Order &replace,
+        const Order::Setup &setup, bool amend) {
+    return Order(std::make_shared<BasicOrder>(replace, setup, amend, Order::Origin::strategy));
+}
+
+void LoopbackExchange::restore_orders(void *, std::span<SerializedOrder>) {}
+
+void LoopbackExchange::order_apply_report(const Order &order, const Order::Report &report) {
+    const BasicOrder &bsorder = dynamic_cast<const BasicOrder &>(*order.get_handle());
+    bsorder.get_status().update_report(report);
+}
+
+void LoopbackExchange::order_apply_fill(const Order &order, const Fill &fill) {
+    const BasicOrder &bsorder = dynamic_cast<const BasicOrder &>(*order.get_handle());
+    bsorder.get_status().add_fill(fill.price, fill.amount);
+}
+
+}
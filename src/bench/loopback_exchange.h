@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../trading_ifc/exchange_service.h"
+#include "../common/latency_histogram.h"
+#include "../common/tsc_clock.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace trading_api {
+
+///Exchange service which echoes orders back, used to measure tick-to-trade latency
+/**
+ * Ticks are injected by inject() and stamped by TSC clock. The strategy marks
+ * when it received the tick (mark_tick()) and when it received acknowledge of
+ * its order (mark_ack()). Placed orders are acknowledged (active) immediately
+ * in batch_place(), canceled orders are reported as canceled. Orders are
+ * never filled.
+ *
+ * If more ticks arrive before strategy processes them (market data are
+ * conflated), the latency is measured from the oldest unprocessed tick. If
+ * no tick arrived since last mark_tick(), nothing is measured. Orders which
+ * are canceled or replaced before mark_ack() are not measured
+ *
+ * Measured stages:
+ * @code
+ * inject() -> on_ticker() -> batch_place() -> on_order()
+ *         tick      strategy         ack
+ *         |------------- place ----------|
+ *         |--------------------- total ---------------|
+ * @endcode
+ */
+class LoopbackExchange: public IExchangeService {
+public:
+
+    enum class Stage {
+        ///from inject() to mark_tick()
+        tick,
+        ///from mark_tick() to batch_place()
+        strategy,
+        ///from batch_place() to mark_ack()
+        ack,
+        ///from inject() to batch_place()
+        place,
+        ///from inject() to mark_ack()
+        total
+    };
+
+    static constexpr unsigned int stage_count = 5;
+
+    LoopbackExchange(TscClock clock):_clock(clock) {}
+
+    ///Inject ticker
+    /**
+     * @param i instrument (created by this exchange)
+     * @param tk ticker
+     */
+    void inject(const Instrument &i, const Ticker &tk);
+
+    ///Called by strategy when it receives a ticker
+    void mark_tick();
+    ///Called by strategy when it receives report of an order
+    void mark_ack(const Order &order);
+
+    ///Retrieve latency histogram of given stage (values in nanoseconds)
+    /**
+     * @note must not be called while the benchmark is running
+     */
+    const LatencyHistogram &get_stats(Stage stage) const {
+        return _stats[static_cast<int>(stage)];
+    }
+
+    ///Clear statistics (e.g. after warm-up)
+    void clear_stats();
+
+    static std::string_view stage_name(Stage stage);
+
+    virtual void init(ExchangeContext context, const StrategyConfig &config) override;
+    virtual StrategyConfigSchema get_config_schema() const override;
+    virtual void subscribe(SubscriptionType type, const Instrument &i) override;
+    virtual void unsubscribe(SubscriptionType type, const Instrument &i) override;
+    virtual void update_account(const Account &a) override;
+    virtual void update_instrument(const Instrument &i) override;
+    virtual void batch_place(std::span<Order> orders) override;
+    virtual void batch_cancel(std::span<Order> orders) override;
+    virtual void create_accounts(std::vector<std::string> account_idents,
+            Function<void(std::vector<Account>)> cb) override;
+    virtual void create_instruments(std::vector<std::string> instruments,
+            Account account, Function<void(std::vector<Instrument>)> cb) override;
+    virtual std::string get_name() const override;
+    virtual std::string get_id() const override;
+    virtual std::optional<IExchange::Icon> get_icon() const override;
+    virtual Order create_order(const Instrument &instrument,
+            const Account &account, const Order::Setup &setup) override;
+    virtual Order create_order_replace(const Order &replace,
+            const Order::Setup &setup, bool amend) override;
+    virtual void restore_orders(void *context, std::span<SerializedOrder> orders) override;
+    virtual void order_apply_report(const Order &order, const Order::Report &report) override;
+    virtual void order_apply_fill(const Order &order, const Fill &fill) override;
+
+protected:
+    TscClock _clock;
+    ExchangeContext _ctx;
+    std::mutex _mx;
+    std::map<std::string, Instrument, std::less<> > _instruments;
+    std::map<std::string, Account, std::less<> > _accounts;
+
+    ///stamp of oldest unprocessed tick, zero if none
+    std::atomic<std::uint64_t> _tick_stamp = 0;
+    ///stamp of the tick which is being processed by the strategy
+    std::uint64_t _tick_processed = 0;
+    ///when strategy received the tick
+    std::uint64_t _strategy_stamp = 0;
+    ///orders waiting for acknowledge - stamp of tick and of placement
+    std::unordered_map<const IOrder *, std::pair<std::uint64_t, std::uint64_t> > _pending_acks;
+
+    LatencyHistogram _stats[stage_count];
+
+    void record(Stage stage, std::uint64_t from, std::uint64_t to);
+};
+
+}
@@ -0,0 +1,130 @@
+#include "loopback_exchange.h"
+
+#include "../common/basic_context.h"
+#include "../common/basic_exchange.h"
+#include "../common/context_scheduler.h"
+#include "../common/memory_storage.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using namespace trading_api;
+
+///Measures tick-to-trade latency through the full stack
+/**
+ * Usage: tick_to_trade [rate] [count] [warmup] [io]
+ *
+ * rate - ticks per second (0 - next tick is injected after previous one is acknowledged)
+ * count - count of measured ticks
+ * warmup - count of ticks injected before measurement starts
+ * io - if specified, the exchange uses dedicated I/O thread
+ *
+ * Every tick is received by a strategy, which replaces its order (or places
+ * new one). The loopback exchange acknowledges the order immediately.
+ */
+
+class NullLog: public ILog {
+public:
+    virtual void output(Serverity, std::string_view) override {}
+    virtual Serverity get_min_level() const override {return Serverity::fatal;}
+};
+
+class BenchStrategy: public AbstractStrategy {
+public:
+    BenchStrategy(LoopbackExchange *lb):_lb(lb) {}
+
+    virtual void on_init(const Context &ctx) override {
+        _ctx = ctx;
+        for (const auto &i: _ctx.get_instruments()) _ctx.subscribe(SubscriptionType::ticker, i);
+    }
+
+    virtual void on_ticker(Instrument i, Ticker tk) override {
+        _lb->mark_tick();
+        Order::Limit setup(Side::buy, 1.0, tk.bid);
+        if (_order && !_order.done()) _order = _ctx.replace(_order, setup, true);
+        else _order = _ctx.place(i, _ctx.get_accounts()[0], setup);
+    }
+
+    virtual void on_order(Order ord) override {
+        _lb->mark_ack(ord);
+        if (ord.get_state() == Order::State::active) ++_acks;
+    }
+
+    std::atomic<std::size_t> _acks = 0;
+
+protected:
+    LoopbackExchange *_lb;
+    Context _ctx;
+    Order _order;
+};
+
+int main(int argc, char *argv[]) {
+    double rate = argc > 1?std::strtod(argv[1], nullptr):100000.0;
+    std::size_t count = argc > 2?std::strtoul(argv[2], nullptr, 10):100000;
+    std::size_t warmup = argc > 3?std::strtoul(argv[3], nullptr, 10):10000;
+    bool use_io = argc > 4 && std::strcmp(argv[4], "io") == 0;
+
+    TscClock clock = TscClock::calibrate();
+
+    auto svc = std::make_unique<LoopbackExchange>(clock);
+    LoopbackExchange *lb = svc.get();
+    auto ectx = std::make_unique<BasicExchangeContext>();
+    ectx->init(std::move(svc), StrategyConfig{});
+    if (use_io) ectx->start_io_thread();
+    Exchange ex = BasicExchange::create(std::move(ectx), "loopback");
+
+    std::vector<Instrument> instruments;
+    std::vector<Account> accounts;
+    lb->create_instruments({"BENCH"}, {}, [&](std::vector<Instrument> r){instruments = std::move(r);});
+    lb->create_accounts({"BENCH"}, [&](std::vector<Account> r){accounts = std::move(r);});
+
+    auto scheduler = create_scheduler();
+    auto strategy = std::make_unique<BenchStrategy>(lb);
+    BenchStrategy *st = strategy.get();
+    {
+        BasicContext ctx(std::make_unique<MemoryStorage>(), scheduler,
+                Log(std::make_shared<NullLog>()), "bench");
+        ctx.init(std::move(strategy), accounts, instruments, {});
+
+        std::size_t total = count + warmup;
+        auto interval = rate > 0?std::chrono::duration<double>(1.0/rate):std::chrono::duration<double>(0);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t n = 0; n < total; ++n) {
+            if (n == warmup) lb->clear_stats();
+            if (rate > 0) {
+                auto next = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * static_cast<double>(n));
+                while (std::chrono::steady_clock::now() < next) {/*spin*/}
+            } else {
+                //closed loop: wait for ack of previous tick
+                while (st->_acks.load(std::memory_order_relaxed) < n) std::this_thread::yield();
+            }
+            double px = 100.0 + static_cast<double>(n % 100) * 0.01;
+            lb->inject(instruments[0], Ticker{px, 1.0, px + 0.01, 1.0, px, 1.0, 0.0});
+        }
+        //let pending events settle
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    std::printf("rate: %g/s, ticks: %zu, io thread: %s, tsc: %.3f ticks/ns\n",
+            rate, count, use_io?"yes":"no", clock.get_ticks_per_ns());
+    std::printf("%-10s %10s %10s %10s %10s %10s %10s %10s\n",
+            "stage", "count", "p50", "p90", "p99", "p99.9", "max", "mean");
+    for (unsigned int s = 0; s < LoopbackExchange::stage_count; ++s) {
+        auto stage = static_cast<LoopbackExchange::Stage>(s);
+        const LatencyHistogram &h = lb->get_stats(stage);
+        std::printf("%-10.*s %10llu %10llu %10llu %10llu %10llu %10llu %10.0f\n",
+                static_cast<int>(LoopbackExchange::stage_name(stage).size()),
+                LoopbackExchange::stage_name(stage).data(),
+                static_cast<unsigned long long>(h.count()),
+                static_cast<unsigned long long>(h.percentile(50)),
+                static_cast<unsigned long long>(h.percentile(90)),
+                static_cast<unsigned long long>(h.percentile(99)),
+                static_cast<unsigned long long>(h.percentile(99.9)),
+                static_cast<unsigned long long>(h.max()),
+                h.mean());
+    }
+    std::printf("(latencies in nanoseconds)\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "../common/wal_storage.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace trading_api;
+
+///Measures opening of WalStorage with and without snapshot
+/**
+ * Usage: wal_restart [transactions]
+ *
+ * Every transaction updates two of 1000 variables, every tenth transaction
+ * stores a fill. Snapshot is written at the end. The storage is opened with
+ * the snapshot, then the snapshot is removed and the whole log is replayed
+ */
+
+static double open_storage(const std::string &pathname, const char *name) {
+    auto start = std::chrono::steady_clock::now();
+    WalStorage st(pathname);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto stats = st.get_stats();
+    std::printf("%-14s %10.3f s %12llu transactions %12llu from snapshot\n", name, secs,
+            static_cast<unsigned long long>(stats.recovered),
+            static_cast<unsigned long long>(stats.from_snapshot));
+    return secs;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t transactions = argc > 1?std::strtoul(argv[1], nullptr, 10):1000000;
+    auto pathname = (std::filesystem::temp_directory_path() / "wal_restart.log").string();
+    auto remove_all = [&]{
+        for (const char *ext: {"", ".idx", ".snap"}) std::filesystem::remove(pathname + ext);
+    };
+    remove_all();
+    {
+        WalStorage st(pathname);
+        std::string value(24, 'x');
+        Fill f = {};
+        f.label = "bench";
+        f.price = 100;
+        f.amount = 1;
+        for (std::size_t i = 0; i < transactions; ++i) {
+            st.begin_transaction();
+            st.put_var("state.level." + std::to_string(i % 1000), value);
+            st.put_var("state.position", std::to_string(i));
+            if (i % 10 == 0) {
+                f.time = Timestamp(std::chrono::milliseconds(i));
+                f.id = std::to_string(i);
+                st.put_fill(f);
+            }
+            st.commit();
+        }
+        st.snapshot();
+    }
+    std::printf("log: %llu bytes, snapshot: %llu bytes\n",
+            static_cast<unsigned long long>(std::filesystem::file_size(pathname)),
+            static_cast<unsigned long long>(std::filesystem::file_size(pathname + ".snap")));
+    open_storage(pathname, "snapshot");
+    std::filesystem::remove(pathname + ".snap");
+    open_storage(pathname, "full_replay");
+    remove_all();
+    return 0;
+}
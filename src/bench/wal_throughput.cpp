@@ -0,0 +1,72 @@
+#include "../common/wal_storage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace trading_api;
+
+///Measures throughput of WalStorage commits
+/**
+ * Usage: wal_throughput [transactions] [writes_per_transaction]
+ *
+ * Every transaction emulates single dispatch round of a strategy - few
+ * variables and one fill. Compares memory storage, log with group commit
+ * and log with synchronous commit (fsync per transaction)
+ */
+
+template<typename Fn>
+static void run(const char *name, std::size_t transactions, Fn &&factory) {
+    auto pathname = (std::filesystem::temp_directory_path() / "wal_throughput.log").string();
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+    auto [st, writes] = factory(pathname);
+    std::string value(32, 'x');
+    Fill f = {};
+    f.label = "bench";
+    f.price = 100;
+    f.amount = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < transactions; ++i) {
+        st->begin_transaction();
+        for (std::size_t w = 0; w < writes; ++w) {
+            st->put_var("var" + std::to_string(w), value);
+        }
+        f.time = Timestamp(std::chrono::microseconds(i));
+        f.id = std::to_string(i);
+        st->put_fill(f);
+        st->commit();
+    }
+    WalStorage *wal = dynamic_cast<WalStorage *>(st.get());
+    if (wal) wal->flush();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-14s %12.0f tx/s %10.2f us/tx %10llu syncs\n", name,
+            static_cast<double>(transactions)/secs, secs * 1e6 / static_cast<double>(transactions),
+            static_cast<unsigned long long>(wal?wal->get_stats().syncs:0));
+    st.reset();
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t transactions = argc > 1?std::strtoul(argv[1], nullptr, 10):100000;
+    std::size_t writes = argc > 2?std::strtoul(argv[2], nullptr, 10):4;
+    //synchronous commit is much slower, use less transactions
+    std::size_t sync_transactions = std::max<std::size_t>(transactions / 100, 100);
+
+    std::printf("transactions: %zu, writes per transaction: %zu\n", transactions, writes);
+    run("memory", transactions, [&](const std::string &) {
+        return std::pair<std::unique_ptr<IStorage>, std::size_t>(std::make_unique<MemoryStorage>(), writes);
+    });
+    run("group_commit", transactions, [&](const std::string &path) {
+        return std::pair<std::unique_ptr<IStorage>, std::size_t>(std::make_unique<WalStorage>(path), writes);
+    });
+    run("sync_commit", sync_transactions, [&](const std::string &path) {
+        WalStorage::Config cfg;
+        cfg.sync_commit = true;
+        return std::pair<std::unique_ptr<IStorage>, std::size_t>(std::make_unique<WalStorage>(path, cfg), writes);
+    });
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "async_log.h"
+
+#include <algorithm>
+#include <bit>
+#include <string>
+
+namespace trading_api {
+
+static std::atomic<std::uint64_t> async_log_id_counter = 0;
+
+AsyncLog::Ring::Ring(std::size_t size)
+    :_size(std::bit_ceil(std::max<std::size_t>(size, 256)))
+    ,_mask(_size-1)
+{
+    _data = std::make_unique<std::uint64_t[]>(_size / sizeof(std::uint64_t));
+}
+
+char *AsyncLog::Ring::reserve(std::size_t size) {
+    std::size_t total = sizeof(std::uint64_t) + ((size + 7) & ~std::size_t(7));
+    if (total > _size / 2) return nullptr;
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    std::size_t pos = tail & _mask;
+    std::size_t contiguous = _size - pos;
+    //record doesn't fit to the end of the buffer, skip the rest
+    std::size_t skip = contiguous < total?contiguous:0;
+    if (tail + skip + total - _head_cache > _size) {
+        _head_cache = _head.load(std::memory_order_acquire);
+        if (tail + skip + total - _head_cache > _size) return nullptr;
+    }
+    char *bytes = reinterpret_cast<char *>(_data.get());
+    if (skip) {
+        std::uint64_t pad = skip | padding_flag;
+        std::memcpy(bytes + pos, &pad, sizeof(pad));
+        tail += skip;
+        pos = 0;
+    }
+    std::uint64_t len = total;
+    std::memcpy(bytes + pos, &len, sizeof(len));
+    _reserved = tail + total;
+    return bytes + pos + sizeof(len);
+}
+
+template<typename Fn>
+std::size_t AsyncLog::Ring::consume(Fn &&fn) {
+    const char *bytes = reinterpret_cast<const char *>(_data.get());
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    std::size_t count = 0;
+    while (head != tail) {
+        std::size_t pos = head & _mask;
+        std::uint64_t len;
+        std::memcpy(&len, bytes + pos, sizeof(len));
+        if (len & padding_flag) {
+            head += len & ~padding_flag;
+        } else {
+            fn(bytes + pos + sizeof(len));
+            head += len;
+            ++count;
+        }
+        _head.store(head, std::memory_order_release);
+    }
+    return count;
+}
+
+AsyncLog::AsyncLog(std::shared_ptr<ILog> target, Config cfg)
+    :_target(std::move(target))
+    ,_cfg(cfg)
+    ,_id(++async_log_id_counter)
+    ,_thread([this]{worker();}) {}
+
+AsyncLog::~AsyncLog() {
+    {
+        std::lock_guard _(_mx);
+        _stop = true;
+    }
+    _cond.notify_all();
+    _thread.join();
+}
+
+AsyncLog::Ring &AsyncLog::get_ring() {
+    struct Slot {
+        std::uint64_t id;
+        std::shared_ptr<Ring> ring;
+    };
+    struct Slots {
+        std::vector<Slot> slots;
+        ///last used slot
+        std::uint64_t last_id = 0;
+        Ring *last = nullptr;
+        ~Slots() {
+            for (const auto &s: slots) s.ring->closed.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Slots tls;
+
+    if (tls.last_id == _id) return *tls.last;
+    auto iter = std::find_if(tls.slots.begin(), tls.slots.end(), [&](const Slot &s){return s.id == _id;});
+    if (iter == tls.slots.end()) {
+        //forget rings of destroyed logs
+        std::erase_if(tls.slots, [](const Slot &s){return s.ring.use_count() == 1;});
+        auto ring = std::make_shared<Ring>(_cfg.ring_size);
+        {
+            std::lock_guard _(_mx);
+            _rings.push_back(ring);
+        }
+        tls.slots.push_back({_id, std::move(ring)});
+        iter = tls.slots.end() - 1;
+    }
+    tls.last_id = _id;
+    tls.last = iter->ring.get();
+    return *tls.last;
+}
+
+char *AsyncLog::reserve(std::size_t size) {
+    char *ptr = get_ring().reserve(size);
+    if (!ptr) _dropped.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+void AsyncLog::commit() {
+    get_ring().commit();
+}
+
+void AsyncLog::format_text(std::string_view text, const char *, std::vector<char> &out) {
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+void AsyncLog::output(Serverity level, std::string_view msg) {
+    char *ptr = reserve(sizeof(Header) + msg.size());
+    if (!ptr) return;
+    Header hdr{&format_text, nullptr, static_cast<std::uint32_t>(msg.size()), 0, level};
+    std::memcpy(ptr, &hdr, sizeof(hdr));
+    std::memcpy(ptr + sizeof(hdr), msg.data(), msg.size());
+    commit();
+}
+
+ILog::Serverity AsyncLog::get_min_level() const {
+    return _target->get_min_level();
+}
+
+void AsyncLog::flush() {
+    std::unique_lock lk(_mx);
+    auto req = ++_flush_req;
+    _cond.notify_all();
+    _cond.wait(lk, [&]{return _flush_done >= req;});
+}
+
+AsyncLog::Stats AsyncLog::get_stats() const {
+    return {
+        _written.load(std::memory_order_relaxed),
+        _dropped.load(std::memory_order_relaxed)
+    };
+}
+
+void AsyncLog::worker() {
+    std::vector<char> buffer;
+    std::unique_lock lk(_mx);
+    while (true) {
+        //the pass processes all records written before the request
+        auto req = _flush_req;
+        bool stop = _stop;
+        lk.unlock();
+        bool any = process(buffer);
+        lk.lock();
+        _flush_done = req;
+        _cond.notify_all();
+        if (stop) break;
+        if (!any) _cond.wait_for(lk, _cfg.poll_interval, [&]{return _stop || _flush_req != req;});
+    }
+}
+
+bool AsyncLog::process(std::vector<char> &buffer) {
+    {
+        std::lock_guard _(_mx);
+        //closed ring can't receive new records
+        std::erase_if(_rings, [](const auto &r){
+            return r->closed.load(std::memory_order_acquire) && r->empty();
+        });
+        _active = _rings;
+    }
+    std::size_t count = 0;
+    for (const auto &r: _active) {
+        count += r->consume([&](const char *rec){
+            try {
+                format_record(rec, buffer);
+            } catch (...) {
+                //error in formatting or in the target - record is lost
+            }
+        });
+    }
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reported_dropped) {
+        try {
+            _target->output(Serverity::warning, "AsyncLog: "
+                    + std::to_string(dropped - _reported_dropped) + " record(s) dropped, buffer is full");
+        } catch (...) {
+
+        }
+        _reported_dropped = dropped;
+    }
+    return count != 0;
+}
+
+void AsyncLog::format_record(const char *rec, std::vector<char> &buffer) {
+    Header hdr;
+    std::memcpy(&hdr, rec, sizeof(hdr));
+    const char *ptr = rec + sizeof(hdr);
+    buffer.assign(ptr, ptr + hdr.context_size);
+    ptr += hdr.context_size;
+    std::string_view pattern;
+    if (hdr.pattern) {
+        pattern = {hdr.pattern, hdr.pattern_size};
+    } else {
+        pattern = {ptr, hdr.pattern_size};
+        ptr += hdr.pattern_size;
+    }
+    hdr.format(pattern, ptr, buffer);
+    _target->output(hdr.level, {buffer.data(), buffer.size()});
+    _written.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
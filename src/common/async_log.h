@@ -0,0 +1,158 @@
+#pragma once
+
+#include "../trading_ifc/log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace trading_api {
+
+///Log which formats and outputs messages in a background thread
+/**
+ * Wraps other log (target). Log::output called on this log doesn't format
+ * the message, it only copies pattern (pointer to the string literal), context
+ * and arguments to a record (see ILog::Deferred). Every producing thread has
+ * its own lock-free ring buffer, so writing of the record is a few memory
+ * copies without locking and without a system call.
+ *
+ * The background thread periodically collects records from all rings,
+ * formats them and passes them to the target in order of each thread (order
+ * between threads is not preserved).
+ *
+ * When the ring of the thread is full, the record is dropped. Count of dropped
+ * records is reported to the target as a warning.
+ *
+ * @code
+ * Log log(std::make_shared<AsyncLog>(std::make_shared<FileLog>(...)));
+ * log.output(Log::Serverity::info, "order {} placed at {}", id, price);
+ * @endcode
+ *
+ * @note Log line appears in the target with delay up to poll_interval. Use
+ * flush() to wait for output
+ */
+class AsyncLog: public ILog, public ILog::Deferred {
+public:
+
+    struct Config {
+        ///size of the ring buffer of each thread in bytes (rounded up to power of two)
+        std::size_t ring_size = 1 << 20;
+        ///how often the background thread checks rings for new records
+        std::chrono::microseconds poll_interval = std::chrono::milliseconds(1);
+    };
+
+    struct Stats {
+        ///records passed to target
+        std::uint64_t written = 0;
+        ///records dropped because ring was full
+        std::uint64_t dropped = 0;
+    };
+
+    AsyncLog(std::shared_ptr<ILog> target, Config cfg);
+    explicit AsyncLog(std::shared_ptr<ILog> target):AsyncLog(std::move(target), Config{}) {}
+    AsyncLog(const AsyncLog &) = delete;
+    AsyncLog &operator=(const AsyncLog &) = delete;
+    ///Outputs pending records and stops background thread
+    ~AsyncLog();
+
+    ///Output formatted message (message is copied to the ring)
+    virtual void output(Serverity level, std::string_view msg) override;
+    virtual Serverity get_min_level() const override;
+    virtual ILog::Deferred *get_deferred() override {return this;}
+
+    virtual char *reserve(std::size_t size) override;
+    virtual void commit() override;
+
+    ///Wait until records written before this call are passed to the target
+    void flush();
+
+    Stats get_stats() const;
+
+protected:
+
+    ///Byte ring buffer, single producer, single consumer
+    /**
+     * Every record is prefixed by its size and aligned to 8 bytes. Records
+     * are not split, space at the end of the buffer which is too small for
+     * the record is skipped (marked by padding flag)
+     */
+    class Ring {
+    public:
+        explicit Ring(std::size_t size);
+
+        ///reserve space for record (producer)
+        char *reserve(std::size_t size);
+        ///publish reserved record (producer)
+        void commit() {_tail.store(_reserved, std::memory_order_release);}
+        ///process available records (consumer)
+        /**
+         * @param fn function called for every record
+         * @return count of processed records
+         */
+        template<typename Fn>
+        std::size_t consume(Fn &&fn);
+
+        bool empty() const {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+        }
+
+        ///producing thread exited
+        std::atomic<bool> closed = false;
+
+    protected:
+        static constexpr std::uint64_t padding_flag = std::uint64_t(1) << 63;
+
+        std::unique_ptr<std::uint64_t[]> _data;
+        std::size_t _size;
+        std::size_t _mask;
+        ///read position, written by consumer
+        alignas(64) std::atomic<std::size_t> _head = 0;
+        ///write position, written by producer
+        alignas(64) std::atomic<std::size_t> _tail = 0;
+        ///producer's copy of _head
+        std::size_t _head_cache = 0;
+        ///position after reserved record
+        std::size_t _reserved = 0;
+    };
+
+    std::shared_ptr<ILog> _target;
+    Config _cfg;
+    ///unique id of this object (identifies rings of this object in threads)
+    std::uint64_t _id;
+
+    ///guards _rings, _flush_req, _flush_done, _stop
+    mutable std::mutex _mx;
+    std::condition_variable _cond;
+    std::vector<std::shared_ptr<Ring> > _rings;
+    std::uint64_t _flush_req = 0;
+    std::uint64_t _flush_done = 0;
+    bool _stop = false;
+
+    std::atomic<std::uint64_t> _written = 0;
+    std::atomic<std::uint64_t> _dropped = 0;
+    ///count of dropped records reported to the target
+    std::uint64_t _reported_dropped = 0;
+
+    ///rings processed by the background thread (copy of _rings)
+    std::vector<std::shared_ptr<Ring> > _active;
+    std::thread _thread;
+
+    ///ring of current thread (created on first use)
+    Ring &get_ring();
+    void worker();
+    ///process all rings
+    /**
+     * @retval true some records was processed
+     */
+    bool process(std::vector<char> &buffer);
+    void format_record(const char *rec, std::vector<char> &buffer);
+    ///format function of the record created by output()
+    static void format_text(std::string_view text, const char *args, std::vector<char> &out);
+};
+
+}
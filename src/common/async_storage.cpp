@@ -0,0 +1,305 @@
+#include "async_storage.h"
+
+#include <algorithm>
+#include <map>
+
+namespace trading_api {
+
+namespace {
+
+///snapshot of order passed to the backend
+class OrderSnapshot: public IOrder::Null {
+public:
+    OrderSnapshot(State st, SerializedOrder bin):_st(st),_bin(std::move(bin)) {}
+    virtual State get_state() const override {return _st;}
+    virtual SerializedOrder to_binary() const override {return _bin;}
+protected:
+    State _st;
+    SerializedOrder _bin;
+};
+
+bool label_match(const Fill &f, std::string_view filter) {
+    return std::string_view(f.label).substr(0, filter.size()) == filter;
+}
+
+}
+
+AsyncStorage::AsyncStorage(std::unique_ptr<IStorage> backend, Config cfg)
+    :_backend(std::move(backend)),_cfg(cfg) {
+    _cfg.max_pending = std::max<std::size_t>(_cfg.max_pending, 1);
+    _writer = std::thread([this]{writer();});
+}
+
+AsyncStorage::~AsyncStorage() {
+    {
+        std::lock_guard _(_mx);
+        _stop = true;
+    }
+    _work.notify_all();
+    _writer.join();
+}
+
+void AsyncStorage::begin_transaction() {
+    ++_transaction_counter;
+}
+
+void AsyncStorage::put_var(std::string_view name, std::string_view value) {
+    store(OpPutVar{std::string(name), std::string(value)}, true);
+}
+
+void AsyncStorage::erase_var(std::string_view name) {
+    store(OpEraseVar{std::string(name)}, true);
+}
+
+void AsyncStorage::put_order(const Order &ord) {
+    store(OpPutOrder{Order(std::make_shared<OrderSnapshot>(ord.get_state(), ord.to_binary()))}, false);
+}
+
+void AsyncStorage::put_fill(const Fill &fill) {
+    store(OpPutFill{fill}, false);
+}
+
+void AsyncStorage::store(Op op, bool var_op) {
+    _current.ops.push_back(std::move(op));
+    _current.var_ops += var_op;
+    if (!_transaction_counter) {
+        ++_transaction_counter;
+        commit();
+    }
+}
+
+void AsyncStorage::commit() {
+    _transaction_counter = std::max(_transaction_counter-1, 0);
+    if (_transaction_counter) return;
+    std::unique_lock lk(_mx);
+    check_error();
+    if (_current.ops.empty()) return;
+    if (_pending.size() >= _cfg.max_pending) {
+        ++_stats.backpressure;
+        _space.wait(lk, [&]{return _pending.size() < _cfg.max_pending || _error;});
+        check_error();
+    }
+    _pending_var_ops += _current.var_ops;
+    _pending.push_back(std::move(_current));
+    _current = {};
+    ++_stats.committed;
+    lk.unlock();
+    _work.notify_one();
+}
+
+void AsyncStorage::rollback() {
+    _current = {};
+    _transaction_counter = std::max(_transaction_counter-1, 0);
+}
+
+void AsyncStorage::flush() {
+    std::unique_lock lk(_mx);
+    _space.wait(lk, [&]{return _pending.empty() || _error;});
+    check_error();
+}
+
+AsyncStorage::Stats AsyncStorage::get_stats() const {
+    std::lock_guard _(_mx);
+    return _stats;
+}
+
+void AsyncStorage::check_error() {
+    if (_error) std::rethrow_exception(_error);
+}
+
+void AsyncStorage::writer() {
+    std::unique_lock lk(_mx);
+    while (true) {
+        _work.wait(lk, [&]{return _stop || !_pending.empty();});
+        if (_pending.empty()) break;
+        //the front is not modified nor removed by other thread
+        const Transaction &t = _pending.front();
+        bool failed = _error != nullptr;
+        lk.unlock();
+        {
+            std::lock_guard blk(_backend_mx);
+            std::exception_ptr e;
+            if (!failed) {
+                try {
+                    apply(t);
+                } catch (...) {
+                    e = std::current_exception();
+                }
+            }
+            lk.lock();
+            //remove under both locks, so readers never see transaction twice
+            if (e && !_error) _error = e;
+            _pending_var_ops -= t.var_ops;
+            _pending.pop_front();
+            ++_stats.applied;
+        }
+        _space.notify_all();
+    }
+}
+
+void AsyncStorage::apply(const Transaction &t) {
+    _backend->begin_transaction();
+    try {
+        for (const Op &op: t.ops) {
+            std::visit([&](const auto &x){
+                using T = std::decay_t<decltype(x)>;
+                if constexpr(std::is_same_v<T, OpPutVar>) _backend->put_var(x.name, x.value);
+                else if constexpr(std::is_same_v<T, OpEraseVar>) _backend->erase_var(x.name);
+                else if constexpr(std::is_same_v<T, OpPutOrder>) _backend->put_order(x.order);
+                else _backend->put_fill(x.fill);
+            }, op);
+        }
+    } catch (...) {
+        _backend->rollback();
+        throw;
+    }
+    _backend->commit();
+}
+
+template<typename Fn>
+void AsyncStorage::for_each_pending(Fn &&fn) const {
+    for (const Transaction &t: _pending) {
+        for (const Op &op: t.ops) fn(op);
+    }
+    for (const Op &op: _current.ops) fn(op);
+}
+
+std::optional<std::optional<std::string_view> > AsyncStorage::find_pending_var(std::string_view name) const {
+    std::optional<std::optional<std::string_view> > out;
+    if (_pending_var_ops == 0 && _current.var_ops == 0) return out;
+    for_each_pending([&](const Op &op) {
+        if (auto *p = std::get_if<OpPutVar>(&op)) {
+            if (p->name == name) out.emplace(p->value);
+        } else if (auto *e = std::get_if<OpEraseVar>(&op)) {
+            if (e->name == name) out.emplace(std::nullopt);
+        }
+    });
+    return out;
+}
+
+std::string AsyncStorage::get_var(std::string_view var_name) const {
+    {
+        std::lock_guard lk(_mx);
+        auto v = find_pending_var(var_name);
+        if (v.has_value()) return std::string(v->value_or(std::string_view()));
+    }
+    //variable is not pending, so the writer thread can't change it
+    std::lock_guard blk(_backend_mx);
+    return _backend->get_var(var_name);
+}
+
+std::vector<std::pair<std::string, std::string> > AsyncStorage::collect_vars(
+        std::string_view start, std::string_view end, bool prefix) const {
+    std::vector<std::pair<std::string, std::string> > out;
+    std::lock_guard blk(_backend_mx);
+    std::lock_guard lk(_mx);
+    if (_pending_var_ops == 0 && _current.var_ops == 0) {
+        Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+            out.emplace_back(k, v);
+        };
+        if (prefix) _backend->enum_vars(start, fn);
+        else _backend->enum_vars(start, end, fn);
+        return out;
+    }
+    std::map<std::string, std::optional<std::string>, std::less<> > merged;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+        merged.emplace(k, std::string(v));
+    };
+    if (prefix) _backend->enum_vars(start, fn);
+    else _backend->enum_vars(start, end, fn);
+    auto in_range = [&](std::string_view name) {
+        return prefix?name.substr(0, start.size()) == start:(name >= start && name <= end);
+    };
+    for_each_pending([&](const Op &op) {
+        if (auto *p = std::get_if<OpPutVar>(&op)) {
+            if (in_range(p->name)) merged.insert_or_assign(p->name, p->value);
+        } else if (auto *e = std::get_if<OpEraseVar>(&op)) {
+            if (in_range(e->name)) merged.insert_or_assign(e->name, std::nullopt);
+        }
+    });
+    for (auto &[k, v]: merged) {
+        if (v.has_value()) out.emplace_back(k, std::move(*v));
+    }
+    return out;
+}
+
+void AsyncStorage::enum_vars(std::string_view start, std::string_view end,
+        Function<void(std::string_view,std::string_view)> &fn) const {
+    //callback is called without lock, it can access the storage
+    for (const auto &[k, v]: collect_vars(start, end, false)) fn(k, v);
+}
+
+void AsyncStorage::enum_vars(std::string_view prefix,
+        Function<void(std::string_view,std::string_view)> &fn) const {
+    for (const auto &[k, v]: collect_vars(prefix, {}, true)) fn(k, v);
+}
+
+bool AsyncStorage::is_duplicate_fill(const Fill &fill) const {
+    {
+        std::lock_guard lk(_mx);
+        bool found = false;
+        for_each_pending([&](const Op &op) {
+            if (auto *f = std::get_if<OpPutFill>(&op)) found = found || is_same_fill(f->fill, fill);
+        });
+        if (found) return true;
+    }
+    std::lock_guard blk(_backend_mx);
+    return _backend->is_duplicate_fill(fill);
+}
+
+Fills AsyncStorage::load_fills(std::size_t limit, std::string_view filter) const {
+    std::lock_guard blk(_backend_mx);
+    std::lock_guard lk(_mx);
+    Fills pending;
+    for_each_pending([&](const Op &op) {
+        if (auto *f = std::get_if<OpPutFill>(&op)) {
+            if (label_match(f->fill, filter)) pending.push_back(f->fill);
+        }
+    });
+    //newest first, as the backend does
+    Fills out(pending.rbegin(), pending.rend());
+    if (out.size() >= limit) {
+        out.resize(limit);
+        return out;
+    }
+    Fills rest = _backend->load_fills(limit - out.size(), filter);
+    out.insert(out.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+    return out;
+}
+
+Fills AsyncStorage::load_fills(Timestamp limit, std::string_view filter) const {
+    std::lock_guard blk(_backend_mx);
+    std::lock_guard lk(_mx);
+    Fills pending;
+    for_each_pending([&](const Op &op) {
+        if (auto *f = std::get_if<OpPutFill>(&op)) {
+            if (f->fill.time > limit && label_match(f->fill, filter)) pending.push_back(f->fill);
+        }
+    });
+    Fills out(pending.rbegin(), pending.rend());
+    Fills rest = _backend->load_fills(limit, filter);
+    out.insert(out.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+    return out;
+}
+
+std::vector<SerializedOrder> AsyncStorage::load_open_orders() const {
+    std::lock_guard blk(_backend_mx);
+    std::lock_guard lk(_mx);
+    std::map<std::string, std::string> orders;
+    for (auto &o: _backend->load_open_orders()) {
+        orders.emplace(std::move(o.order_id), std::move(o.order_content));
+    }
+    for_each_pending([&](const Op &op) {
+        if (auto *p = std::get_if<OpPutOrder>(&op)) {
+            auto bin = p->order.to_binary();
+            if (unused(bin)) return;
+            if (p->order.done()) orders.erase(bin.order_id);
+            else orders.insert_or_assign(std::move(bin.order_id), std::move(bin.order_content));
+        }
+    });
+    std::vector<SerializedOrder> out;
+    for (auto &[k, v]: orders) out.push_back({k, std::move(v)});
+    return out;
+}
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "storage.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace trading_api {
+
+///Storage which commits transactions in a background thread
+/**
+ * Wraps other storage (backend). Writes are collected in the calling
+ * (strategy) thread, commit() only hands the finished transaction to the
+ * writer thread, which applies it to the backend. The commit blocks only
+ * when count of pending transactions reaches max_pending (backpressure).
+ *
+ * Reads see all writes made through this object (read-your-writes), including
+ * writes of uncommitted transaction and transactions which are not yet
+ * applied to the backend - pending writes are merged with result of the backend.
+ * get_var() and is_duplicate_fill() answered from pending writes don't touch
+ * the backend. Other reads wait while the writer thread applies a transaction.
+ *
+ * Error of the backend is reported by next commit() or flush(). After an
+ * error, following transactions are not applied.
+ *
+ * Orders are passed to the backend as snapshot taken in put_order(). The
+ * snapshot provides state and binary form of the order only
+ *
+ * @note object itself is not MT safe, it must be used by single thread
+ */
+class AsyncStorage: public IStorage {
+public:
+
+    struct Config {
+        ///maximum count of transactions waiting to be applied
+        std::size_t max_pending = 256;
+    };
+
+    struct Stats {
+        ///transactions passed to writer thread
+        std::uint64_t committed = 0;
+        ///transactions applied to backend
+        std::uint64_t applied = 0;
+        ///count of commits blocked because queue was full
+        std::uint64_t backpressure = 0;
+    };
+
+    AsyncStorage(std::unique_ptr<IStorage> backend, Config cfg);
+    explicit AsyncStorage(std::unique_ptr<IStorage> backend):AsyncStorage(std::move(backend), Config{}) {}
+    AsyncStorage(const AsyncStorage &) = delete;
+    AsyncStorage &operator=(const AsyncStorage &) = delete;
+    ///Applies pending transactions and stops writer thread
+    ~AsyncStorage();
+
+    virtual void begin_transaction() override;
+    virtual void put_var(std::string_view name, std::string_view value) override;
+    virtual void erase_var(std::string_view name) override;
+    virtual void put_order(const Order &ord) override;
+    virtual void put_fill(const Fill &fill) override;
+    ///Hand transaction to the writer thread
+    /**
+     * @exception any error reported by backend while applying previous transactions
+     */
+    virtual void commit() override;
+    virtual void rollback() override;
+    virtual bool is_duplicate_fill(const Fill &fill) const override;
+    virtual Fills load_fills(std::size_t limit, std::string_view filter) const override;
+    virtual Fills load_fills(Timestamp limit, std::string_view filter) const override;
+    virtual std::vector<SerializedOrder> load_open_orders() const override;
+    virtual std::string get_var(std::string_view var_name) const override;
+    virtual void enum_vars(std::string_view start, std::string_view end,
+            Function<void(std::string_view,std::string_view)> &fn) const override;
+    virtual void enum_vars(std::string_view prefix,
+            Function<void(std::string_view,std::string_view)> &fn) const override;
+
+    ///Wait until all committed transactions are applied to backend
+    /**
+     * @exception any error reported by backend
+     */
+    void flush();
+
+    Stats get_stats() const;
+
+protected:
+
+    struct OpPutVar {
+        std::string name;
+        std::string value;
+    };
+    struct OpEraseVar {
+        std::string name;
+    };
+    struct OpPutOrder {
+        Order order;
+    };
+    struct OpPutFill {
+        Fill fill;
+    };
+
+    using Op = std::variant<OpPutVar, OpEraseVar, OpPutOrder, OpPutFill>;
+
+    struct Transaction {
+        std::vector<Op> ops;
+        ///count of var operations (pending vars must be merged on enumeration)
+        std::size_t var_ops = 0;
+    };
+
+    std::unique_ptr<IStorage> _backend;
+    Config _cfg;
+
+    ///current transaction (strategy thread only)
+    Transaction _current;
+    int _transaction_counter = 0;
+
+    ///locked while backend is accessed. Lock before _mx
+    mutable std::mutex _backend_mx;
+    ///guards _pending, _error and _stats
+    mutable std::mutex _mx;
+    std::condition_variable _work;
+    std::condition_variable _space;
+    ///transactions not yet applied, front is being applied by writer thread
+    std::deque<Transaction> _pending;
+    std::size_t _pending_var_ops = 0;
+    std::exception_ptr _error;
+    Stats _stats;
+    bool _stop = false;
+    std::thread _writer;
+
+    void store(Op op, bool var_op);
+    void writer();
+    void apply(const Transaction &t);
+    void check_error();
+
+    ///find last write of variable in pending transactions (must be locked)
+    /**
+     * @return no value - not found, otherwise value of the variable or
+     * empty value if it has been erased
+     */
+    std::optional<std::optional<std::string_view> > find_pending_var(std::string_view name) const;
+    ///call function for every pending operation, from oldest (must be locked)
+    template<typename Fn> void for_each_pending(Fn &&fn) const;
+    ///collect variables merged with pending writes
+    std::vector<std::pair<std::string, std::string> > collect_vars(
+            std::string_view start, std::string_view end, bool prefix) const;
+};
+
+}
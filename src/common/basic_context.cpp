@@ -1,6 +1,7 @@
 #include "basic_context.h"
 
 #include "basic_order.h"
+#include <algorithm>
 namespace trading_api {
 
 
@@ -28,6 +29,10 @@ void BasicContext::init(std::unique_ptr<IStrategy> strategy,
     for (const auto &i: _instruments) {
         _exchanges.emplace(i.get_exchange(),Batches{});
     }
+    for (const auto &[e, _]: _exchanges) {
+        const IOThread *io = BasicExchangeContext::from_exchange(e).get_io_thread();
+        if (io) _inbound.push_back(std::make_unique<InboundQueue>(io, inbound_queue_size));
+    }
     _strategy->on_init(this);
     auto orders = _storage->load_open_orders();
     for (auto &[e, _]: _exchanges) {
@@ -39,29 +44,46 @@ void BasicContext::init(std::unique_ptr<IStrategy> strategy,
 
 
 void BasicContext::on_event(const Instrument &i, SubscriptionType subscription_type) {
+    on_event(i, subscription_type, nullptr);
+}
+
+void BasicContext::on_event(const Instrument &i, SubscriptionType subscription_type,
+        std::shared_ptr<std::atomic<bool> > pending) {
+    EvMarketData ev{this, i};
+    if (subscription_type == SubscriptionType::ticker) {
+        ev.ticker = true;
+        ev.ticker_pending = std::move(pending);
+    } else {
+        ev.orderbook = true;
+        ev.orderbook_pending = std::move(pending);
+    }
+    QueueItem item(std::move(ev));
+    if (push_inbound(std::move(item))) return;
     std::lock_guard _(_queue_mx);
+    enqueue_market_data(std::move(std::get<EvMarketData>(item)));
+    notify_queue();
+}
+
+void BasicContext::enqueue_market_data(EvMarketData &&ev) {
     auto iter = std::find_if(_queue.begin(), _queue.end(), [&](QueueItem &q){
         return std::holds_alternative<EvMarketData>(q)
-                && std::get<EvMarketData>(q).i == i;
+                && std::get<EvMarketData>(q).i == ev.i;
     });
-    EvMarketData *md;
     if (iter == _queue.end()) {
-        _queue.push_back(EvMarketData{this,i});
-        md = &std::get<EvMarketData>(_queue.back());
-    } else {
-        md = &std::get<EvMarketData>(*iter);
-        notify_queue();
-    }
-    switch (subscription_type) {
-        case SubscriptionType::ticker: md->ticker =true; break;
-        case SubscriptionType::orderbook: md->orderbook =true; break;
-        default: break;
+        _queue.push_back(std::move(ev));
+        return;
     }
+    EvMarketData &md = std::get<EvMarketData>(*iter);
+    md.ticker = md.ticker || ev.ticker;
+    md.orderbook = md.orderbook || ev.orderbook;
+    if (ev.ticker_pending) md.ticker_pending = std::move(ev.ticker_pending);
+    if (ev.orderbook_pending) md.orderbook_pending = std::move(ev.orderbook_pending);
 }
 
 
 
 void BasicContext::on_event(const Order &order, const Fill &fill) {
+    if (push_inbound(EvOrderFill{this, order, fill})) return;
     std::lock_guard _(_queue_mx);
     _queue.push_back(EvOrderFill{this, order, fill});
     notify_queue();
@@ -70,6 +92,7 @@ void BasicContext::on_event(const Order &order, const Fill &fill) {
 
 
 void BasicContext::on_event(const Order &order, const Order::Report &report) {
+    if (push_inbound(EvOrderStatus{this, order, report})) return;
     std::lock_guard _(_queue_mx);
     _queue.push_back(EvOrderStatus{this, order, report});
     notify_queue();
@@ -79,6 +102,7 @@ void BasicContext::on_event(const Order &order, const Order::Report &report) {
 
 
 void BasicContext::on_event(const Instrument &i) {
+    if (push_inbound(EvUpdateInstrument{this, i})) return;
     std::lock_guard _(_queue_mx);
     _queue.push_back(EvUpdateInstrument{this, i});
     notify_queue();
@@ -88,11 +112,67 @@ void BasicContext::on_event(const Instrument &i) {
 
 
 void BasicContext::on_event(const Account &a) {
+    if (push_inbound(EvUpdateAccount{this, a})) return;
     std::lock_guard _(_queue_mx);
     _queue.push_back(EvUpdateAccount{this, a});
     notify_queue();
 }
 
+bool BasicContext::push_inbound(QueueItem &&item) {
+    const IOThread *io = IOThread::current();
+    if (!io) return false;
+    for (auto &q: _inbound) {
+        if (q->io != io) continue;
+        if (q->overflowed.load(std::memory_order_acquire) || !q->queue.try_push(std::move(item))) {
+            std::lock_guard _(q->overflow_mx);
+            q->overflow.push_back(std::move(item));
+            q->overflowed.store(true, std::memory_order_release);
+        }
+        if (!_inbound_wake.exchange(true, std::memory_order_acq_rel)) {
+            _scheduler(Timestamp::min(), [this](auto tp){on_scheduler(tp);}, this);
+        }
+        return true;
+    }
+    return false;
+}
+
+void BasicContext::drain_inbound() {
+    if (!_inbound_wake.exchange(false, std::memory_order_acq_rel)) return;
+    QueueItem item;
+    std::vector<QueueItem> overflow;
+    std::lock_guard _(_queue_mx);
+    for (auto &q: _inbound) {
+        //producer doesn't use the queue while overflowed, so the overflow
+        //contains only events newer than the content of the queue. If the
+        //flag is set later, the overflow is taken during next drain
+        bool overflowed = q->overflowed.load(std::memory_order_acquire);
+        while (q->queue.try_pop(item)) enqueue_inbound(std::move(item));
+        if (overflowed) {
+            {
+                std::lock_guard _(q->overflow_mx);
+                std::swap(overflow, q->overflow);
+                q->overflowed.store(false, std::memory_order_release);
+            }
+            for (auto &x: overflow) enqueue_inbound(std::move(x));
+            overflow.clear();
+        }
+    }
+}
+
+void BasicContext::enqueue_inbound(QueueItem &&item) {
+    if (auto md = std::get_if<EvMarketData>(&item)) {
+        enqueue_market_data(std::move(*md));
+    } else {
+        _queue.push_back(std::move(item));
+    }
+}
+
+bool BasicContext::inbound_pending() const {
+    return std::any_of(_inbound.begin(), _inbound.end(), [](const auto &q){
+        return !q->queue.empty() || q->overflowed.load(std::memory_order_acquire);
+    });
+}
+
 
 void BasicContext::notify_queue() {
     Timestamp tp = Timestamp::max();
@@ -112,8 +192,8 @@ void BasicContext::notify_queue() {
 }
 
 
-void BasicContext::subscribe(SubscriptionType type, const Instrument &i) {
-    BasicExchangeContext::from_exchange(i.get_exchange()).subscribe(this, type, i);
+void BasicContext::subscribe(SubscriptionType type, const Instrument &i, const SubscriptionPolicy &policy) {
+    BasicExchangeContext::from_exchange(i.get_exchange()).subscribe(this, type, i, policy);
 }
 
 
@@ -134,7 +214,7 @@ Order BasicContext::place(const Instrument &instrument, const Account &account,
     BasicExchangeContext &e = BasicExchangeContext::from_exchange(ex);
     auto ord = e.create_order(instrument, account, setup);
     if (!ord.discarded()) {
-        _exchanges[ex]._batch_place.push_back(ord);
+        _exchanges[ex]._batch_place.push_back({ord, {}, false});
     }
     return ord;
 }
@@ -145,7 +225,7 @@ Order BasicContext::replace(const Order &order, const Order::Setup &setup, bool
     BasicExchangeContext &e = BasicExchangeContext::from_exchange(ex);
     auto ord = e.create_order_replace(order, setup, amend);
     if (!ord.discarded()) {
-        _exchanges[ex]._batch_place.push_back(ord);
+        _exchanges[ex]._batch_place.push_back({ord, order, amend});
     }
     return Order(ord);
 }
@@ -162,13 +242,61 @@ void BasicContext::set_timer(Timestamp at, CompletionCB fnptr, TimerID id) {
 
     std::lock_guard _(_queue_mx);
 
-    if (!fnptr) fnptr = [this, id]{
+    bool strategy_timer = !fnptr;
+    if (strategy_timer) fnptr = [this, id]{
         _strategy->on_timer(id);
     };
-    _timed_queue.push(TimerItem{at, id, std::move(fnptr)});
+    _timed_queue.push(TimerItem{at, id, std::move(fnptr), strategy_timer});
     notify_queue();
 }
 
+void BasicContext::set_internal_timer(Timestamp at, Function<void()> fn) {
+    std::lock_guard _(_queue_mx);
+    _timed_queue.push(TimerItem{at, 0, std::move(fn), false, true});
+    notify_queue();
+}
+
+void BasicContext::save_state(BinaryWriter &wr) const {
+    {
+        std::lock_guard _(_queue_mx);
+        wr.write(_event_time);
+        auto cnt = std::count_if(_timed_queue.begin(), _timed_queue.end(), [](const TimerItem &item){
+            return item.strategy_timer;
+        });
+        wr.write_size(cnt);
+        for (const TimerItem &item: _timed_queue) {
+            if (!item.strategy_timer) continue;
+            wr.write(item.tp);
+            wr.write(item.id);
+        }
+    }
+    auto chkp = dynamic_cast<const ICheckpointable *>(_storage.get());
+    wr.write(chkp != nullptr);
+    if (chkp) chkp->save_state(wr);
+}
+
+void BasicContext::load_state(BinaryReader &rd) {
+    {
+        std::lock_guard _(_queue_mx);
+        _event_time = rd.read_timestamp();
+        while (!_timed_queue.empty()) _timed_queue.pop();
+        for (std::size_t i = 0, cnt = rd.read_size(); i < cnt; ++i) {
+            Timestamp tp = rd.read_timestamp();
+            TimerID id = rd.read<TimerID>();
+            _timed_queue.push(TimerItem{tp, id, [this, id]{
+                _strategy->on_timer(id);
+            }, true});
+        }
+        _scheduled_time = Timestamp::max();
+        notify_queue();
+    }
+    auto chkp = dynamic_cast<ICheckpointable *>(_storage.get());
+    if (rd.read<bool>()) {
+        if (!chkp) throw std::runtime_error("BasicContext: checkpoint contains storage which is not supported");
+        chkp->load_state(rd);
+    }
+}
+
 
 void BasicContext::unsubscribe(SubscriptionType type, const Instrument &i) {
     BasicExchangeContext::from_exchange(i.get_exchange()).unsubscribe(this, type, i);
@@ -208,7 +336,7 @@ void BasicContext::allocate(const Account &, double ) {
 bool BasicContext::clear_timer(TimerID id) {
     std::lock_guard _(_queue_mx);
     auto iter = std::find_if(_timed_queue.begin(), _timed_queue.end(), [&](const TimerItem &item){
-       return item.id == id;
+       return !item.internal && item.id == id;
     });
     if (iter != _timed_queue.end()) {
         _timed_queue.erase(iter);
@@ -236,15 +364,17 @@ void BasicContext::update_instrument(const Instrument &i, CompletionCB complete_
 
 void BasicContext::flush_batches() {
     for (auto &[ex, batch]: _exchanges) {
+        if (batch._batch_cancel.empty() && batch._batch_place.empty()
+                && batch._wakeup > _event_time) continue;
         BasicExchangeContext &e = BasicExchangeContext::from_exchange(ex);
-        if (!batch._batch_cancel.empty()) {
-            e.batch_cancel({batch._batch_cancel.begin(), batch._batch_cancel.end()});
-            batch._batch_cancel.clear();
-        }
-        if (!batch._batch_place.empty()) {
-            e.batch_place(this, {batch._batch_place.begin(), batch._batch_place.end()});
-            batch._batch_place.clear();
+        Timestamp next = e.batch(this, batch._batch_cancel, batch._batch_place, _event_time);
+        batch._batch_cancel.clear();
+        batch._batch_place.clear();
+        if (next != Timestamp::max() && next != batch._wakeup) {
+            //wake up to send deferred requests
+            set_internal_timer(next, []{});
         }
+        batch._wakeup = next;
     }
 }
 
@@ -280,6 +410,9 @@ void BasicContext::EvUpdateAccount::operator ()() {
 
 
 void BasicContext::EvMarketData::operator ()() {
+    //clear before reading, so update which arrives during processing generates new event
+    if (ticker_pending) ticker_pending->store(false, std::memory_order_release);
+    if (orderbook_pending) orderbook_pending->store(false, std::memory_order_release);
     if (ticker) {
         Ticker tk;
         if (i.get_exchange().get_last_ticker(i, tk)) {
@@ -314,6 +447,10 @@ std::string BasicContext::get_var(std::string_view var_name) const {
     return _storage->get_var(var_name);
 }
 
+Log BasicContext::get_logger() const {
+    return _logger;
+}
+
 std::span<const Account> BasicContext::get_accounts() const {
     return {_accounts.data(), _accounts.size()};
 }
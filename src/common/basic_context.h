@@ -5,8 +5,11 @@
 #include "../trading_ifc/strategy.h"
 #include "context_scheduler.h"
 #include "storage.h"
+#include "checkpoint.h"
 
 #include "basic_exchange.h"
+#include "spsc_queue.h"
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <map>
@@ -30,7 +33,7 @@ concept SchedulerType = (std::is_invocable_v<Scheduler, Timestamp, Function<void
 
 
 
-class BasicContext: public IContext, public IEventTarget {
+class BasicContext: public IContext, public IEventTarget, public ICheckpointable {
 public:
 
     using GlobalScheduler = std::function<void(Timestamp,std::function<void(Timestamp)>, const void *)>;
@@ -55,9 +58,11 @@ public:
     virtual void on_event(const Instrument &i) override;
     virtual void on_event(const Account &a) override;
     virtual void on_event(const Instrument &i, SubscriptionType subscription_type) override;
+    virtual void on_event(const Instrument &i, SubscriptionType subscription_type,
+            std::shared_ptr<std::atomic<bool> > pending) override;
     virtual void on_event(const Order &order, const Order::Report &report) override;
     virtual void on_event(const Order &order, const Fill &fill) override;
-    virtual void subscribe(SubscriptionType type, const Instrument &i)override;
+    virtual void subscribe(SubscriptionType type, const Instrument &i, const SubscriptionPolicy &policy)override;
     virtual Order replace(const Order &order, const Order::Setup &setup, bool amend) override;
     virtual Fills get_fills(std::size_t limit, std::string_view filter = {}) const override;
     virtual Fills get_fills(Timestamp tp, std::string_view filter = {}) const override;
@@ -83,6 +88,19 @@ public:
             Function<void(std::string_view,std::string_view)> &fn) const override;
     virtual const StrategyConfig &get_config() const override;
 
+    ///Store timers and content of the storage
+    /**
+     * Only timers which call IStrategy::on_timer() are stored, timers with
+     * custom callback can't be serialized. If the storage supports
+     * ICheckpointable, its content is stored as well
+     */
+    virtual void save_state(BinaryWriter &wr) const override;
+    ///Restore timers and content of the storage
+    /**
+     * Timers set during initialization of the strategy are replaced
+     */
+    virtual void load_state(BinaryReader &rd) override;
+
 protected:
 
     GlobalScheduler _scheduler;
@@ -113,6 +131,9 @@ protected:
         Instrument i;
         bool ticker = false;
         bool orderbook = false;
+        ///pending flags of conflated subscriptions, cleared when processed
+        std::shared_ptr<std::atomic<bool> > ticker_pending = {};
+        std::shared_ptr<std::atomic<bool> > orderbook_pending = {};
         void operator()();
     };
 
@@ -142,6 +163,10 @@ protected:
         Timestamp tp;
         TimerID id;
         Function<void()> r;
+        ///timer calls IStrategy::on_timer (can be stored in checkpoint)
+        bool strategy_timer = false;
+        ///timer is used by the context, id is not used and strategy can't clear it
+        bool internal = false;
         struct ordering {
             bool operator()(const TimerItem &a, const TimerItem &b) const {
                 return a.tp > b.tp;
@@ -150,11 +175,13 @@ protected:
     };
 
     struct Batches {
-        std::vector<Order> _batch_place;
+        std::vector<PlaceRequest> _batch_place;
         std::vector<Order> _batch_cancel;
+        ///time when deferred requests must be sent to the exchange
+        Timestamp _wakeup = Timestamp::max();
     };
 
-    std::mutex _queue_mx;
+    mutable std::mutex _queue_mx;
     std::deque<QueueItem> _queue;
     PriorityQueue<TimerItem, typename TimerItem::ordering> _timed_queue;
 
@@ -162,13 +189,53 @@ protected:
     std::multimap<Instrument, CompletionCB> _cb_update_instrument;
     std::map<Exchange, Batches> _exchanges;
 
+    static constexpr std::size_t inbound_queue_size = 4096;
+
+    ///queue of events from an I/O thread of an exchange
+    /**
+     * When the queue is full, events are stored to the overflow list. Once
+     * the list is used, all following events are stored there until the
+     * consumer drains the queue and takes the list, so the order of events
+     * is preserved.
+     */
+    struct InboundQueue {
+        const IOThread *io;
+        SPSCQueue<QueueItem> queue;
+        ///set by producer when overflow is used, cleared by consumer
+        std::atomic<bool> overflowed = false;
+        std::mutex overflow_mx;
+        std::vector<QueueItem> overflow;
+        InboundQueue(const IOThread *io, std::size_t size):io(io),queue(size) {}
+    };
+
+    std::vector<std::unique_ptr<InboundQueue> > _inbound;
+    ///set when context has been woken up to drain inbound queues
+    std::atomic<bool> _inbound_wake = false;
+
     void flush_batches();
+    ///set timer which is not visible to the strategy
+    void set_internal_timer(Timestamp at, Function<void()> fn);
     void notify_queue();
+    ///push event to inbound queue if called from I/O thread
+    /**
+     * @retval true pushed, the context has been woken up
+     * @retval false not called from I/O thread, use regular (locked) path
+     */
+    bool push_inbound(QueueItem &&item);
+    ///move events from inbound queues to the main queue
+    void drain_inbound();
+    ///move event from inbound queue to the main queue (must be locked)
+    void enqueue_inbound(QueueItem &&item);
+    ///returns true if there are events in inbound queues
+    bool inbound_pending() const;
+    ///enqueue market data event, merge with pending event (must be locked)
+    void enqueue_market_data(EvMarketData &&ev);
 
     void on_scheduler(Timestamp tp) noexcept {
         _event_time = tp;
         _storage->begin_transaction();
         try {
+            drain_inbound();
             std::unique_lock lk(_queue_mx);
 
             while (!_queue.empty()) {
@@ -190,6 +257,12 @@ protected:
             } else {
                 _scheduled_time = Timestamp::max();
             }
+            //the wake up could be overwritten by reschedule above
+            if (inbound_pending()) {
+                _inbound_wake.store(true, std::memory_order_release);
+                _scheduled_time = Timestamp::min();
+                _scheduler(_scheduled_time, [this](auto tp){on_scheduler(tp);}, this);
+            }
         } catch (...) {
             try {
                 _strategy->on_unhandled_exception();
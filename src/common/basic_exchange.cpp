@@ -1,51 +1,128 @@
 #include "basic_exchange.h"
+#include <algorithm>
 
 namespace trading_api {
 
+BasicExchangeContext::~BasicExchangeContext() {
+    ContextSchedulerGeneric sch;
+    bool pending;
+    {
+        std::lock_guard _(_mx);
+        std::swap(sch, _scheduler);
+        pending = _trailing_wakeup != Timestamp::max();
+    }
+    //cancel pending delivery, the default scheduler is stopped outside of the lock.
+    //The scheduler is not touched when nothing is scheduled, it would start its thread
+    if (sch && pending) sch(Timestamp{}, [](auto){}, this);
+}
+
 void BasicExchangeContext::init(std::unique_ptr<IExchangeService> svc, StrategyConfig configuration) {
     this->_ptr = std::move(svc);
     _ptr->init(this, configuration);
 }
 
-void BasicExchangeContext::subscribe(IEventTarget *target, SubscriptionType sbstype, const Instrument &instrument) {
+bool BasicExchangeContext::SubscriptionList::contains(const IEventTarget *target) const {
+    return std::any_of(targets.begin(), targets.end(), [&](const Subscriber &s){return s.target == target;})
+        || std::find(onceshot.begin(), onceshot.end(), target) != onceshot.end();
+}
+
+void BasicExchangeContext::SubscriptionList::remove(const IEventTarget *target) {
+    targets.erase(std::remove_if(targets.begin(), targets.end(), [&](const Subscriber &s){
+        return s.target == target;
+    }), targets.end());
+    onceshot.erase(std::remove(onceshot.begin(), onceshot.end(), target), onceshot.end());
+}
+
+void BasicExchangeContext::start_io_thread() {
+    if (!_io) _io = std::make_unique<IOThread>();
+}
+
+template<typename Fn>
+bool BasicExchangeContext::post_to_io(Fn &&fn) {
+    if (!_io || _io->is_current()) return false;
+    _io->post(std::forward<Fn>(fn));
+    return true;
+}
+
+void BasicExchangeContext::set_clock(Function<Timestamp()> clock) {
+    std::lock_guard _(_mx);
+    _clock = std::move(clock);
+}
+
+void BasicExchangeContext::set_scheduler(ContextSchedulerGeneric scheduler) {
+    std::lock_guard _(_mx);
+    _scheduler = std::move(scheduler);
+    _trailing_wakeup = Timestamp::max();
+}
+
+void BasicExchangeContext::subscribe(IEventTarget *target, SubscriptionType sbstype, const Instrument &instrument, const SubscriptionPolicy &policy) {
     std::lock_guard _(_mx);
-    Subscription s{sbstype, instrument, nullptr};
-    auto iter = _subscriptions.lower_bound(s);
-    if (iter == _subscriptions.end() || iter->first.type != sbstype || iter->first.i != instrument) {
+    SubscriptionList &lst = _subscriptions[instrument][sbstype];
+    if (lst.empty()) {
         _ptr->subscribe(sbstype, instrument);
     }
-    s.target = target;
-    auto r =_subscriptions.emplace(s, SubscriptionLimit::unlimited);
-    if (!r.second) r.first->second = SubscriptionLimit::unlimited;
+    lst.remove(target);
+    Subscriber sb{target, policy};
+    if (policy.mode == SubscriptionPolicy::Mode::conflate) {
+        sb.pending = std::make_shared<std::atomic<bool> >(false);
+    }
+    lst.targets.push_back(std::move(sb));
 }
 
 void BasicExchangeContext::unsubscribe(IEventTarget *target, SubscriptionType sbstype, const Instrument &instrument) {
     std::lock_guard _(_mx);
-    Subscription s{sbstype, instrument, target};
-    _subscriptions.erase(s);
+    InstrumentSubscriptions *subs = _subscriptions.find(instrument);
+    if (subs) (*subs)[sbstype].remove(target);
 }
 
 void BasicExchangeContext::income_data(const Instrument &i, const Ticker &t) {
+    if (post_to_io([=, this]{income_data(i, t);})) return;
     std::lock_guard _(_mx);
-    _tickers[i] = t;
-    send_subscription_notify(i, SubscriptionType::ticker);
+    _last_values.put(i, t);
+    send_subscription_notify(i, SubscriptionType::ticker, t);
 }
 
 void BasicExchangeContext::income_data(const Instrument &i, const OrderBook &t) {
+    if (post_to_io([=, this]{income_data(i, t);})) return;
     std::lock_guard _(_mx);
-    _orderbooks[i] = t;
-    send_subscription_notify(i, SubscriptionType::orderbook);
+    OrderBook &ob = _orderbooks[i];
+    ob = t;
+    _last_values.put(i, t);
+    Ticker top;
+    ob.update_ticker(top);
+    send_subscription_notify(i, SubscriptionType::orderbook, top);
+}
+
+void BasicExchangeContext::income_data(const Instrument &i, std::span<const OrderBook::Update> updates, bool snapshot) {
+    if (post_to_io([=, this, updates = std::vector<OrderBook::Update>(updates.begin(), updates.end())]{
+        income_data(i, updates, snapshot);
+    })) return;
+    std::lock_guard _(_mx);
+    OrderBook &ob = _orderbooks[i];
+    if (snapshot) ob = OrderBook();
+    for (const auto &up: updates) ob.update(up);
+    //the orderbook is persistent structure, the copy shares nodes with the working book
+    _last_values.put(i, ob);
+    Ticker top;
+    ob.update_ticker(top);
+    send_subscription_notify(i, SubscriptionType::orderbook, top);
 }
 
 
 Order BasicExchangeContext::create_order(const Instrument &instrument,
         const Account &account, const Order::Setup &setup) {
-    _ptr->create_order(instrument, account, setup);
+    return _ptr->create_order(instrument, account, setup);
 }
 
 Order BasicExchangeContext::create_order_replace(const Order &replace,
         const Order::Setup &setup, bool amend) {
-    _ptr->create_order_replace(replace, setup, amend);
+    std::lock_guard _(_mx);
+    return _ptr->create_order_replace(exchange_order(replace), setup, amend);
+}
+
+Order BasicExchangeContext::exchange_order(const Order &order) const {
+    auto e = _orders.find_alias(order);
+    return e?e->order:order;
 }
 
 std::optional<IExchange::Icon> BasicExchangeContext::get_icon() const {
@@ -70,44 +147,69 @@ void BasicExchangeContext::order_apply_fill(const Order &order,
     _ptr->order_apply_fill(order, fill);
 }
 
-void BasicExchangeContext::send_subscription_notify(const Instrument &i, SubscriptionType type) {
-    Subscription s{type, i, nullptr};
-    auto iter = _subscriptions.lower_bound(s);
-    unsigned int remain = 0;
-    while (iter != _subscriptions.end() && iter->first.i == i && iter->first.type == type) {
-        s.target = iter->first.target;
-        if (iter->second == SubscriptionLimit::onceshot) iter = _subscriptions.erase(iter);
-        else ++remain;
-        s.target->on_event(s.i, s.type);
+void BasicExchangeContext::send_subscription_notify(const Instrument &i, SubscriptionType type, const Ticker &top) {
+    InstrumentSubscriptions *subs = _subscriptions.find(i);
+    if (!subs) {
+        _ptr->unsubscribe(type, i);
+        return;
     }
-    if (remain == 0) _ptr->unsubscribe(type, i);
+    SubscriptionList &lst = (*subs)[type];
+    auto onceshot = std::move(lst.onceshot);
+    lst.onceshot.clear();
+    Timestamp now = Timestamp::min();
+    //targets can't be removed during notification (events are queued), so index is stable
+    for (std::size_t idx = 0; idx < lst.targets.size(); ++idx) {
+        Subscriber &sb = lst.targets[idx];
+        switch (sb.policy.mode) {
+            default:
+            case SubscriptionPolicy::Mode::every:
+                break;
+            case SubscriptionPolicy::Mode::conflate:
+                if (sb.pending->exchange(true, std::memory_order_acq_rel)) continue;
+                sb.target->on_event(i, type, sb.pending);
+                continue;
+            case SubscriptionPolicy::Mode::throttle:
+                if (now == Timestamp::min()) now = _clock();
+                //first event is delivered at once (last_event - min() would overflow)
+                if (sb.last_event != Timestamp::min() && now - sb.last_event < sb.policy.interval) {
+                    if (!sb.trailing) {
+                        sb.trailing = true;
+                        schedule_trailing(sb.last_event + sb.policy.interval);
+                    }
+                    continue;
+                }
+                sb.last_event = now;
+                sb.trailing = false;
+                break;
+            case SubscriptionPolicy::Mode::top_of_book:
+                if (sb.top.bid == top.bid && sb.top.ask == top.ask
+                        && sb.top.bid_volume == top.bid_volume
+                        && sb.top.ask_volume == top.ask_volume) continue;
+                sb.top = top;
+                break;
+        }
+        sb.target->on_event(i, type);
+    }
+    for (IEventTarget *target: onceshot) {
+        target->on_event(i, type);
+    }
+    if (lst.empty()) _ptr->unsubscribe(type, i);
 }
 
 bool BasicExchangeContext::get_last_ticker(const Instrument &instrument, Ticker &tk) {
-    std::lock_guard _(_mx);
-    auto iter = _tickers.find(instrument);
-    if (iter == _tickers.end()) return false;
-    tk = iter->second;
-    return true;
+    return _last_values.get(instrument, tk);
 }
 
 bool BasicExchangeContext::get_last_orderbook(const Instrument &instrument, OrderBook &ordb) {
-    std::lock_guard _(_mx);
-    auto iter = _orderbooks.find(instrument);
-    if (iter == _orderbooks.end()) return false;
-    ordb = iter->second;
-    return true;
-
+    return _last_values.get(instrument, ordb);
 }
 
 void BasicExchangeContext::update_ticker(IEventTarget *target, const Instrument &instrument) {
     std::lock_guard _(_mx);
-    Subscription s{SubscriptionType::ticker, instrument, nullptr};
-    auto iter = _subscriptions.lower_bound(s);
-    if (iter == _subscriptions.end() || iter->first.type != SubscriptionType::ticker || iter->first.i != instrument) {
-        _ptr->subscribe(SubscriptionType::ticker, instrument);
-        s.target = target;
-        _subscriptions.emplace(s, SubscriptionLimit::onceshot);
+    SubscriptionList &lst = _subscriptions[instrument][SubscriptionType::ticker];
+    if (lst.targets.empty()) {
+        if (lst.onceshot.empty()) _ptr->subscribe(SubscriptionType::ticker, instrument);
+        if (!lst.contains(target)) lst.onceshot.push_back(target);
     } else {
         target->on_event(instrument, SubscriptionType::ticker);
     }
@@ -132,6 +234,7 @@ void BasicExchangeContext::update_instrument(IEventTarget *target, const Instrum
 }
 
 void BasicExchangeContext::object_updated(const Account &account) {
+    if (post_to_io([=, this]{object_updated(account);})) return;
     std::lock_guard _(_mx);
     auto &lst = _account_update_waiting[account];
     for (auto x: lst) {
@@ -141,6 +244,7 @@ void BasicExchangeContext::object_updated(const Account &account) {
 }
 
 void BasicExchangeContext::object_updated(const Instrument &instrument) {
+    if (post_to_io([=, this]{object_updated(instrument);})) return;
     std::lock_guard _(_mx);
     auto &lst = _instrument_update_waiting[instrument];
     for (auto x: lst) {
@@ -149,17 +253,46 @@ void BasicExchangeContext::object_updated(const Instrument &instrument) {
     lst.clear();
 }
 
+void BasicExchangeContext::schedule_trailing(Timestamp tp) {
+    if (tp >= _trailing_wakeup || !_scheduler) return;
+    _trailing_wakeup = tp;
+    _scheduler(tp, [this](Timestamp){flush_trailing();}, this);
+}
+
+void BasicExchangeContext::flush_trailing() {
+    if (post_to_io([this]{flush_trailing();})) return;
+    std::lock_guard _(_mx);
+    _trailing_wakeup = Timestamp::max();
+    Timestamp now = _clock();
+    _subscriptions.for_each([&](const Instrument &i, InstrumentSubscriptions &subs) {
+        for (int t = 0; t < 2; ++t) {
+            for (Subscriber &sb: subs.lists[t].targets) {
+                if (!sb.trailing) continue;
+                Timestamp tp = sb.last_event + sb.policy.interval;
+                if (tp > now) {
+                    schedule_trailing(tp);
+                } else {
+                    sb.trailing = false;
+                    sb.last_event = now;
+                    sb.target->on_event(i, static_cast<SubscriptionType>(t));
+                }
+            }
+        }
+    });
+}
+
 void BasicExchangeContext::disconnect(const IEventTarget *target) {
     std::lock_guard _(_mx);
-    for (auto iter = _subscriptions.begin(); iter != _subscriptions.end(); ++iter) {
-        if (iter->first.target == target) iter = _subscriptions.erase(iter);
-    }
+    _subscriptions.for_each([&](const Instrument &, InstrumentSubscriptions &subs) {
+        for (auto &lst: subs.lists) lst.remove(target);
+    });
     for (auto &[k,lst]: _account_update_waiting) {
         lst.erase(std::remove(lst.begin(), lst.end(), target), lst.end());
     }
     for (auto &[k,lst]: _instrument_update_waiting) {
         lst.erase(std::remove(lst.begin(), lst.end(), target), lst.end());
     }
+    _orders.erase_if([&](const OrderRegistry::Entry &e){return e.target == target;});
 }
 
 void BasicExchangeContext::batch_place(IEventTarget *target, std::span<Order> orders) {
@@ -171,37 +304,125 @@ void BasicExchangeContext::batch_place(IEventTarget *target, std::span<Order> or
 }
 
 void BasicExchangeContext::batch_cancel(std::span<Order> orders) {
+    std::lock_guard _(_mx);
+    for (auto &o: orders) o = exchange_order(o);
     _ptr->batch_cancel(orders);
 }
+
+Timestamp BasicExchangeContext::batch(IEventTarget *target, std::span<Order> cancels, std::span<const PlaceRequest> places, Timestamp now) {
+    std::lock_guard _(_mx);
+    if (!_throttle.enabled() && _throttle.empty()) {
+        if (!cancels.empty()) batch_cancel(cancels);
+        if (!places.empty()) {
+            std::vector<Order> orders;
+            orders.reserve(places.size());
+            for (const auto &p: places) orders.push_back(p.order);
+            batch_place(target, orders);
+        }
+        return Timestamp::max();
+    }
+    for (const auto &c: cancels) _throttle.cancel(exchange_order(c));
+    for (const auto &p: places) {
+        _orders.emplace(p.order, target);
+        _throttle.place({p.order, exchange_order(p.replaces), p.amend});
+    }
+    dispatch_throttled(now);
+    return _throttle_result.next;
+}
+
+void BasicExchangeContext::dispatch_throttled(Timestamp now) {
+    auto &res = _throttle_result;
+    _throttle.dispatch(now, res);
+    std::vector<Order> cancels;
+    std::vector<Order> places;
+    for (auto &r: res.send) {
+        if (r.cancel) {
+            cancels.push_back(r.order);
+        } else if (!r.rewritten) {
+            places.push_back(r.order);
+        } else {
+            const auto &setup = r.order.get_setup();
+            Order n = r.replaces?_ptr->create_order_replace(r.replaces, setup, r.amend)
+                                :_ptr->create_order(r.order.get_instrument(), r.order.get_account(), setup);
+            auto e = _orders.find(r.order);
+            if (!e) continue;
+            IEventTarget *target = e->target;
+            _orders.erase(e);
+            if (n.discarded()) {
+                target->on_event(r.order, Order::Report{n.get_state(), n.get_reason(), std::string(n.get_message())});
+                //the predecessor was requested to be canceled or replaced
+                if (r.replaces) cancels.push_back(r.replaces);
+                continue;
+            }
+            _orders.set_alias(_orders.emplace(n, target).first, r.order);
+            places.push_back(n);
+        }
+    }
+    if (!cancels.empty()) _ptr->batch_cancel(cancels);
+    if (!places.empty()) _ptr->batch_place(places);
+    for (const auto &o: res.dropped) {
+        order_state_changed(o, {Order::State::canceled, Order::Reason::no_reason, {}});
+    }
+}
+
+void BasicExchangeContext::set_order_throttle(const OrderThrottle::Config &cfg) {
+    std::lock_guard _(_mx);
+    _throttle.set_config(cfg);
+}
+
+OrderThrottle::Stats BasicExchangeContext::get_order_throttle_stats() const {
+    std::lock_guard _(_mx);
+    return _throttle.get_stats();
+}
 void BasicExchangeContext::restore_orders(IEventTarget *target, std::span<SerializedOrder> orders) {
     _ptr->restore_orders(target, orders);
 }
 
 void BasicExchangeContext::order_state_changed(const Order &order, const Order::Report &report) {
+    if (post_to_io([=, this]{order_state_changed(order, report);})) return;
     std::lock_guard _(_mx);
-    auto iter= _orders.find(order);
-    if (iter != _orders.end()) {
-        iter->second->on_event(iter->first, report);
+    auto e = _orders.find(order);
+    if (e) {
+        e->target->on_event(e->alias?e->alias:e->order, report);
         if (IOrder::is_done(report.new_state)) {
-            _orders.erase(iter);
+            _orders.erase(e);
         }
     }
 }
 
 void BasicExchangeContext::order_fill(const Order &order, const Fill &fill) {
+    if (post_to_io([=, this]{order_fill(order, fill);})) return;
     std::lock_guard _(_mx);
-    auto iter= _orders.find(order);
-    if (iter != _orders.end()) {
-        iter->second->on_event(iter->first, fill);
+    auto e = _orders.find(order);
+    if (e) {
+        e->target->on_event(e->alias?e->alias:e->order, fill);
     }
 
 }
 
 void BasicExchangeContext::order_restore(void *target, const Order &order) {
+    std::lock_guard _(_mx);
     _orders.emplace(order, reinterpret_cast<IEventTarget *>(target));
 
 }
 
+void BasicExchangeContext::bind_order_id(const Order &order, std::string_view id) {
+    std::lock_guard _(_mx);
+    auto e = _orders.find(order);
+    if (e) _orders.set_id(e, id);
+}
+
+Exchange BasicExchangeContext::get_exchange() const {
+    auto ex = _exchange.lock();
+    return ex?Exchange(ex):Exchange();
+}
+
+Order BasicExchangeContext::find_order(std::string_view id) const {
+    std::lock_guard _(_mx);
+    auto e = _orders.find(id);
+    return e?e->order:Order();
+}
+
 BasicExchangeContext &BasicExchangeContext::from_exchange(Exchange ex) {
     const IExchange *e = ex.get_handle().get();
     const BasicExchange *be = dynamic_cast<const BasicExchange *>(e);
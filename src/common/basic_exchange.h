@@ -4,6 +4,12 @@
 #include "../trading_ifc/exchange_service.h"
 
 #include "event_target.h"
+#include "last_value_cache.h"
+#include "dense_map.h"
+#include "io_thread.h"
+#include "order_throttle.h"
+#include "order_registry.h"
+#include "context_scheduler.h"
 #include <map>
 #include <set>
 
@@ -12,9 +18,42 @@ namespace trading_api {
 class BasicExchangeContext: public IExchangeContext {
 public:
 
+    ~BasicExchangeContext();
 
     void init(std::unique_ptr<IExchangeService> svc, StrategyConfig configuration);
 
+    ///Start dedicated I/O thread
+    /**
+     * When I/O thread is running, all callbacks from the exchange service
+     * (income_data, object_updated, order_state_changed, order_fill) are
+     * executed in this thread. The calling thread only posts the callback, so
+     * it is never blocked by strategies. The strategy contexts receive events
+     * from the I/O thread through single-producer/single-consumer queues
+     *
+     * @note must be called before strategies are initialized
+     */
+    void start_io_thread();
+
+    ///Retrieve I/O thread
+    /**
+     * @return pointer to I/O thread or nullptr if not started
+     */
+    const IOThread *get_io_thread() const {return _io.get();}
+
+    ///Set clock used to throttle subscriptions
+    /**
+     * @param clock function returns current time. Default clock is system clock.
+     * Simulations should pass simulated time
+     */
+    void set_clock(Function<Timestamp()> clock);
+
+    ///Set scheduler used to deliver trailing updates of throttled subscriptions
+    /**
+     * @param scheduler scheduler. Default scheduler runs in its own thread.
+     * Simulations should pass simulated scheduler
+     */
+    void set_scheduler(ContextSchedulerGeneric scheduler);
+
 
     ///Disconnect given event target
     /**
@@ -51,8 +90,11 @@ public:
      * @param target object which consumes updates
      * @param sbstype type of subscription
      * @param instrument instrument which is subscribed
+     * @param policy delivery policy. If the target is already subscribed,
+     * the policy is changed
      */
-    void subscribe(IEventTarget *target, SubscriptionType sbstype, const Instrument &instrument);
+    void subscribe(IEventTarget *target, SubscriptionType sbstype, const Instrument &instrument,
+                   const SubscriptionPolicy &policy = {});
     ///Unsubscribe stream
     /**
      * @param target object which consumes updates
@@ -74,7 +116,8 @@ public:
 
     ///Create order instance which replaces other order - don't place order yet
     /**
-     * @param replace order to replace
+     * @param replace order to replace. If the order was merged by the throttle, the
+     * order on the exchange is replaced
      * @param setup order setup
      * @param amend try to amend order
      * @return pointer to newly created order. In case of error, discarded order must be created
@@ -93,9 +136,37 @@ public:
 
     ///Cancel orders in batch
     /**
-     * @param orders list of orders to cancel
+     * @param orders list of orders to cancel. Orders merged by the throttle are
+     * replaced by the orders on the exchange
      */
     void batch_cancel(std::span<Order> orders);
+
+    ///Cancel and place orders through the order throttle
+    /**
+     * If the throttle is disabled, function calls batch_cancel() and batch_place().
+     * Otherwise requests are enqueued, merged and sent as the rate limit allows.
+     * Orders removed by merging are reported to their targets as canceled. Orders
+     * which were merged earlier are canceled or replaced on the exchange as the
+     * orders which were sent instead of them
+     *
+     * @param target event target where placed orders belongs
+     * @param cancels orders to cancel
+     * @param places orders to place
+     * @param now current time
+     * @return time when the function must be called again (with empty lists)
+     * to send deferred requests. Returns Timestamp::max() if nothing is deferred
+     */
+    Timestamp batch(IEventTarget *target, std::span<Order> cancels, std::span<const PlaceRequest> places, Timestamp now);
+
+    ///Set order rate limit of this exchange
+    /**
+     * @param cfg configuration of the throttle. Default configuration (rate = 0)
+     * disables the throttle
+     */
+    void set_order_throttle(const OrderThrottle::Config &cfg);
+
+    ///Retrieve statistics of the order throttle
+    OrderThrottle::Stats get_order_throttle_stats() const;
     ///Request update of ticker
     /**
      * You can request update of a current ticker in case that your strategy doesn't
@@ -139,6 +210,8 @@ public:
 
     ///Retrieve last ticker synchronously
     /**
+     * Function doesn't lock the object, so it never contends with incoming data
+     *
      * @param instrument instrument object
      * @param tk variable which receives ticker
      * @retval true received
@@ -149,6 +222,8 @@ public:
 
     ///Retrieve last orderbook state synchronously
     /**
+     * Function doesn't lock the object, so it never contends with incoming data
+     *
      * @param instrument instrument object
      * @param ordb variable which receives orderbook
      * @retval true received
@@ -202,28 +277,64 @@ public:
 protected:
 
     ///Object's lock, derived class must use this lock to lock internals
-    std::recursive_mutex _mx;
+    mutable std::recursive_mutex _mx;
 
-    struct Subscription {
-        SubscriptionType type;
-        Instrument i;
+    ///Target subscribed to a stream
+    struct Subscriber {
         IEventTarget *target;
+        SubscriptionPolicy policy;
+        ///conflate: set while the target has not processed the event
+        std::shared_ptr<std::atomic<bool> > pending = {};
+        ///throttle: time of last event, Timestamp::min() - no event yet
+        Timestamp last_event = Timestamp::min();
+        ///throttle: update arrived during the interval, it is delivered at the end
+        bool trailing = false;
+        ///top_of_book: top of book of last event
+        Ticker top = {};
+    };
 
-        bool operator==(const Subscription &) const = default;
-        std::strong_ordering operator<=>(const Subscription &) const = default;
+    ///Targets subscribed to single stream
+    struct SubscriptionList {
+        ///targets which receive updates according to their policy
+        std::vector<Subscriber> targets;
+        ///targets which receive next update only
+        std::vector<IEventTarget *> onceshot;
+
+        bool empty() const {return targets.empty() && onceshot.empty();}
+        bool contains(const IEventTarget *target) const;
+        void remove(const IEventTarget *target);
     };
 
-    enum class SubscriptionLimit {
-        onceshot,
-        unlimited
+    ///Subscriptions of an instrument, indexed by SubscriptionType
+    struct InstrumentSubscriptions {
+        SubscriptionList lists[2];
+        SubscriptionList &operator[](SubscriptionType type) {return lists[static_cast<int>(type)];}
     };
 
-    std::map<Instrument, Ticker> _tickers;
-    std::map<Instrument, OrderBook> _orderbooks;
-    std::map<Subscription, SubscriptionLimit> _subscriptions;
+    ///last tickers and orderbooks, readable without lock
+    LastValueCache _last_values;
+    ///orderbooks maintained from incoming updates
+    DenseMap<Instrument, OrderBook> _orderbooks;
+    DenseMap<Instrument, InstrumentSubscriptions> _subscriptions;
     std::map<Instrument, std::vector<IEventTarget *> > _instrument_update_waiting;
     std::map<Account, std::vector<IEventTarget *> > _account_update_waiting;
-    std::map<Order, IEventTarget *, std::less<> > _orders;
+    ///live orders, orders created by the throttle have alias to order known by strategy
+    OrderRegistry _orders;
+    OrderThrottle _throttle;
+    Function<Timestamp()> _clock = []{return std::chrono::system_clock::now();};
+    ContextSchedulerGeneric _scheduler = create_scheduler();
+    ///time when trailing updates are delivered, Timestamp::max() if none is scheduled
+    Timestamp _trailing_wakeup = Timestamp::max();
+    OrderThrottle::Result _throttle_result;
+
+    ///Retrieve order on the exchange
+    /**
+     * @param order order known by the target
+     * @return order on the exchange which has the order as alias (created by
+     * the throttle), otherwise the order itself
+     * @note must be called under lock
+     */
+    Order exchange_order(const Order &order) const;
 
 
     ///call this function when ticker for given instrument arrived
@@ -238,6 +349,13 @@ protected:
      * @param o orderbook
      */
     virtual void income_data(const Instrument &i, const OrderBook &o) override;
+    ///call this function when orderbook changes arrived
+    /**
+     * @param i instrument
+     * @param updates list of updates
+     * @param snapshot updates contain whole orderbook
+     */
+    virtual void income_data(const Instrument &i, std::span<const OrderBook::Update> updates, bool snapshot) override;
     ///call this function when account is updated
     virtual void object_updated(const Account &i) override;
     ///call this function when instrument is updated
@@ -266,12 +384,30 @@ protected:
      * @param order restored order instance
      */
     virtual void order_restore(void *target, const Order &order) override;
+    ///call this function when exchange assigned ID to the order
+    virtual void bind_order_id(const Order &order, std::string_view id) override;
+    ///find order by exchange's order ID
+    virtual Order find_order(std::string_view id) const override;
+    ///retrieve exchange object which owns this context
+    virtual Exchange get_exchange() const override;
 
 private:
-    void send_subscription_notify(const Instrument &i, SubscriptionType type);
+    void send_subscription_notify(const Instrument &i, SubscriptionType type, const Ticker &top);
+    void dispatch_throttled(Timestamp now);
+    ///schedule delivery of trailing updates (must be locked)
+    void schedule_trailing(Timestamp tp);
+    ///deliver trailing updates of throttled subscriptions
+    void flush_trailing();
+    ///returns true if function has been posted to I/O thread
+    template<typename Fn>
+    bool post_to_io(Fn &&fn);
 
     std::unique_ptr<IExchangeService> _ptr;
+    std::unique_ptr<IOThread> _io;
+    ///exchange object which owns this context (see BasicExchange::create)
+    std::weak_ptr<const IExchange> _exchange;
 
+    friend class BasicExchange;
 };
 
 
@@ -281,6 +417,19 @@ public:
     BasicExchange(std::unique_ptr<BasicExchangeContext> impl, std::string label)
         :_impl(std::move(impl)),_label(label) {}
 
+    ///Create exchange object and bind it with the context
+    /**
+     * @param impl exchange context
+     * @param label label of exchange
+     * @return exchange object. The context can return it through get_exchange()
+     */
+    static Exchange create(std::unique_ptr<BasicExchangeContext> impl, std::string label) {
+        BasicExchangeContext *ctx = impl.get();
+        auto ex = std::make_shared<BasicExchange>(std::move(impl), std::move(label));
+        ctx->_exchange = ex;
+        return Exchange(ex);
+    }
+
     virtual std::string get_label() const override {return _label;};
     virtual std::string get_name() const override {
         return _impl->get_name();
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../trading_ifc/timer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace trading_api {
+
+///Writes values into compact binary buffer
+/**
+ * Values are stored in native byte order without any padding. The format
+ * is intended for state snapshots, which are read back by the same build
+ */
+class BinaryWriter {
+public:
+
+    ///write trivially copyable value
+    template<typename T>
+    requires(std::is_trivially_copyable_v<T>)
+    void write(const T &val) {
+        _buffer.append(reinterpret_cast<const char *>(&val), sizeof(val));
+    }
+
+    ///write size or count
+    void write_size(std::size_t sz) {
+        write(static_cast<std::uint64_t>(sz));
+    }
+
+    ///write string (length + content)
+    void write(std::string_view str) {
+        write_size(str.size());
+        _buffer.append(str);
+    }
+
+    void write(const std::string &str) {
+        write(std::string_view(str));
+    }
+
+    ///write timestamp (nanoseconds since epoch)
+    void write(const Timestamp &tp) {
+        write(static_cast<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count()));
+    }
+
+    ///retrieve written data
+    std::string_view get_data() const {return _buffer;}
+
+    void clear() {_buffer.clear();}
+
+protected:
+    std::string _buffer;
+};
+
+///Reads values written by BinaryWriter
+class BinaryReader {
+public:
+
+    BinaryReader(std::string_view data):_data(data) {}
+
+    ///read trivially copyable value
+    /**
+     * @exception std::runtime_error unexpected end of data
+     */
+    template<typename T>
+    requires(std::is_trivially_copyable_v<T>)
+    T read() {
+        T val;
+        std::memcpy(&val, take(sizeof(val)).data(), sizeof(val));
+        return val;
+    }
+
+    std::size_t read_size() {
+        return static_cast<std::size_t>(read<std::uint64_t>());
+    }
+
+    std::string read_string() {
+        return std::string(take(read_size()));
+    }
+
+    ///read block of raw data
+    /**
+     * @param sz size of the block
+     * @return view to the data
+     */
+    std::string_view read_block(std::size_t sz) {
+        return take(sz);
+    }
+
+    Timestamp read_timestamp() {
+        return Timestamp(std::chrono::duration_cast<TimeSpan>(
+                std::chrono::nanoseconds(read<std::int64_t>())));
+    }
+
+    ///returns true, if all data has been read
+    bool eof() const {return _data.empty();}
+
+protected:
+    std::string_view _data;
+
+    std::string_view take(std::size_t sz) {
+        if (sz > _data.size()) throw std::runtime_error("BinaryReader: unexpected end of data");
+        auto out = _data.substr(0, sz);
+        _data = _data.substr(sz);
+        return out;
+    }
+};
+
+}
@@ -0,0 +1,64 @@
+#include "checkpoint.h"
+
+#include <fstream>
+#include <cstdio>
+#include <iterator>
+
+namespace trading_api {
+
+static constexpr std::uint32_t checkpoint_magic = 0x504B4354;   //"TCKP"
+static constexpr std::uint32_t checkpoint_version = 2;
+
+void save_checkpoint(const std::string &pathname, Timestamp time,
+        std::span<const ICheckpointable * const> objects) {
+    BinaryWriter hdr;
+    hdr.write(checkpoint_magic);
+    hdr.write(checkpoint_version);
+    hdr.write(time);
+    hdr.write_size(objects.size());
+
+    std::string tmpname = pathname + ".tmp";
+    std::ofstream out(tmpname, std::ios::out|std::ios::trunc|std::ios::binary);
+    if (!out) throw std::runtime_error("Unable to create file: " + tmpname);
+    out.write(hdr.get_data().data(), hdr.get_data().size());
+    BinaryWriter section;
+    for (const ICheckpointable *obj: objects) {
+        section.clear();
+        obj->save_state(section);
+        std::uint64_t sz = section.get_data().size();
+        out.write(reinterpret_cast<const char *>(&sz), sizeof(sz));
+        out.write(section.get_data().data(), section.get_data().size());
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write file: " + tmpname);
+    //replace previous checkpoint atomically
+    if (std::rename(tmpname.c_str(), pathname.c_str()) != 0) {
+        throw std::runtime_error("Unable to rename file: " + tmpname);
+    }
+}
+
+Timestamp load_checkpoint(const std::string &pathname,
+        std::span<ICheckpointable * const> objects) {
+    std::ifstream in(pathname, std::ios::in|std::ios::binary);
+    if (!in) throw std::runtime_error("Unable to open file: " + pathname);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    BinaryReader rd(data);
+    if (rd.read<std::uint32_t>() != checkpoint_magic
+            || rd.read<std::uint32_t>() != checkpoint_version) {
+        throw std::runtime_error("Invalid checkpoint file: " + pathname);
+    }
+    Timestamp time = rd.read_timestamp();
+    if (rd.read_size() != objects.size()) {
+        throw std::runtime_error("Checkpoint doesn't match the simulation: " + pathname);
+    }
+    for (ICheckpointable *obj: objects) {
+        BinaryReader section(rd.read_block(rd.read_size()));
+        obj->load_state(section);
+        if (!section.eof()) {
+            throw std::runtime_error("Checkpoint doesn't match the simulation: " + pathname);
+        }
+    }
+    return time;
+}
+
+}
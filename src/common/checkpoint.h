@@ -0,0 +1,54 @@
+#pragma once
+
+#include "binary_stream.h"
+
+#include <span>
+#include <string>
+
+namespace trading_api {
+
+///Object which state can be stored in a checkpoint
+class ICheckpointable {
+public:
+    virtual ~ICheckpointable() = default;
+
+    ///Store state of the object
+    /**
+     * @param wr writer
+     */
+    virtual void save_state(BinaryWriter &wr) const = 0;
+
+    ///Restore state of the object
+    /**
+     * The object must be constructed and initialized the same way as
+     * the object which state was saved.
+     *
+     * @param rd reader
+     * @exception std::runtime_error invalid or incompatible data
+     */
+    virtual void load_state(BinaryReader &rd) = 0;
+};
+
+///Save checkpoint to a file
+/**
+ * @param pathname pathname of target file
+ * @param time current simulation time (time of the scheduler)
+ * @param objects objects to store. Every object is stored in separate section
+ * @exception std::runtime_error unable to write file
+ */
+void save_checkpoint(const std::string &pathname, Timestamp time,
+        std::span<const ICheckpointable * const> objects);
+
+///Load checkpoint from a file
+/**
+ * @param pathname pathname of source file
+ * @param objects objects to restore. Must be the same list (in the same order)
+ * as used to save checkpoint
+ * @return simulation time stored in the checkpoint. The caller should set time
+ * of the scheduler to this value
+ * @exception std::runtime_error unable to read file or invalid format
+ */
+Timestamp load_checkpoint(const std::string &pathname,
+        std::span<ICheckpointable * const> objects);
+
+}
@@ -52,6 +52,24 @@ public:
         _cur_time =  std::max(_cur_time,tp);
     }
 
+    Timestamp get_time() const {
+        return _cur_time;
+    }
+
+    std::optional<Timestamp> get_next_event() const {
+        if (_queue.empty()) return {};
+        return _queue.front().tp;
+    }
+
+    bool advance() {
+        if (_queue.empty()) return false;
+        auto fn = std::move(_queue.front().fn);
+        _cur_time = std::max(_cur_time,_queue.front().tp);
+        _queue.pop();
+        fn(_cur_time);
+        return true;
+    }
+
 protected:
 
 
@@ -66,6 +84,21 @@ void ManualContextScheduler::set_time(Timestamp tp) {
     _scheduler->set_time(tp);
 }
 
+Timestamp ManualContextScheduler::get_time() const {
+    return _scheduler->get_time();
+}
+
+std::optional<Timestamp> ManualContextScheduler::get_next_event() const {
+    return _scheduler->get_next_event();
+}
+
+bool ManualContextScheduler::advance() {
+    return _scheduler->advance();
+}
+
+
+template<typename SchedulerType>
+ContextScheduler<SchedulerType>::~ContextScheduler() = default;
 
 template<typename SchedulerType>
 void ContextScheduler<SchedulerType>::operator ()(Timestamp tm, Function<void(Timestamp)> fn, const void *ident) {
@@ -111,7 +144,7 @@ public:
         if (_thr.get_id() == std::this_thread::get_id()) {
             this_instance = nullptr;
             _thr.detach();
-        } else {
+        } else if (_thr.joinable()) {
             _thr.join();
         }
     }
@@ -168,7 +201,7 @@ public:
 };
 
 SingleThreadContextScheduler create_scheduler() {
-    return std::shared_ptr<SingleThreadScheduler>();
+    return std::make_shared<SingleThreadScheduler>();
 }
 
 template<typename Executor>
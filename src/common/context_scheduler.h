@@ -6,6 +6,7 @@
 
 #include <mutex>
 #include <functional>
+#include <optional>
 #include <condition_variable>
 
 namespace trading_api {
@@ -33,6 +34,22 @@ class ManualControlScheduler;
 class ManualContextScheduler: public ContextScheduler<ManualControlScheduler> {
 public:
     void set_time(Timestamp tp);
+
+    ///Retrieve current time
+    Timestamp get_time() const;
+
+    ///Retrieve time of next scheduled event
+    /**
+     * @return time of next event, or no value if there is no scheduled event
+     */
+    std::optional<Timestamp> get_next_event() const;
+
+    ///Jump directly to next scheduled event and process it
+    /**
+     * @retval true event processed
+     * @retval false no event is scheduled
+     */
+    bool advance();
 };
 using SingleThreadContextScheduler = ContextScheduler<SingleThreadScheduler>;
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+namespace trading_api {
+
+///Map implemented as array indexed by dense index of the key
+/**
+ * Lookup is a single array access. The key must provide get_index()
+ * (Instrument, Account). Memory usage is proportional to the highest index,
+ * which is small, because indexes are dense
+ *
+ * @tparam Key key type
+ * @tparam Value value type
+ */
+template<typename Key, typename Value>
+class DenseMap {
+public:
+
+    ///Access value, create new one if doesn't exist
+    Value &operator[](const Key &k) {
+        auto idx = k.get_index();
+        if (idx >= _items.size()) _items.resize(idx+1);
+        auto &item = _items[idx];
+        if (!item.has_value()) {
+            item.emplace(Entry{k, Value()});
+            ++_count;
+        }
+        return item->value;
+    }
+
+    ///Find value
+    /**
+     * @param k key
+     * @return pointer to value or nullptr if not found
+     */
+    Value *find(const Key &k) {
+        auto idx = k.get_index();
+        if (idx >= _items.size() || !_items[idx].has_value()) return nullptr;
+        return &_items[idx]->value;
+    }
+
+    const Value *find(const Key &k) const {
+        auto idx = k.get_index();
+        if (idx >= _items.size() || !_items[idx].has_value()) return nullptr;
+        return &_items[idx]->value;
+    }
+
+    ///Erase value
+    /**
+     * @param k key
+     * @retval true erased
+     * @retval false not found
+     */
+    bool erase(const Key &k) {
+        auto idx = k.get_index();
+        if (idx >= _items.size() || !_items[idx].has_value()) return false;
+        _items[idx].reset();
+        --_count;
+        return true;
+    }
+
+    ///Call function for every item
+    /**
+     * @param fn function receives key and value
+     */
+    template<typename Fn>
+    void for_each(Fn &&fn) {
+        for (auto &item: _items) if (item.has_value()) fn(item->key, item->value);
+    }
+
+    template<typename Fn>
+    void for_each(Fn &&fn) const {
+        for (const auto &item: _items) if (item.has_value()) fn(item->key, item->value);
+    }
+
+    ///count of items
+    std::size_t size() const {return _count;}
+    bool empty() const {return _count == 0;}
+
+    void clear() {
+        _items.clear();
+        _count = 0;
+    }
+
+protected:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+
+    std::vector<std::optional<Entry> > _items;
+    std::size_t _count = 0;
+};
+
+}
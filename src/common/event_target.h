@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <memory>
 
 #include "../trading_ifc/instrument.h"
@@ -57,6 +58,20 @@ public:
      */
     virtual void on_event(const Instrument &i, SubscriptionType subscription_type) = 0;
 
+    ///called when subscription update of conflated subscription
+    /**
+     * @param i instrument
+     * @param subscription_type type of subscription
+     * @param pending flag set by the exchange. The target must clear the flag
+     * before it reads the market data. Until the flag is cleared, no more
+     * events are generated for the subscription
+     */
+    virtual void on_event(const Instrument &i, SubscriptionType subscription_type,
+            std::shared_ptr<std::atomic<bool> > pending) {
+        pending->store(false, std::memory_order_release);
+        on_event(i, subscription_type);
+    }
+
     ///called when order state changed
     virtual void on_event(const Order &order,const Order::Report &report) = 0;
 
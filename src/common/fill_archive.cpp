@@ -0,0 +1,617 @@
+#include "fill_archive.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trading_api {
+
+namespace {
+
+void write_varint(std::string &out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+class ColumnReader {
+public:
+    explicit ColumnReader(std::string_view data):_data(data) {}
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        int shift = 0;
+        while (true) {
+            if (_pos >= _data.size()) throw std::runtime_error("FillArchive: damaged block");
+            auto c = static_cast<unsigned char>(_data[_pos++]);
+            v |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return v;
+            shift += 7;
+        }
+    }
+
+    std::string_view bytes(std::size_t sz) {
+        if (sz > _data.size() - _pos) throw std::runtime_error("FillArchive: damaged block");
+        auto out = _data.substr(_pos, sz);
+        _pos += sz;
+        return out;
+    }
+
+protected:
+    std::string_view _data;
+    std::size_t _pos = 0;
+};
+
+///writes bits, most significant first
+class BitWriter {
+public:
+    explicit BitWriter(std::string &out):_out(out) {}
+
+    void write(std::uint64_t v, int bits) {
+        while (bits > 0) {
+            int space = 8 - _used;
+            int n = std::min(space, bits);
+            auto chunk = static_cast<unsigned>((v >> (bits - n)) & ((1U << n) - 1));
+            _cur = static_cast<unsigned char>(_cur | (chunk << (space - n)));
+            _used += n;
+            bits -= n;
+            if (_used == 8) {
+                _out.push_back(static_cast<char>(_cur));
+                _cur = 0;
+                _used = 0;
+            }
+        }
+    }
+
+    void flush() {
+        if (_used) _out.push_back(static_cast<char>(_cur));
+        _cur = 0;
+        _used = 0;
+    }
+
+protected:
+    std::string &_out;
+    unsigned char _cur = 0;
+    int _used = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(std::string_view data):_data(data) {}
+
+    std::uint64_t read(int bits) {
+        std::uint64_t v = 0;
+        while (bits > 0) {
+            std::size_t byte = _pos >> 3;
+            if (byte >= _data.size()) throw std::runtime_error("FillArchive: damaged block");
+            int offset = static_cast<int>(_pos & 7);
+            int n = std::min(8 - offset, bits);
+            auto c = static_cast<unsigned char>(_data[byte]);
+            v = (v << n) | ((c >> (8 - offset - n)) & ((1U << n) - 1));
+            _pos += static_cast<std::size_t>(n);
+            bits -= n;
+        }
+        return v;
+    }
+
+protected:
+    std::string_view _data;
+    std::size_t _pos = 0;
+};
+
+constexpr double decimal_scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+///find decimal scale which represents all values exactly as integers
+/**
+ * @return scale index, or -1 if there is no such scale. Negative zero is
+ * never accepted, because it can't be stored as an integer
+ */
+template<typename Fn>
+int find_decimal_scale(std::size_t count, Fn &&get) {
+    for (int k = 0; k < static_cast<int>(std::size(decimal_scale)); ++k) {
+        bool ok = true;
+        for (std::size_t i = 0; ok && i < count; ++i) {
+            double v = get(i);
+            double r = std::round(v * decimal_scale[k]);
+            //-0.0 passes the bit check, but integer zero has no sign
+            ok = std::abs(r) < 9007199254740992.0 && !(r == 0 && std::signbit(v))
+                    && std::bit_cast<std::uint64_t>(r / decimal_scale[k]) == std::bit_cast<std::uint64_t>(v);
+        }
+        if (ok) return k;
+    }
+    return -1;
+}
+
+///compression of doubles
+/**
+ * Prices and amounts are mostly decimal numbers with few digits. When all values of
+ * the block are exactly representable as integer / 10^k, they are stored as
+ * differences of the integers (varint). Otherwise XOR with previous value
+ * is used (Gorilla)
+ */
+template<typename Fn>
+void encode_doubles(std::string &out, std::size_t count, Fn &&get) {
+    int k = find_decimal_scale(count, get);
+    out.push_back(static_cast<char>(k));
+    if (k >= 0) {
+        std::int64_t prev = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto r = static_cast<std::int64_t>(std::round(get(i) * decimal_scale[k]));
+            write_varint(out, zigzag(r - prev));
+            prev = r;
+        }
+        return;
+    }
+    BitWriter wr(out);
+    std::uint64_t prev = std::bit_cast<std::uint64_t>(get(0));
+    wr.write(prev, 64);
+    int lead = -1;
+    int trail = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        std::uint64_t cur = std::bit_cast<std::uint64_t>(get(i));
+        std::uint64_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            wr.write(0, 1);
+            continue;
+        }
+        wr.write(1, 1);
+        int l = std::min(std::countl_zero(x), 31);
+        int t = std::countr_zero(x);
+        if (lead >= 0 && l >= lead && t >= trail) {
+            //meaningful bits fit into previous window
+            wr.write(0, 1);
+            wr.write(x >> trail, 64 - lead - trail);
+        } else {
+            int len = 64 - l - t;
+            wr.write(1, 1);
+            wr.write(static_cast<std::uint64_t>(l), 5);
+            wr.write(static_cast<std::uint64_t>(len - 1), 6);
+            wr.write(x >> t, len);
+            lead = l;
+            trail = t;
+        }
+    }
+    wr.flush();
+}
+
+void decode_doubles(std::string_view data, std::size_t count, std::vector<double> &out) {
+    out.resize(count);
+    if (!count) return;
+    if (data.empty()) throw std::runtime_error("FillArchive: damaged block");
+    int k = static_cast<signed char>(data[0]);
+    data = data.substr(1);
+    if (k >= static_cast<int>(std::size(decimal_scale))) throw std::runtime_error("FillArchive: damaged block");
+    if (k >= 0) {
+        ColumnReader rd(data);
+        std::int64_t prev = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            prev += unzigzag(rd.varint());
+            out[i] = static_cast<double>(prev) / decimal_scale[k];
+        }
+        return;
+    }
+    BitReader rd(data);
+    std::uint64_t prev = rd.read(64);
+    out[0] = std::bit_cast<double>(prev);
+    int lead = 0;
+    int trail = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        if (rd.read(1)) {
+            if (rd.read(1)) {
+                lead = static_cast<int>(rd.read(5));
+                int len = static_cast<int>(rd.read(6)) + 1;
+                trail = 64 - lead - len;
+                if (trail < 0) throw std::runtime_error("FillArchive: damaged block");
+            }
+            prev ^= rd.read(64 - lead - trail) << trail;
+        }
+        out[i] = std::bit_cast<double>(prev);
+    }
+}
+
+///parse id, which is decimal number in canonical form (it is restored exactly)
+std::optional<std::uint64_t> parse_numeric_id(std::string_view id) {
+    if (id.empty() || id.size() > 18 || (id[0] == '0' && id.size() > 1)) return {};
+    std::uint64_t v;
+    auto r = std::from_chars(id.data(), id.data() + id.size(), v);
+    if (r.ec != std::errc() || r.ptr != id.data() + id.size()) return {};
+    return v;
+}
+
+std::int64_t to_ns(Timestamp tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+[[noreturn]] void throw_errno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+Fill FillArchive::Columns::get_fill(std::size_t i) const {
+    Fill f;
+    f.time = Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::nanoseconds(time[i])));
+    f.id = id[i];
+    f.label = labels[label[i]];
+    f.price = price[i];
+    f.amount = amount[i];
+    f.fees = fees[i];
+    return f;
+}
+
+FillArchiveWriter::FillArchiveWriter(std::size_t block_size):_block_size(std::max<std::size_t>(block_size, 1)) {}
+
+void FillArchiveWriter::append(const Fill &fill) {
+    _pending.push_back(fill);
+    if (_pending.size() >= _block_size) write_block();
+}
+
+void FillArchiveWriter::write_block() {
+    if (_pending.empty()) return;
+    if (_out.empty()) {
+        _out.append(reinterpret_cast<const char *>(&FillArchive::magic), 4);
+        _out.append(reinterpret_cast<const char *>(&FillArchive::version), 4);
+    }
+    std::size_t count = _pending.size();
+    std::string columns[6];
+
+    //time - deltas divided by common divisor
+    std::int64_t first = to_ns(_pending[0].time);
+    std::int64_t min_time = first;
+    std::int64_t max_time = first;
+    std::uint64_t unit = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        std::int64_t d = to_ns(_pending[i].time) - to_ns(_pending[i-1].time);
+        unit = std::gcd(unit, static_cast<std::uint64_t>(d < 0?-d:d));
+    }
+    if (!unit) unit = 1;
+    write_varint(columns[0], zigzag(first));
+    write_varint(columns[0], unit);
+    for (std::size_t i = 1; i < count; ++i) {
+        std::int64_t t = to_ns(_pending[i].time);
+        min_time = std::min(min_time, t);
+        max_time = std::max(max_time, t);
+        write_varint(columns[0], zigzag((t - to_ns(_pending[i-1].time)) / static_cast<std::int64_t>(unit)));
+    }
+
+    //id - numeric ids as differences, others front coded
+    bool numeric = std::all_of(_pending.begin(), _pending.end(), [](const Fill &f) {
+        return parse_numeric_id(f.id).has_value();
+    });
+    columns[1].push_back(static_cast<char>(numeric));
+    std::int64_t prev_num = 0;
+    std::string_view prev;
+    for (const Fill &f: _pending) {
+        if (numeric) {
+            auto n = static_cast<std::int64_t>(*parse_numeric_id(f.id));
+            write_varint(columns[1], zigzag(n - prev_num));
+            prev_num = n;
+            continue;
+        }
+        std::size_t shared = 0;
+        std::size_t lim = std::min(prev.size(), f.id.size());
+        while (shared < lim && prev[shared] == f.id[shared]) ++shared;
+        write_varint(columns[1], shared);
+        write_varint(columns[1], f.id.size() - shared);
+        columns[1].append(f.id, shared);
+        prev = f.id;
+    }
+
+    //label - dictionary
+    std::vector<std::string_view> dict;
+    std::vector<std::uint32_t> idx;
+    idx.reserve(count);
+    for (const Fill &f: _pending) {
+        auto iter = std::find(dict.begin(), dict.end(), std::string_view(f.label));
+        if (iter == dict.end()) {
+            dict.push_back(f.label);
+            iter = dict.end() - 1;
+        }
+        idx.push_back(static_cast<std::uint32_t>(iter - dict.begin()));
+    }
+    write_varint(columns[2], dict.size());
+    for (auto l: dict) {
+        write_varint(columns[2], l.size());
+        columns[2].append(l);
+    }
+    for (auto i: idx) write_varint(columns[2], i);
+
+    encode_doubles(columns[3], count, [&](std::size_t i) {return _pending[i].price;});
+    encode_doubles(columns[4], count, [&](std::size_t i) {return _pending[i].amount;});
+    encode_doubles(columns[5], count, [&](std::size_t i) {return _pending[i].fees;});
+
+    FillArchive::BlockHeader hdr = {};
+    hdr.count = static_cast<std::uint32_t>(count);
+    hdr.min_time = min_time;
+    hdr.max_time = max_time;
+    std::size_t size = sizeof(hdr);
+    for (int i = 0; i < 6; ++i) {
+        hdr.column_size[i] = static_cast<std::uint32_t>(columns[i].size());
+        size += columns[i].size();
+    }
+    hdr.size = static_cast<std::uint32_t>(size);
+    _out.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    for (const auto &c: columns) _out.append(c);
+    _pending.clear();
+}
+
+std::string FillArchiveWriter::finish() {
+    write_block();
+    if (_out.empty()) {
+        _out.append(reinterpret_cast<const char *>(&FillArchive::magic), 4);
+        _out.append(reinterpret_cast<const char *>(&FillArchive::version), 4);
+    }
+    return std::move(_out);
+}
+
+void FillArchiveWriter::save(const std::string &pathname) {
+    std::string data = finish();
+    int fd = ::open(pathname.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if (fd < 0) throw_errno("FillArchive: unable to create: " + pathname);
+    const char *p = data.data();
+    std::size_t remain = data.size();
+    while (remain) {
+        auto r = ::write(fd, p, remain);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            int e = errno;
+            ::close(fd);
+            throw std::system_error(e, std::generic_category(), "FillArchive: write failed: " + pathname);
+        }
+        p += r;
+        remain -= static_cast<std::size_t>(r);
+    }
+    ::close(fd);
+}
+
+FillArchive::FillArchive(std::string data):_buffer(std::move(data)) {
+    _data = _buffer;
+    parse();
+}
+
+FillArchive FillArchive::open(const std::string &pathname) {
+    int fd = ::open(pathname.c_str(), O_RDONLY|O_CLOEXEC);
+    if (fd < 0) throw_errno("FillArchive: unable to open: " + pathname);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int e = errno;
+        ::close(fd);
+        throw std::system_error(e, std::generic_category(), "FillArchive: unable to stat: " + pathname);
+    }
+    FillArchive out;
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (size) {
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error(e, std::generic_category(), "FillArchive: unable to map: " + pathname);
+        }
+        out._map = map;
+        out._map_size = size;
+        out._data = std::string_view(static_cast<const char *>(map), size);
+    }
+    ::close(fd);
+    out.parse();
+    return out;
+}
+
+FillArchive::FillArchive(FillArchive &&other)
+    :_buffer(std::move(other._buffer))
+    ,_map(other._map)
+    ,_map_size(other._map_size)
+    ,_data(_map?other._data:std::string_view(_buffer))
+    ,_blocks(std::move(other._blocks))
+    ,_count(other._count) {
+    other._map = nullptr;
+    other._map_size = 0;
+    other._data = {};
+    other._count = 0;
+}
+
+FillArchive &FillArchive::operator=(FillArchive &&other) {
+    if (this != &other) {
+        close();
+        _buffer = std::move(other._buffer);
+        _map = other._map;
+        _map_size = other._map_size;
+        _data = _map?other._data:std::string_view(_buffer);
+        _blocks = std::move(other._blocks);
+        _count = other._count;
+        other._map = nullptr;
+        other._map_size = 0;
+        other._data = {};
+        other._count = 0;
+    }
+    return *this;
+}
+
+FillArchive::~FillArchive() {
+    close();
+}
+
+void FillArchive::close() {
+    if (_map) ::munmap(_map, _map_size);
+    _map = nullptr;
+    _map_size = 0;
+    _data = {};
+}
+
+void FillArchive::parse() {
+    _blocks.clear();
+    _count = 0;
+    std::uint32_t hdr[2];
+    if (_data.size() < sizeof(hdr)) throw std::runtime_error("FillArchive: not an archive");
+    std::memcpy(hdr, _data.data(), sizeof(hdr));
+    if (hdr[0] != magic || hdr[1] != version) throw std::runtime_error("FillArchive: not an archive or unsupported version");
+    std::size_t pos = sizeof(hdr);
+    while (pos < _data.size()) {
+        BlockRef b;
+        if (_data.size() - pos < sizeof(BlockHeader)) throw std::runtime_error("FillArchive: damaged archive");
+        std::memcpy(&b.hdr, _data.data() + pos, sizeof(BlockHeader));
+        std::size_t cols = 0;
+        for (auto c: b.hdr.column_size) cols += c;
+        if (b.hdr.size != sizeof(BlockHeader) + cols || b.hdr.size > _data.size() - pos) {
+            throw std::runtime_error("FillArchive: damaged archive");
+        }
+        b.offset = pos + sizeof(BlockHeader);
+        _count += b.hdr.count;
+        _blocks.push_back(b);
+        pos += b.hdr.size;
+    }
+}
+
+bool FillArchive::decode(const BlockRef &b, std::string_view filter, Columns &out, std::vector<char> &match) const {
+    std::string_view col[6];
+    std::size_t pos = b.offset;
+    for (int i = 0; i < 6; ++i) {
+        col[i] = _data.substr(pos, b.hdr.column_size[i]);
+        pos += b.hdr.column_size[i];
+    }
+    std::size_t count = b.hdr.count;
+
+    //labels first, block can be skipped
+    ColumnReader lr(col[2]);
+    std::size_t dict_size = lr.varint();
+    out.labels.resize(dict_size);
+    match.resize(dict_size);
+    bool any = false;
+    for (std::size_t i = 0; i < dict_size; ++i) {
+        out.labels[i].assign(lr.bytes(lr.varint()));
+        match[i] = std::string_view(out.labels[i]).substr(0, filter.size()) == filter;
+        any = any || match[i];
+    }
+    if (!any) return false;
+    out.label.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        out.label[i] = static_cast<std::uint32_t>(lr.varint());
+        if (out.label[i] >= dict_size) throw std::runtime_error("FillArchive: damaged block");
+    }
+
+    ColumnReader tr(col[0]);
+    out.time.resize(count);
+    std::int64_t t = unzigzag(tr.varint());
+    auto unit = static_cast<std::int64_t>(tr.varint());
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i) t += unzigzag(tr.varint()) * unit;
+        out.time[i] = t;
+    }
+
+    ColumnReader ir(col[1]);
+    bool numeric = ir.bytes(1)[0] != 0;
+    out.id.resize(count);
+    std::int64_t num = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (numeric) {
+            num += unzigzag(ir.varint());
+            char buff[24];
+            auto r = std::to_chars(buff, buff + sizeof(buff), static_cast<std::uint64_t>(num));
+            out.id[i].assign(buff, r.ptr);
+            continue;
+        }
+        std::size_t shared = ir.varint();
+        std::size_t rest = ir.varint();
+        if (i) {
+            if (shared > out.id[i-1].size()) throw std::runtime_error("FillArchive: damaged block");
+            out.id[i].assign(out.id[i-1], 0, shared);
+        } else {
+            out.id[i].clear();
+        }
+        out.id[i].append(ir.bytes(rest));
+    }
+
+    decode_doubles(col[3], count, out.price);
+    decode_doubles(col[4], count, out.amount);
+    decode_doubles(col[5], count, out.fees);
+    return true;
+}
+
+template<typename Fn>
+void FillArchive::scan_back(Timestamp limit, std::string_view filter, Fn &&fn) const {
+    std::int64_t lim = limit == Timestamp::min()?std::numeric_limits<std::int64_t>::min():to_ns(limit);
+    Columns cols;
+    std::vector<char> match;
+    for (auto iter = _blocks.rbegin(); iter != _blocks.rend(); ++iter) {
+        if (iter->hdr.max_time <= lim) continue;
+        if (!decode(*iter, filter, cols, match)) continue;
+        for (std::size_t i = cols.size(); i > 0; --i) {
+            std::size_t r = i - 1;
+            if (cols.time[r] > lim && match[cols.label[r]]) {
+                if (!fn(cols.get_fill(r))) return;
+            }
+        }
+    }
+}
+
+Fills FillArchive::load_fills(std::size_t limit, std::string_view filter) const {
+    Fills ret;
+    if (!limit) return ret;
+    scan_back(Timestamp::min(), filter, [&](Fill &&f) {
+        ret.push_back(std::move(f));
+        return ret.size() < limit;
+    });
+    return ret;
+}
+
+Fills FillArchive::load_fills(Timestamp limit, std::string_view filter) const {
+    Fills ret;
+    scan_back(limit, filter, [&](Fill &&f) {
+        ret.push_back(std::move(f));
+        return true;
+    });
+    return ret;
+}
+
+void FillArchive::enum_fills(std::size_t limit, std::string_view filter, Function<void(const Fill &)> &fn) const {
+    std::size_t cnt = 0;
+    if (!limit) return;
+    scan_back(Timestamp::min(), filter, [&](Fill &&f) {
+        fn(f);
+        return ++cnt < limit;
+    });
+}
+
+void FillArchive::enum_fills(Timestamp limit, std::string_view filter, Function<void(const Fill &)> &fn) const {
+    scan_back(limit, filter, [&](Fill &&f) {
+        fn(f);
+        return true;
+    });
+}
+
+void FillArchive::scan(Timestamp from, Function<void(const Columns &)> &fn) const {
+    std::int64_t lim = from == Timestamp::min()?std::numeric_limits<std::int64_t>::min():to_ns(from);
+    Columns cols;
+    std::vector<char> match;
+    for (const BlockRef &b: _blocks) {
+        if (b.hdr.max_time <= lim) continue;
+        decode(b, {}, cols, match);
+        fn(cols);
+    }
+}
+
+}
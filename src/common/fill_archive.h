@@ -0,0 +1,176 @@
+#pragma once
+
+#include "../trading_ifc/fill.h"
+#include "../trading_ifc/function.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace trading_api {
+
+///Columnar compressed archive of fills
+/**
+ * Fills are stored in blocks, every block stores each field as separate column
+ *
+ * - time: first time, then differences divided by their greatest common divisor (varint)
+ * - id: differences, when all ids of the block are decimal numbers, otherwise
+ *   front coded - length of prefix shared with previous id and the rest
+ * - label: dictionary of the block and index to the dictionary for every fill
+ * - price, amount, fees: differences of decimal integers, when all values of the
+ *   block are decimal numbers with at most 9 decimal places, otherwise XOR with
+ *   previous value (Gorilla compression)
+ *
+ * Block header contains time range of the block, so time limited scans skip
+ * older blocks. Label dictionary is checked first, block without matching label is
+ * skipped without decoding other columns.
+ *
+ * @code
+ * archive: | magic:u32 | version:u32 | block | block | ... |
+ * block:   | BlockHeader | time | id | label | price | amount | fees |
+ * @endcode
+ *
+ * Fills are expected to be appended in time order. Archive is immutable, it is
+ * created by FillArchiveWriter
+ */
+class FillArchive {
+public:
+
+    static constexpr std::uint32_t magic = 0x52414654;   //"TFAR"
+    static constexpr std::uint32_t version = 1;
+
+    ///Decoded block (columns)
+    struct Columns {
+        ///time of fills (nanoseconds since epoch)
+        std::vector<std::int64_t> time;
+        ///ids of fills
+        std::vector<std::string> id;
+        ///label dictionary of the block
+        std::vector<std::string> labels;
+        ///index to the label dictionary for every fill
+        std::vector<std::uint32_t> label;
+        std::vector<double> price;
+        std::vector<double> amount;
+        std::vector<double> fees;
+
+        std::size_t size() const {return time.size();}
+        Fill get_fill(std::size_t i) const;
+    };
+
+    FillArchive() = default;
+    ///Create archive from its content
+    /**
+     * @param data content created by FillArchiveWriter
+     * @exception std::runtime_error invalid content
+     */
+    explicit FillArchive(std::string data);
+
+    ///Open archive file (mapped to memory)
+    /**
+     * @param pathname pathname
+     * @exception std::system_error unable to open the file
+     * @exception std::runtime_error not an archive
+     */
+    static FillArchive open(const std::string &pathname);
+
+    FillArchive(FillArchive &&other);
+    FillArchive &operator=(FillArchive &&other);
+    ~FillArchive();
+
+    ///Count of fills
+    std::size_t size() const {return _count;}
+    ///Size of the archive in bytes
+    std::size_t get_data_size() const {return _data.size();}
+
+    ///load recent fills (same as IStorage::load_fills)
+    Fills load_fills(std::size_t limit, std::string_view filter = {}) const;
+    ///load recent fills (same as IStorage::load_fills)
+    Fills load_fills(Timestamp limit, std::string_view filter = {}) const;
+    ///enumerate recent fills, newest first (same as IStorage::enum_fills)
+    void enum_fills(std::size_t limit, std::string_view filter, Function<void(const Fill &)> &fn) const;
+    ///enumerate recent fills, newest first (same as IStorage::enum_fills)
+    void enum_fills(Timestamp limit, std::string_view filter, Function<void(const Fill &)> &fn) const;
+
+    ///Scan all blocks as columns, oldest first
+    /**
+     * @param from skip blocks which contain only fills not newer than this time
+     * @param fn function receives decoded block. Columns can contain fills
+     * older than 'from'
+     */
+    void scan(Timestamp from, Function<void(const Columns &)> &fn) const;
+
+protected:
+
+    friend class FillArchiveWriter;
+
+    struct BlockHeader {
+        std::uint32_t count;
+        std::uint32_t size;
+        std::int64_t min_time;
+        std::int64_t max_time;
+        ///sizes of columns (time, id, label, price, amount, fees)
+        std::uint32_t column_size[6];
+    };
+
+    struct BlockRef {
+        BlockHeader hdr;
+        ///offset of first column
+        std::size_t offset;
+    };
+
+    std::string _buffer;
+    void *_map = nullptr;
+    std::size_t _map_size = 0;
+    std::string_view _data;
+    std::vector<BlockRef> _blocks;
+    std::size_t _count = 0;
+
+    void parse();
+    void close();
+    ///decode block
+    /**
+     * @param b block
+     * @param filter label prefix
+     * @param out decoded columns, only labels are decoded when no label matches
+     * @param match receives flag for every label in dictionary
+     * @retval true block contains matching label
+     */
+    bool decode(const BlockRef &b, std::string_view filter, Columns &out, std::vector<char> &match) const;
+    ///enumerate matching fills newest first, until fn returns false
+    template<typename Fn>
+    void scan_back(Timestamp limit, std::string_view filter, Fn &&fn) const;
+};
+
+///Creates FillArchive
+class FillArchiveWriter {
+public:
+
+    ///Construct writer
+    /**
+     * @param block_size count of fills in block
+     */
+    explicit FillArchiveWriter(std::size_t block_size = 4096);
+
+    ///Append fill
+    void append(const Fill &fill);
+    ///Finish archive
+    /**
+     * @return content of the archive. The writer is reset
+     */
+    std::string finish();
+    ///Finish archive and write it to the file
+    /**
+     * @exception std::system_error unable to write file
+     */
+    void save(const std::string &pathname);
+
+protected:
+    std::size_t _block_size;
+    std::string _out;
+    std::vector<Fill> _pending;
+
+    void write_block();
+};
+
+}
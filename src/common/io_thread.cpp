@@ -0,0 +1,57 @@
+#include "io_thread.h"
+
+#include <iostream>
+
+namespace trading_api {
+
+thread_local const IOThread *IOThread::_current = nullptr;
+
+IOThread::IOThread() {
+    _thr = std::thread([this]{
+        _current = this;
+        worker();
+    });
+}
+
+IOThread::~IOThread() {
+    stop();
+}
+
+void IOThread::post(Function<void()> fn) {
+    {
+        std::lock_guard _(_mx);
+        _queue.push_back(std::move(fn));
+    }
+    _cond.notify_one();
+}
+
+void IOThread::stop() {
+    {
+        std::lock_guard _(_mx);
+        _stop = true;
+    }
+    _cond.notify_all();
+    if (_thr.joinable()) {
+        if (_thr.get_id() == std::this_thread::get_id()) _thr.detach();
+        else _thr.join();
+    }
+}
+
+void IOThread::worker() {
+    std::unique_lock lk(_mx);
+    while (true) {
+        _cond.wait(lk, [&]{return _stop || !_queue.empty();});
+        if (_queue.empty()) break;
+        auto fn = std::move(_queue.front());
+        _queue.pop_front();
+        lk.unlock();
+        try {
+            fn();
+        } catch (std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+        lk.lock();
+    }
+}
+
+}
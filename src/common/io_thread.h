@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../trading_ifc/function.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace trading_api {
+
+///Thread which executes posted functions in order
+/**
+ * Used as dedicated I/O thread of an exchange. All callbacks from the
+ * exchange are executed in this thread, so the thread can be the single
+ * producer of queues to strategies
+ */
+class IOThread {
+public:
+
+    IOThread();
+    ~IOThread();
+    IOThread(const IOThread &) = delete;
+    IOThread &operator=(const IOThread &) = delete;
+
+    ///Post function to the thread
+    /**
+     * @param fn function to execute
+     */
+    void post(Function<void()> fn);
+
+    ///Returns true when called from this thread
+    bool is_current() const {return current() == this;}
+
+    ///Retrieve I/O thread of the calling thread
+    /**
+     * @return pointer to the IOThread object or nullptr if the calling
+     * thread is not an I/O thread
+     */
+    static const IOThread *current() {return _current;}
+
+    ///Stop the thread - remaining functions are executed
+    void stop();
+
+protected:
+    std::mutex _mx;
+    std::condition_variable _cond;
+    std::deque<Function<void()> > _queue;
+    bool _stop = false;
+    std::thread _thr;
+
+    static thread_local const IOThread *_current;
+
+    void worker();
+};
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../trading_ifc/instrument.h"
+#include "../trading_ifc/orderbook.h"
+#include "seqlock.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace trading_api {
+
+///Last known ticker and orderbook of every instrument
+/**
+ * Readers don't take any lock. Ticker is stored in a sequence lock, the
+ * orderbook is published as an immutable snapshot through an atomic pointer.
+ * Slots are stored in an array indexed by dense index of the instrument. When
+ * the array is full, it is replaced by a copy with double capacity. Replaced
+ * arrays are kept until the cache is destroyed, so readers can use the array
+ * without reference counting.
+ *
+ * @note writers must be serialized by the caller
+ */
+class LastValueCache {
+public:
+
+    LastValueCache() {
+        _indexes.push_back(std::make_unique<Index>(16));
+        _index.store(_indexes.back().get(), std::memory_order_release);
+    }
+
+    ///store ticker
+    void put(const Instrument &i, const Ticker &tk) {
+        get_slot(i).ticker.store(tk);
+    }
+    ///store orderbook
+    void put(const Instrument &i, const OrderBook &ob) {
+        put(i, std::make_shared<const OrderBook>(ob));
+    }
+    ///store orderbook snapshot
+    void put(const Instrument &i, std::shared_ptr<const OrderBook> ob) {
+        get_slot(i).orderbook.store(std::move(ob), std::memory_order_release);
+    }
+
+    ///retrieve ticker
+    /**
+     * @param i instrument
+     * @param tk variable which receives ticker
+     * @retval true success
+     * @retval false no ticker for the instrument
+     */
+    bool get(const Instrument &i, Ticker &tk) const {
+        const Slot *slot = find_slot(i);
+        return slot && slot->ticker.load(tk);
+    }
+
+    ///retrieve orderbook snapshot
+    /**
+     * @param i instrument
+     * @return snapshot or nullptr if there is no orderbook for the instrument
+     */
+    std::shared_ptr<const OrderBook> get_orderbook(const Instrument &i) const {
+        const Slot *slot = find_slot(i);
+        if (!slot) return {};
+        return slot->orderbook.load(std::memory_order_acquire);
+    }
+
+    ///retrieve orderbook
+    /**
+     * @param i instrument
+     * @param ob variable which receives orderbook
+     * @retval true success
+     * @retval false no orderbook for the instrument
+     */
+    bool get(const Instrument &i, OrderBook &ob) const {
+        auto snapshot = get_orderbook(i);
+        if (!snapshot) return false;
+        ob = *snapshot;
+        return true;
+    }
+
+protected:
+
+    struct Slot {
+        SeqLock<Ticker> ticker;
+        std::atomic<std::shared_ptr<const OrderBook> > orderbook;
+    };
+
+    ///slots indexed by Instrument::get_index()
+    using Index = std::vector<std::atomic<Slot *> >;
+
+    ///current index
+    std::atomic<const Index *> _index;
+    ///all indexes ever published (last is current), capacity grows geometrically
+    std::vector<std::unique_ptr<Index> > _indexes;
+    ///owns slots
+    std::vector<std::unique_ptr<Slot> > _slots;
+
+    const Slot *find_slot(const Instrument &i) const {
+        const Index *idx = _index.load(std::memory_order_acquire);
+        auto n = i.get_index();
+        return n < idx->size()?(*idx)[n].load(std::memory_order_acquire):nullptr;
+    }
+
+    Slot &get_slot(const Instrument &i) {
+        Index *idx = _indexes.back().get();
+        auto n = i.get_index();
+        if (n < idx->size()) {
+            Slot *slot = (*idx)[n].load(std::memory_order_relaxed);
+            if (slot) return *slot;
+        } else {
+            auto new_idx = std::make_unique<Index>(std::max<std::size_t>(n+1, idx->size()*2));
+            for (std::size_t k = 0; k < idx->size(); ++k) {
+                (*new_idx)[k].store((*idx)[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            idx = new_idx.get();
+            _indexes.push_back(std::move(new_idx));
+        }
+        _slots.push_back(std::make_unique<Slot>());
+        Slot *slot = _slots.back().get();
+        (*idx)[n].store(slot, std::memory_order_release);
+        _index.store(idx, std::memory_order_release);
+        return *slot;
+    }
+};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace trading_api {
+
+///Histogram of latencies with bounded relative error
+/**
+ * Values below 64 are counted exactly. Every following power of two is
+ * divided to 32 buckets, so relative error of reported value is at most 1/32.
+ * Recording is constant time without allocation, so it can be used on hot path
+ *
+ * @note object is not MT safe. Use one histogram per thread and merge them
+ */
+class LatencyHistogram {
+public:
+
+    static constexpr unsigned int sub_buckets = 32;
+    static constexpr unsigned int linear_range = 2 * sub_buckets;
+    static constexpr unsigned int bucket_count = linear_range + (64 - 6) * sub_buckets;
+
+    ///Record value
+    void record(std::uint64_t value) {
+        ++_buckets[bucket_index(value)];
+        ++_count;
+        _sum += value;
+        _min = std::min(_min, value);
+        _max = std::max(_max, value);
+    }
+
+    ///Retrieve value at given percentile
+    /**
+     * @param p percentile (0 - 100)
+     * @return highest value of the bucket which contains the percentile,
+     * limited by the maximum recorded value. Returns 0 if histogram is empty
+     */
+    std::uint64_t percentile(double p) const {
+        if (_count == 0) return 0;
+        p = std::clamp(p, 0.0, 100.0);
+        auto rank = static_cast<std::uint64_t>(p * static_cast<double>(_count) / 100.0 + 0.5);
+        rank = std::clamp<std::uint64_t>(rank, 1, _count);
+        std::uint64_t acc = 0;
+        for (unsigned int i = 0; i < bucket_count; ++i) {
+            acc += _buckets[i];
+            if (acc >= rank) return std::clamp(bucket_high(i), _min, _max);
+        }
+        return _max;
+    }
+
+    ///Merge other histogram
+    void merge(const LatencyHistogram &other) {
+        for (unsigned int i = 0; i < bucket_count; ++i) _buckets[i] += other._buckets[i];
+        _count += other._count;
+        _sum += other._sum;
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    void clear() {
+        *this = LatencyHistogram();
+    }
+
+    std::uint64_t count() const {return _count;}
+    std::uint64_t min() const {return _count?_min:0;}
+    std::uint64_t max() const {return _max;}
+    double mean() const {return _count?static_cast<double>(_sum)/static_cast<double>(_count):0.0;}
+
+    static constexpr unsigned int bucket_index(std::uint64_t value) {
+        if (value < linear_range) return static_cast<unsigned int>(value);
+        unsigned int shift = static_cast<unsigned int>(std::bit_width(value)) - 6;
+        return linear_range + (shift - 1) * sub_buckets + static_cast<unsigned int>((value >> shift) - sub_buckets);
+    }
+
+    static constexpr std::uint64_t bucket_high(unsigned int index) {
+        if (index < linear_range) return index;
+        unsigned int shift = (index - linear_range) / sub_buckets + 1;
+        std::uint64_t m = (index - linear_range) % sub_buckets + sub_buckets;
+        return ((m + 1) << shift) - 1;
+    }
+
+protected:
+    std::array<std::uint64_t, bucket_count> _buckets = {};
+    std::uint64_t _count = 0;
+    std::uint64_t _sum = 0;
+    std::uint64_t _min = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t _max = 0;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+namespace trading_api {
+
+///Tournament (loser) tree for k-way merge
+/**
+ * Keeps keys of k sorted streams (one key per stream, usually key of
+ * its current item) and tracks the stream with lowest key. Advancing the
+ * winning stream costs log2(k) comparisons, because only path from its
+ * leaf to the root is replayed.
+ *
+ * Ties are resolved in favor of lower stream index, so merge is stable
+ *
+ * @tparam Key type of key
+ * @tparam Cmp ordering
+ */
+template<typename Key, typename Cmp = std::less<Key> >
+class LoserTree {
+public:
+
+    LoserTree() = default;
+    LoserTree(Cmp cmp):_cmp(std::move(cmp)) {}
+
+    ///build tree for given keys
+    /**
+     * @param keys key for every stream. Index of the key is index of the stream
+     */
+    void build(std::vector<Key> keys) {
+        _keys = std::move(keys);
+        _leaves = 1;
+        while (_leaves < _keys.size()) _leaves <<= 1;
+        _losers.assign(_leaves, 0);
+        std::vector<std::size_t> winners(2*_leaves);
+        for (std::size_t i = 0; i < _leaves; ++i) winners[_leaves+i] = i;
+        for (std::size_t node = _leaves-1; node > 0; --node) {
+            std::size_t a = winners[2*node];
+            std::size_t b = winners[2*node+1];
+            if (beats(a, b)) {
+                winners[node] = a;
+                _losers[node] = b;
+            } else {
+                winners[node] = b;
+                _losers[node] = a;
+            }
+        }
+        _winner = winners[1];
+    }
+
+    ///returns true if there are no streams
+    bool empty() const {return _keys.empty();}
+    ///count of streams
+    std::size_t size() const {return _keys.size();}
+    ///index of stream with lowest key
+    std::size_t winner() const {return _winner;}
+    ///lowest key
+    const Key &top() const {return _keys[_winner];}
+    ///key of given stream
+    const Key &get_key(std::size_t idx) const {return _keys[idx];}
+
+    ///change key of the winning stream (after it advanced) and find new winner
+    void replace_top(Key key) {
+        _keys[_winner] = std::move(key);
+        std::size_t w = _winner;
+        for (std::size_t node = (_leaves + w) / 2; node > 0; node /= 2) {
+            if (beats(_losers[node], w)) std::swap(_losers[node], w);
+        }
+        _winner = w;
+    }
+
+protected:
+    Cmp _cmp;
+    std::vector<Key> _keys;
+    std::vector<std::size_t> _losers;
+    std::size_t _leaves = 0;
+    std::size_t _winner = 0;
+
+    bool beats(std::size_t a, std::size_t b) const {
+        if (a >= _keys.size()) return false;
+        if (b >= _keys.size()) return true;
+        if (_cmp(_keys[a], _keys[b])) return true;
+        if (_cmp(_keys[b], _keys[a])) return false;
+        return a < b;
+    }
+};
+
+}
@@ -1,5 +1,7 @@
 #include "memory_storage.h"
 
+#include <algorithm>
+
 namespace trading_api {
 
 void MemoryStorage::rollback() {
@@ -12,41 +14,163 @@ void MemoryStorage::begin_transaction() {
 }
 
 void MemoryStorage::put_order(const Order &ord) {
-    store(TrnPutOrder{ord});
+    SerializedOrder bin = ord.to_binary();
+    if (unused(bin)) return;
+    _transaction.write(static_cast<std::uint8_t>(RecordType::put_order));
+    _transaction.write(bin.order_id);
+    _transaction.write(bin.order_content);
+    _transaction.write(ord.done());
+    if (!_transaction_counter) apply_transaction();
 }
 
 void MemoryStorage::erase_var(std::string_view name) {
-    store(TrnEraseVar{std::string(name)});
+    _transaction.write(static_cast<std::uint8_t>(RecordType::erase_var));
+    _transaction.write(name);
+    if (!_transaction_counter) apply_transaction();
 }
 
 void MemoryStorage::put_fill(const Fill &fill) {
-    store(TrnPutFill{fill});
+    _transaction.write(static_cast<std::uint8_t>(RecordType::put_fill));
+    _transaction.write(fill.time);
+    _transaction.write(fill.id);
+    _transaction.write(fill.label);
+    _transaction.write(fill.price);
+    _transaction.write(fill.amount);
+    _transaction.write(fill.fees);
+    if (!_transaction_counter) apply_transaction();
 }
 
 void MemoryStorage::commit() {
     _transaction_counter = std::max(_transaction_counter-1,0);
-    if (!_transaction_counter) {
-        for (auto &x: _transaction) {
-            std::visit([&](auto &item) {
-                item(this);
-            }, x);
-        }
+    if (!_transaction_counter) apply_transaction();
+}
+
+void MemoryStorage::apply_transaction() {
+    BinaryReader rd(_transaction.get_data());
+    try {
+        apply_records(rd);
+    } catch (...) {
         _transaction.clear();
+        throw;
+    }
+    _transaction.clear();
+}
+
+void MemoryStorage::apply_records(BinaryReader &rd) {
+    while (!rd.eof()) {
+        switch (static_cast<RecordType>(rd.read<std::uint8_t>())) {
+            case RecordType::put_var: {
+                std::string_view name = rd.read_block(rd.read_size());
+                _vars.put(name, rd.read_block(rd.read_size()));
+            } break;
+            case RecordType::erase_var:
+                _vars.erase(rd.read_block(rd.read_size()));
+                break;
+            case RecordType::put_order: {
+                std::string_view id = rd.read_block(rd.read_size());
+                std::string_view content = rd.read_block(rd.read_size());
+                if (rd.read<bool>()) {
+                    auto iter = _orders.find(id);
+                    if (iter != _orders.end()) _orders.erase(iter);
+                } else {
+                    auto iter = _orders.find(id);
+                    if (iter == _orders.end()) _orders.emplace(id, content);
+                    else iter->second.assign(content);
+                }
+            } break;
+            case RecordType::put_fill: {
+                Fill f;
+                f.time = rd.read_timestamp();
+                f.id = rd.read_string();
+                f.label = rd.read_string();
+                f.price = rd.read<double>();
+                f.amount = rd.read<double>();
+                f.fees = rd.read<double>();
+                _fills.push_back(std::move(f));
+                index_last_fill();
+            } break;
+            default:
+                throw std::runtime_error("MemoryStorage: unknown record type");
+        }
     }
 }
 
 bool MemoryStorage::is_duplicate_fill(const Fill &fill) const {
-    auto iter = _fills.rbegin();
+    auto [b, e] = _fill_index.equal_range(fill.id);
+    if (std::any_of(b, e, [&](const auto &x){return x.second == fill.time;})) return true;
+    //all fills inside of the window are indexed
+    if (_fill_newest - fill.time <= _fill_window) return false;
+    //fill is too old, search fills removed from the index
+    auto iter = _fills.rend() - static_cast<std::ptrdiff_t>(_fill_index_tail);
     auto end = _fills.rend();
-    while (iter != end && iter->time > fill.time) {
-        if (*iter == fill) return true;
+    while (iter != end) {
+        if (is_same_fill(*iter, fill)) return true;
         ++iter;
     }
     return false;
 }
 
+void MemoryStorage::insert_position(FillPositions &lst, std::uint32_t pos) const {
+    //fills usually arrive ordered by time
+    if (lst.empty() || !(_fills[pos].time < _fills[lst.back()].time)) {
+        lst.push_back(pos);
+    } else {
+        auto iter = std::upper_bound(lst.begin(), lst.end(), pos, [&](std::uint32_t a, std::uint32_t b) {
+            return _fills[a].time < _fills[b].time;
+        });
+        lst.insert(iter, pos);
+    }
+}
+
+void MemoryStorage::index_fill_position(std::uint32_t pos) {
+    const Fill &f = _fills[pos];
+    insert_position(_fills_by_time, pos);
+    auto iter = _fills_by_label.find(f.label);
+    if (iter == _fills_by_label.end()) iter = _fills_by_label.emplace(f.label, FillPositions()).first;
+    insert_position(iter->second, pos);
+}
+
+void MemoryStorage::index_last_fill() {
+    const Fill &f = _fills.back();
+    index_fill_position(static_cast<std::uint32_t>(_fills.size() - 1));
+    _fill_index.emplace(f.id, f.time);
+    _fill_newest = std::max(_fill_newest, f.time);
+    //fills are evicted in order of insertion, fill which arrived late is
+    //evicted with its neighbours
+    while (_fill_index_tail < _fills.size()
+            && _fill_newest - _fills[_fill_index_tail].time > _fill_window) {
+        const Fill &old = _fills[_fill_index_tail];
+        auto [b, e] = _fill_index.equal_range(old.id);
+        auto iter = std::find_if(b, e, [&](const auto &x){return x.second == old.time;});
+        if (iter != e) _fill_index.erase(iter);
+        ++_fill_index_tail;
+    }
+}
+
+void MemoryStorage::rebuild_fill_index() {
+    _fill_index.clear();
+    _fill_index_tail = 0;
+    _fill_newest = {};
+    _fills_by_time.clear();
+    _fills_by_label.clear();
+    _fills_by_time.reserve(_fills.size());
+    for (const Fill &f: _fills) _fill_newest = std::max(_fill_newest, f.time);
+    for (std::size_t i = 0; i < _fills.size(); ++i) {
+        const Fill &f = _fills[i];
+        index_fill_position(static_cast<std::uint32_t>(i));
+        if (_fill_newest - f.time > _fill_window && i == _fill_index_tail) {
+            ++_fill_index_tail;
+        } else {
+            _fill_index.emplace(f.id, f.time);
+        }
+    }
+}
+
 void MemoryStorage::put_var(std::string_view name, std::string_view value) {
-    store(TrnPutVar{std::string(name), std::string(value)});
+    _transaction.write(static_cast<std::uint8_t>(RecordType::put_var));
+    _transaction.write(name);
+    _transaction.write(value);
+    if (!_transaction_counter) apply_transaction();
 }
 
 std::vector<SerializedOrder> MemoryStorage::load_open_orders() const {
@@ -57,87 +181,170 @@ std::vector<SerializedOrder> MemoryStorage::load_open_orders() const {
     return ret;
 }
 
-Fills MemoryStorage::load_fills(std::size_t limit, std::string_view filter) const {
-    Fills ret;
-    auto iter = _fills.rbegin();
-    auto end = _fills.rend();
-    while (ret.size()<limit && iter != end) {
-        if (filter.empty()) {
-            ret.push_back(*iter);
-        } else {
-            std::string_view label (iter->label);
-            if (label.substr(0, filter.size()) == filter) {
-                ret.push_back(*iter);
+template<typename Fn>
+void MemoryStorage::scan_fills(std::string_view filter, Timestamp limit, Fn &&fn) const {
+    auto before = [&](std::uint32_t a, std::uint32_t b) {
+        return _fills[a].time < _fills[b].time || (_fills[a].time == _fills[b].time && a < b);
+    };
+    auto first_newer = [&](const FillPositions &lst) -> std::size_t {
+        return std::upper_bound(lst.begin(), lst.end(), limit, [&](Timestamp tp, std::uint32_t pos) {
+            return tp < _fills[pos].time;
+        }) - lst.begin();
+    };
+    if (filter.empty()) {
+        for (std::size_t i = _fills_by_time.size(), e = first_newer(_fills_by_time); i > e; --i) {
+            if (!fn(_fills[_fills_by_time[i-1]])) return;
+        }
+        return;
+    }
+    struct Range {
+        const FillPositions *lst;
+        std::size_t begin;
+        std::size_t end;
+    };
+    std::vector<Range> ranges;
+    for (auto iter = _fills_by_label.lower_bound(filter);
+            iter != _fills_by_label.end() && std::string_view(iter->first).substr(0, filter.size()) == filter;
+            ++iter) {
+        std::size_t b = first_newer(iter->second);
+        if (b < iter->second.size()) ranges.push_back({&iter->second, b, iter->second.size()});
+    }
+    if (ranges.size() == 1) {
+        const Range &r = ranges[0];
+        for (std::size_t i = r.end; i > r.begin; --i) {
+            if (!fn(_fills[(*r.lst)[i-1]])) return;
+        }
+        return;
+    }
+    //merge labels matching the prefix, newest first
+    while (true) {
+        Range *best = nullptr;
+        for (Range &r: ranges) {
+            if (r.end > r.begin && (!best || before((*best->lst)[best->end-1], (*r.lst)[r.end-1]))) {
+                best = &r;
             }
         }
-        ++iter;
+        if (!best) return;
+        --best->end;
+        if (!fn(_fills[(*best->lst)[best->end]])) return;
     }
-    return ret;
+}
 
+Fills MemoryStorage::load_fills(std::size_t limit, std::string_view filter) const {
+    Fills ret;
+    if (!limit) return ret;
+    scan_fills(filter, Timestamp::min(), [&](const Fill &f) {
+        ret.push_back(f);
+        return ret.size() < limit;
+    });
+    return ret;
 }
 
 Fills MemoryStorage::load_fills(Timestamp limit, std::string_view filter) const {
     Fills ret;
-    auto iter = _fills.rbegin();
-    auto end = _fills.rend();
-    while (iter != end && iter->time > limit) {
-        if (filter.empty()) {
-            ret.push_back(*iter);
-        } else {
-            std::string_view label (iter->label);
-            if (label.substr(0, filter.size()) == filter) {
-                ret.push_back(*iter);
-            }
-        }
-        ++iter;
-    }
+    scan_fills(filter, limit, [&](const Fill &f) {
+        ret.push_back(f);
+        return true;
+    });
     return ret;
 }
 
+void MemoryStorage::enum_fills(std::size_t limit, std::string_view filter,
+        Function<void(const Fill &)> &fn) const {
+    std::size_t cnt = 0;
+    if (!limit) return;
+    scan_fills(filter, Timestamp::min(), [&](const Fill &f) {
+        fn(f);
+        return ++cnt < limit;
+    });
+}
+
+void MemoryStorage::enum_fills(Timestamp limit, std::string_view filter,
+        Function<void(const Fill &)> &fn) const {
+    scan_fills(filter, limit, [&](const Fill &f) {
+        fn(f);
+        return true;
+    });
+}
+
 void MemoryStorage::enum_vars(std::string_view prefix,
          Function<void(std::string_view, std::string_view)> &fn) const {
-
+    _vars.prefix(prefix, fn);
 }
 
 void MemoryStorage::enum_vars(std::string_view start, std::string_view end,
          Function<void(std::string_view, std::string_view)> &fn) const {
-    auto iter = _vars.lower_bound(start);
-    auto iend = _vars.upper_bound(end);
-    while (iter != iend) {
-        fn(iter->first, iter->second);
-        ++iter;
-    }
+    _vars.range(start, end, fn);
 }
 
-void MemoryStorage::store(TrnItem item) {
-    if (_transaction_counter) {
-        _transaction.push_back(std::move(item));
-    } else {
-        std::visit([&](auto &item) {
-                      item(this);
-                  }, item);
-    }
+void MemoryStorage::save_state(BinaryWriter &wr) const {
+    save_head(wr);
+    wr.write_size(_fills.size());
+    save_fills(wr, 0, _fills.size());
 }
 
-void MemoryStorage::TrnEraseVar::operator ()(MemoryStorage* me) {
-    me->_vars.erase(name);
+void MemoryStorage::save_head(BinaryWriter &wr) const {
+    if (_transaction_counter) throw std::logic_error("MemoryStorage: can't save state during transaction");
+    wr.write_size(_vars.size());
+    _vars.for_each([&](std::string_view k, std::string_view v) {
+        wr.write(k);
+        wr.write(v);
+    });
+    wr.write_size(_orders.size());
+    for (const auto &[k,v]: _orders) {
+        wr.write(k);
+        wr.write(v);
+    }
 }
 
-void MemoryStorage::TrnPutVar::operator ()(MemoryStorage* me) {
-    me->_vars.emplace(std::move(name), std::move(value));
+void MemoryStorage::save_fills(BinaryWriter &wr, std::size_t first, std::size_t last) const {
+    for (std::size_t i = first; i < last; ++i) {
+        const Fill &f = _fills[i];
+        wr.write(f.time);
+        wr.write(f.id);
+        wr.write(f.label);
+        wr.write(f.price);
+        wr.write(f.amount);
+        wr.write(f.fees);
+    }
 }
 
-void MemoryStorage::TrnPutOrder::operator ()(MemoryStorage* me) {
-    auto bin = order.to_binary();
-    if (unused(bin)) return;
-    me->_orders.emplace(std::move(bin.order_id), std::move(bin.order_content));
+void MemoryStorage::clear() {
+    _transaction.clear();
+    _transaction_counter = 0;
+    _vars.clear();
+    _orders.clear();
+    _fills.clear();
+    rebuild_fill_index();
 }
 
-void MemoryStorage::TrnPutFill::operator ()(MemoryStorage*me) {
-    me->_fills.push_back(std::move(fill));
+void MemoryStorage::load_state(BinaryReader &rd) {
+    clear();
+    for (std::size_t i = 0, cnt = rd.read_size(); i < cnt; ++i) {
+        std::string k = rd.read_string();
+        _vars.put(k, rd.read_string());
+    }
+    for (std::size_t i = 0, cnt = rd.read_size(); i < cnt; ++i) {
+        std::string k = rd.read_string();
+        _orders.emplace(std::move(k), rd.read_string());
+    }
+    std::size_t cnt = rd.read_size();
+    _fills.reserve(cnt);
+    for (std::size_t i = 0; i < cnt; ++i) {
+        Fill f;
+        f.time = rd.read_timestamp();
+        f.id = rd.read_string();
+        f.label = rd.read_string();
+        f.price = rd.read<double>();
+        f.amount = rd.read<double>();
+        f.fees = rd.read<double>();
+        _fills.push_back(std::move(f));
+    }
+    rebuild_fill_index();
 }
 
 std::string MemoryStorage::get_var(std::string_view var_name) const {
+    return _vars.get(var_name).value_or(std::string());
 }
 
 
@@ -1,16 +1,38 @@
 #pragma once
 #include "storage.h"
+#include "checkpoint.h"
+#include "var_store.h"
+
+#include <unordered_map>
 
 namespace trading_api {
 
-class MemoryStorage: public IStorage {
+class MemoryStorage: public IStorage, public ICheckpointable {
 public:
+
+    ///default time window of duplicate fill detection
+    static constexpr std::chrono::system_clock::duration default_fill_window = std::chrono::hours(24);
+
+    MemoryStorage():MemoryStorage(default_fill_window) {}
+    ///Construct storage
+    /**
+     * @param fill_window time window of fast duplicate fill detection. Fills
+     * not older than fill_window (measured from the newest stored fill)
+     * are indexed by fill ID. Older fills are detected by linear search.
+     */
+    explicit MemoryStorage(std::chrono::system_clock::duration fill_window):_fill_window(fill_window) {}
+
     virtual void rollback() override;
     virtual void begin_transaction() override;
     virtual void put_order(const Order &ord) override;
     virtual void erase_var(std::string_view name) override;
     virtual void put_fill(const Fill &fill) override;
     virtual void commit() override;
+    ///determine, whether given fill is duplicate
+    /**
+     * Fill is duplicate, when stored fill has the same id and the same time.
+     * It is O(1) for fills inside of fill window
+     */
     virtual bool is_duplicate_fill(const Fill &fill) const
             override;
     virtual void put_var(std::string_view name, std::string_view value)
@@ -18,47 +40,107 @@ public:
     virtual std::vector<SerializedOrder> load_open_orders() const override;
     virtual Fills load_fills(std::size_t limit, std::string_view filter) const override;
     virtual Fills load_fills(Timestamp limit, std::string_view filter) const override;
+    virtual void enum_fills(std::size_t limit, std::string_view filter,
+            Function<void(const Fill &)> &fn) const override;
+    virtual void enum_fills(Timestamp limit, std::string_view filter,
+            Function<void(const Fill &)> &fn) const override;
     virtual std::string get_var(std::string_view var_name) const override;
     virtual void enum_vars(std::string_view prefix,
                  Function<void(std::string_view,std::string_view)> &fn) const  override;
     virtual void enum_vars(std::string_view start, std::string_view end,
                  Function<void(std::string_view,std::string_view)> &fn) const  override;
 
-protected:
-
-    struct TrnEraseVar {
-        std::string name;
-        void operator()(MemoryStorage *);
-    };
-
-    struct TrnPutVar {
-        std::string name;
-        std::string value;
-        void operator()(MemoryStorage *);
-    };
+    ///Store content of the storage
+    /**
+     * @exception std::logic_error transaction is in progress
+     */
+    virtual void save_state(BinaryWriter &wr) const override;
+    ///Replace content of the storage
+    virtual void load_state(BinaryReader &rd) override;
 
-    struct TrnPutOrder {
-        Order order;
-        void operator()(MemoryStorage *);
-    };
+protected:
 
-    struct TrnPutFill {
-        Fill fill;
-        void operator()(MemoryStorage *);
+    ///type of record in transaction log
+    enum class RecordType: std::uint8_t {
+        put_var = 1,
+        erase_var = 2,
+        put_order = 3,
+        put_fill = 4
     };
 
-    using TrnItem = std::variant<TrnEraseVar, TrnPutVar, TrnPutOrder, TrnPutFill>;
-
-    std::vector<TrnItem> _transaction = {};
+    ///log of current transaction - serialized records
+    /**
+     * Buffer is reused by following transactions, so writes don't allocate
+     * once the buffer has enough capacity
+     *
+     * @code
+     * put_var:   | type:u8 | name:string | value:string |
+     * erase_var: | type:u8 | name:string |
+     * put_order: | type:u8 | order_id:string | order_content:string | done:bool |
+     * put_fill:  | type:u8 | time | id:string | label:string | price:f64 | amount:f64 | fees:f64 |
+     * @endcode
+     */
+    BinaryWriter _transaction = {};
     int _transaction_counter = 0;
 
-    void store(TrnItem item);
-
+    ///apply current transaction log and clear it
+    virtual void apply_transaction();
+    ///apply records to the content of the storage
+    /**
+     * @exception std::runtime_error unknown record type or incomplete record
+     */
+    void apply_records(BinaryReader &rd);
+    ///Store variables and orders, first part of save_state()
+    void save_head(BinaryWriter &wr) const;
+    ///Store fills without count, last part of save_state()
+    /**
+     * @param wr writer
+     * @param first index of the first fill
+     * @param last index after the last fill
+     */
+    void save_fills(BinaryWriter &wr, std::size_t first, std::size_t last) const;
+    ///remove all content, discard current transaction
+    void clear();
+
+    VarStore _vars = {};
+    std::map<std::string, std::string, std::less<> > _orders = {};
+    Fills _fills = {};
 
+    struct FillIdHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view id) const {return std::hash<std::string_view>()(id);}
+    };
 
-    std::map<std::string, std::string, std::less<> > _vars = {};
-    std::map<std::string, std::string> _orders = {};
-    Fills _fills = {};
+    std::chrono::system_clock::duration _fill_window;
+    ///fill id -> fill time, for fills from _fill_index_tail (fills with the
+    ///same id and different time are different fills)
+    std::unordered_multimap<std::string, Timestamp, FillIdHash, std::equal_to<> > _fill_index = {};
+    ///position of first indexed fill in _fills
+    std::size_t _fill_index_tail = 0;
+    ///time of the newest stored fill
+    Timestamp _fill_newest = {};
+
+    ///positions in _fills ordered by time (equal times by insertion)
+    using FillPositions = std::vector<std::uint32_t>;
+    ///all fills ordered by time
+    FillPositions _fills_by_time = {};
+    ///fills of every label ordered by time
+    std::map<std::string, FillPositions, std::less<> > _fills_by_label = {};
+
+    ///add last fill to the index and evict fills outside of the window
+    void index_last_fill();
+    void rebuild_fill_index();
+    ///add fill to the time and label indexes
+    void index_fill_position(std::uint32_t pos);
+    void insert_position(FillPositions &lst, std::uint32_t pos) const;
+    ///call function for fills newer than limit matching the filter, newest first
+    /**
+     * @param filter label prefix
+     * @param limit time limit, only newer fills are enumerated
+     * @param fn function, returns false to stop enumeration
+     */
+    template<typename Fn>
+    void scan_fills(std::string_view filter, Timestamp limit, Fn &&fn) const;
 
 };
 
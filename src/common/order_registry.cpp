@@ -0,0 +1,201 @@
+#include "order_registry.h"
+
+namespace trading_api {
+
+std::size_t OrderRegistry::hash_order(const Order &order) {
+    std::uint64_t h = Order::Hasher()(order);
+    h *= 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>(h ^ (h >> 32));
+}
+
+std::size_t OrderRegistry::hash_id(std::string_view id) {
+    return std::hash<std::string_view>()(id);
+}
+
+std::uint32_t OrderRegistry::find_index(const Order &order) const {
+    if (_by_order.empty()) return npos;
+    auto h = hash_order(order);
+    auto mask = _by_order.size() - 1;
+    for (auto pos = h & mask;; pos = (pos + 1) & mask) {
+        auto idx = _by_order[pos];
+        if (idx == npos) return npos;
+        const Slot &s = *_entries[idx];
+        if (s.order_hash == h && s.e.order == order) return idx;
+    }
+}
+
+OrderRegistry::Entry *OrderRegistry::find(const Order &order) {
+    auto idx = find_index(order);
+    return idx == npos?nullptr:&_entries[idx]->e;
+}
+
+OrderRegistry::Entry *OrderRegistry::find(std::string_view id) {
+    if (_by_id.empty() || id.empty()) return nullptr;
+    auto h = hash_id(id);
+    auto mask = _by_id.size() - 1;
+    for (auto pos = h & mask;; pos = (pos + 1) & mask) {
+        auto idx = _by_id[pos];
+        if (idx == npos) return nullptr;
+        Slot &s = *_entries[idx];
+        if (s.id_hash == h && s.e.id == id) return &s.e;
+    }
+}
+
+OrderRegistry::Entry *OrderRegistry::find_alias(const Order &alias) {
+    if (_by_alias.empty() || !alias) return nullptr;
+    auto h = hash_order(alias);
+    auto mask = _by_alias.size() - 1;
+    for (auto pos = h & mask;; pos = (pos + 1) & mask) {
+        auto idx = _by_alias[pos];
+        if (idx == npos) return nullptr;
+        Slot &s = *_entries[idx];
+        if (s.alias_hash == h && s.e.alias == alias) return &s.e;
+    }
+}
+
+std::pair<OrderRegistry::Entry *, bool> OrderRegistry::emplace(const Order &order, IEventTarget *target) {
+    if (auto e = find(order)) return {e, false};
+    if ((_count + 1) * 2 > _by_order.size()) grow(_by_order, Key::order);
+    std::uint32_t idx;
+    if (_free.empty()) {
+        idx = static_cast<std::uint32_t>(_entries.size());
+        _entries.emplace_back();
+    } else {
+        idx = _free.back();
+        _free.pop_back();
+    }
+    auto h = hash_order(order);
+    _entries[idx].emplace(Slot{Entry{order, target, {}, {}}, h, 0, 0});
+    table_insert(_by_order, h, idx);
+    ++_count;
+    return {&_entries[idx]->e, true};
+}
+
+void OrderRegistry::set_id(Entry *e, std::string_view id) {
+    auto idx = find_index(e->order);
+    if (idx == npos) return;
+    Slot &s = *_entries[idx];
+    if (!s.e.id.empty()) {
+        table_erase(_by_id, find_pos(_by_id, s.id_hash, idx), Key::id);
+        --_id_count;
+        s.e.id.clear();
+    }
+    if (id.empty()) return;
+    if (auto other = find(id)) set_id(other, {});
+    if ((_id_count + 1) * 2 > _by_id.size()) grow(_by_id, Key::id);
+    s.id_hash = hash_id(id);
+    s.e.id = std::string(id);
+    table_insert(_by_id, s.id_hash, idx);
+    ++_id_count;
+}
+
+void OrderRegistry::set_alias(Entry *e, const Order &alias) {
+    auto idx = find_index(e->order);
+    if (idx == npos) return;
+    Slot &s = *_entries[idx];
+    if (s.e.alias) {
+        table_erase(_by_alias, find_pos(_by_alias, s.alias_hash, idx), Key::alias);
+        --_alias_count;
+        s.e.alias = Order();
+    }
+    if (!alias) return;
+    if (auto other = find_alias(alias)) set_alias(other, Order());
+    if ((_alias_count + 1) * 2 > _by_alias.size()) grow(_by_alias, Key::alias);
+    s.alias_hash = hash_order(alias);
+    s.e.alias = alias;
+    table_insert(_by_alias, s.alias_hash, idx);
+    ++_alias_count;
+}
+
+void OrderRegistry::erase(Entry *e) {
+    auto idx = find_index(e->order);
+    if (idx != npos) erase_index(idx);
+}
+
+bool OrderRegistry::erase(const Order &order) {
+    auto idx = find_index(order);
+    if (idx == npos) return false;
+    erase_index(idx);
+    return true;
+}
+
+void OrderRegistry::erase_index(std::uint32_t idx) {
+    Slot &s = *_entries[idx];
+    if (!s.e.id.empty()) {
+        table_erase(_by_id, find_pos(_by_id, s.id_hash, idx), Key::id);
+        --_id_count;
+    }
+    if (s.e.alias) {
+        table_erase(_by_alias, find_pos(_by_alias, s.alias_hash, idx), Key::alias);
+        --_alias_count;
+    }
+    table_erase(_by_order, find_pos(_by_order, s.order_hash, idx), Key::order);
+    _entries[idx].reset();
+    _free.push_back(idx);
+    --_count;
+}
+
+void OrderRegistry::clear() {
+    _entries.clear();
+    _free.clear();
+    _by_order.clear();
+    _by_id.clear();
+    _by_alias.clear();
+    _count = 0;
+    _id_count = 0;
+    _alias_count = 0;
+}
+
+std::size_t OrderRegistry::find_pos(const Table &table, std::size_t hash, std::uint32_t idx) const {
+    auto mask = table.size() - 1;
+    auto pos = hash & mask;
+    while (table[pos] != idx) pos = (pos + 1) & mask;
+    return pos;
+}
+
+void OrderRegistry::table_insert(Table &table, std::size_t hash, std::uint32_t idx) {
+    auto mask = table.size() - 1;
+    auto pos = hash & mask;
+    while (table[pos] != npos) pos = (pos + 1) & mask;
+    table[pos] = idx;
+}
+
+std::size_t OrderRegistry::slot_hash(const Slot &s, Key key) {
+    switch (key) {
+        default:
+        case Key::order: return s.order_hash;
+        case Key::id: return s.id_hash;
+        case Key::alias: return s.alias_hash;
+    }
+}
+
+void OrderRegistry::table_erase(Table &table, std::size_t pos, Key key) {
+    //backward shift deletion - move following entries of the cluster to the gap
+    //if the gap is not before their home position
+    auto mask = table.size() - 1;
+    auto gap = pos;
+    for (auto j = (pos + 1) & mask; table[j] != npos; j = (j + 1) & mask) {
+        const Slot &s = *_entries[table[j]];
+        auto home = slot_hash(s, key) & mask;
+        if (((j - home) & mask) >= ((j - gap) & mask)) {
+            table[gap] = table[j];
+            gap = j;
+        }
+    }
+    table[gap] = npos;
+}
+
+void OrderRegistry::grow(Table &table, Key key) {
+    table.assign(std::max<std::size_t>(16, table.size() * 2), npos);
+    for (std::uint32_t idx = 0; idx < _entries.size(); ++idx) {
+        const auto &s = _entries[idx];
+        if (!s.has_value()) continue;
+        switch (key) {
+            case Key::order: table_insert(table, s->order_hash, idx); break;
+            case Key::id: if (!s->e.id.empty()) table_insert(table, s->id_hash, idx); break;
+            case Key::alias: if (s->e.alias) table_insert(table, s->alias_hash, idx); break;
+        }
+    }
+}
+
+}
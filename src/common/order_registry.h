@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../trading_ifc/order.h"
+#include "event_target.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace trading_api {
+
+///Registry of live orders, indexed by order handle, by exchange order ID and by alias
+/**
+ * Entries are stored in a slab, lookup goes through open-addressing
+ * tables (linear probing, backward shift deletion), so routing of a report
+ * is a hash and few adjacent reads
+ *
+ * @note pointers to entries are valid until next insertion or erasure. Object
+ * is not MT safe
+ */
+class OrderRegistry {
+public:
+
+    struct Entry {
+        ///order
+        Order order;
+        ///target which receives events of the order
+        IEventTarget *target = nullptr;
+        ///if defined, events are reported with this order instead (use set_alias())
+        Order alias;
+        ///exchange order ID, empty if not known
+        std::string id;
+    };
+
+    ///Find entry by order
+    /**
+     * @param order order
+     * @return pointer to entry or nullptr
+     */
+    Entry *find(const Order &order);
+    ///Find entry by exchange order ID
+    /**
+     * @param id order id
+     * @return pointer to entry or nullptr
+     */
+    Entry *find(std::string_view id);
+
+    ///Find entry by alias
+    /**
+     * @param alias order known by the target
+     * @return pointer to entry, which has this alias, or nullptr
+     */
+    Entry *find_alias(const Order &alias);
+
+    const Entry *find(const Order &order) const {
+        return const_cast<OrderRegistry *>(this)->find(order);
+    }
+    const Entry *find(std::string_view id) const {
+        return const_cast<OrderRegistry *>(this)->find(id);
+    }
+    const Entry *find_alias(const Order &alias) const {
+        return const_cast<OrderRegistry *>(this)->find_alias(alias);
+    }
+
+    ///Insert new order
+    /**
+     * @param order order
+     * @param target event target
+     * @return pointer to entry and true if inserted, or pointer to existing entry
+     * and false (the entry is not changed)
+     */
+    std::pair<Entry *, bool> emplace(const Order &order, IEventTarget *target);
+
+    ///Assign exchange order ID to the entry
+    /**
+     * @param e entry
+     * @param id new id. Empty string removes entry from ID index. If the
+     * ID is already assigned to other entry, the other entry loses the ID
+     */
+    void set_id(Entry *e, std::string_view id);
+
+    ///Assign alias to the entry
+    /**
+     * @param e entry
+     * @param alias new alias. Null order removes entry from alias index. If the
+     * alias is already assigned to other entry, the other entry loses the alias
+     */
+    void set_alias(Entry *e, const Order &alias);
+
+    ///Erase entry
+    void erase(Entry *e);
+    ///Erase order
+    /**
+     * @param order order
+     * @retval true erased
+     * @retval false not found
+     */
+    bool erase(const Order &order);
+
+    ///Erase all entries for which predicate returns true
+    template<typename Fn>
+    void erase_if(Fn &&pred) {
+        for (auto &s: _entries) {
+            if (s.has_value() && pred(static_cast<const Entry &>(s->e))) erase(&s->e);
+        }
+    }
+
+    std::size_t size() const {return _count;}
+    bool empty() const {return _count == 0;}
+    void clear();
+
+protected:
+
+    static constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+    struct Slot {
+        Entry e;
+        std::size_t order_hash;
+        std::size_t id_hash;
+        std::size_t alias_hash;
+    };
+
+    enum class Key {order, id, alias};
+
+    using Table = std::vector<std::uint32_t>;
+
+    std::vector<std::optional<Slot> > _entries;
+    std::vector<std::uint32_t> _free;
+    Table _by_order;
+    Table _by_id;
+    Table _by_alias;
+    std::size_t _count = 0;
+    std::size_t _id_count = 0;
+    std::size_t _alias_count = 0;
+
+    static std::size_t hash_order(const Order &order);
+    static std::size_t hash_id(std::string_view id);
+
+    std::uint32_t find_index(const Order &order) const;
+    void erase_index(std::uint32_t idx);
+    static std::size_t slot_hash(const Slot &s, Key key);
+    void grow(Table &table, Key key);
+    void table_insert(Table &table, std::size_t hash, std::uint32_t idx);
+    void table_erase(Table &table, std::size_t pos, Key key);
+    std::size_t find_pos(const Table &table, std::size_t hash, std::uint32_t idx) const;
+};
+
+}
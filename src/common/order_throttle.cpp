@@ -0,0 +1,124 @@
+#include "order_throttle.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace trading_api {
+
+void OrderThrottle::set_config(const Config &cfg) {
+    _cfg = cfg;
+    _cfg.burst = std::max(_cfg.burst, 1.0);
+    _tokens = std::min(_tokens, _cfg.burst);
+}
+
+static std::optional<Side> order_side(const Order &order) {
+    return std::visit([](const auto &x) -> std::optional<Side> {
+        if constexpr(requires {x.side;}) {
+            return x.side;
+        } else {
+            return {};
+        }
+    }, order.get_setup());
+}
+
+std::deque<OrderThrottle::Request>::iterator OrderThrottle::find_place(const Order &order) {
+    return std::find_if(_queue.begin(), _queue.end(), [&](const Request &r){
+        return !r.cancel && r.order == order;
+    });
+}
+
+void OrderThrottle::cancel(const Order &order) {
+    auto iter = find_place(order);
+    if (iter != _queue.end()) {
+        _dropped.push_back(order);
+        ++_stats.canceled_unsent;
+        if (iter->replaces) {
+            //the predecessor is still on exchange and it must be canceled
+            *iter = Request{iter->replaces, {}, false, true, false, iter->deferred};
+        } else {
+            _queue.erase(iter);
+        }
+        return;
+    }
+    bool dup = std::any_of(_queue.begin(), _queue.end(), [&](const Request &r){
+        return r.cancel && r.order == order;
+    });
+    if (dup) {
+        ++_stats.duplicate_cancels;
+        return;
+    }
+    _queue.push_back(Request{order, {}, false, true});
+}
+
+void OrderThrottle::place(const PlaceRequest &req) {
+    if (req.replaces) {
+        auto iter = find_place(req.replaces);
+        if (iter != _queue.end()) {
+            //replaced order was not sent, so replace its predecessor directly
+            _dropped.push_back(iter->order);
+            ++_stats.superseded;
+            bool amend = iter->replaces && iter->amend && req.amend;
+            *iter = Request{req.order, iter->replaces, amend, false, true, iter->deferred};
+            return;
+        }
+    } else {
+        auto instrument = req.order.get_instrument();
+        auto account = req.order.get_account();
+        auto side = order_side(req.order);
+        //order on the other side is not a successor of the canceled order
+        auto iter = !side?_queue.end():std::find_if(_queue.begin(), _queue.end(), [&](const Request &r){
+            return r.cancel && r.order.get_instrument() == instrument
+                    && r.order.get_account() == account
+                    && order_side(r.order) == side;
+        });
+        if (iter != _queue.end()) {
+            ++_stats.merged;
+            *iter = Request{req.order, iter->order, false, false, true, iter->deferred};
+            return;
+        }
+    }
+    _queue.push_back(Request{req.order, req.replaces, req.amend, false});
+}
+
+void OrderThrottle::refill(Timestamp now) {
+    if (_last_refill == Timestamp::min()) {
+        _tokens = _cfg.burst;
+    } else if (now > _last_refill) {
+        double secs = std::chrono::duration<double>(now - _last_refill).count();
+        _tokens = std::min(_cfg.burst, _tokens + secs * _cfg.rate);
+    } else {
+        return;
+    }
+    _last_refill = now;
+}
+
+void OrderThrottle::dispatch(Timestamp now, Result &result) {
+    result.send.clear();
+    result.dropped.clear();
+    std::swap(result.dropped, _dropped);
+    result.next = Timestamp::max();
+    if (!enabled()) {
+        _stats.sent += _queue.size();
+        result.send.insert(result.send.end(), _queue.begin(), _queue.end());
+        _queue.clear();
+        return;
+    }
+    refill(now);
+    while (!_queue.empty() && _tokens >= 1.0) {
+        result.send.push_back(std::move(_queue.front()));
+        _queue.pop_front();
+        _tokens -= 1.0;
+        ++_stats.sent;
+    }
+    if (_queue.empty()) return;
+    for (auto &r: _queue) {
+        if (!r.deferred) {
+            r.deferred = true;
+            ++_stats.deferred;
+        }
+    }
+    auto wait = std::chrono::duration<double>((1.0 - _tokens) / _cfg.rate);
+    result.next = _last_refill + std::chrono::ceil<Timestamp::duration>(wait);
+}
+
+}
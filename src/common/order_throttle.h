@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../trading_ifc/order.h"
+#include "../trading_ifc/timer.h"
+
+#include <deque>
+#include <vector>
+
+namespace trading_api {
+
+///Request to place an order
+struct PlaceRequest {
+    ///order to place
+    Order order;
+    ///order which is replaced by this order (null if new order)
+    Order replaces;
+    ///replace is amend
+    bool amend = false;
+};
+
+///Token bucket limiting rate of order requests sent to an exchange
+/**
+ * Every request (place, replace, cancel) consumes one token. Tokens are
+ * refilled at configured rate up to the size of the bucket. Requests which
+ * cannot be sent are kept in queue. While requests are waiting, they can be
+ * merged, so the exchange receives fewer requests with the same effect
+ *
+ * - cancel of an order, which has not been sent yet, removes both requests
+ * - replace of an order, which has not been sent yet, takes the slot of the
+ *   superseded order and replaces its predecessor directly
+ * - cancel followed by a new order on the same instrument, account and side
+ *   is merged into a replace
+ * - duplicate cancels are removed
+ *
+ * Orders removed from the queue are reported as dropped and must be
+ * reported to the strategy as canceled. Merged requests are marked as
+ * rewritten, the caller must create new order for them (see Request)
+ *
+ * The object is not MT safe, the owner must lock it
+ */
+class OrderThrottle {
+public:
+
+    struct Config {
+        ///sustained rate in requests per second. Zero disables the throttle
+        double rate = 0;
+        ///max count of requests sent at once
+        double burst = 1;
+    };
+
+    struct Stats {
+        ///requests passed to the exchange
+        std::size_t sent = 0;
+        ///requests which had to wait for a token
+        std::size_t deferred = 0;
+        ///cancel+place pairs merged into replace
+        std::size_t merged = 0;
+        ///replaces of unsent orders merged with the order
+        std::size_t superseded = 0;
+        ///unsent orders removed by cancel
+        std::size_t canceled_unsent = 0;
+        ///duplicate cancels removed
+        std::size_t duplicate_cancels = 0;
+    };
+
+    struct Request {
+        ///order to place or to cancel
+        Order order;
+        ///place: order to replace (null for new order)
+        Order replaces;
+        ///place: replace is amend
+        bool amend = false;
+        ///request is cancel
+        bool cancel = false;
+        ///place: the order must be recreated using replaces and amend, because
+        ///the original order refers to a different predecessor
+        bool rewritten = false;
+        ///request has been already counted as deferred
+        bool deferred = false;
+    };
+
+    struct Result {
+        ///requests to send
+        std::vector<Request> send;
+        ///orders removed from the queue, report them as canceled
+        std::vector<Order> dropped;
+        ///time when next request can be sent, Timestamp::max() if queue is empty
+        Timestamp next = Timestamp::max();
+    };
+
+    ///Set configuration
+    void set_config(const Config &cfg);
+    const Config &get_config() const {return _cfg;}
+    ///returns true if throttle is enabled
+    bool enabled() const {return _cfg.rate > 0;}
+
+    ///Enqueue cancel request
+    /**
+     * @param order order to cancel
+     */
+    void cancel(const Order &order);
+    ///Enqueue place request
+    /**
+     * @param req place request
+     */
+    void place(const PlaceRequest &req);
+
+    ///Retrieve requests which can be sent now
+    /**
+     * @param now current time
+     * @param result receives requests. Content of the object is replaced
+     */
+    void dispatch(Timestamp now, Result &result);
+
+    ///returns true if there are no waiting requests
+    bool empty() const {return _queue.empty();}
+
+    const Stats &get_stats() const {return _stats;}
+
+protected:
+    Config _cfg;
+    Stats _stats;
+    std::deque<Request> _queue;
+    std::vector<Order> _dropped;
+    double _tokens = 0;
+    Timestamp _last_refill = Timestamp::min();
+
+    std::deque<Request>::iterator find_place(const Order &order);
+    void refill(Timestamp now);
+};
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace trading_api {
+
+///Sequence lock - single writer, lock-free readers
+/**
+ * Readers never block the writer. The reader copies the value and retries
+ * when the writer modified it during the copy. Suitable for small
+ * trivially copyable values updated often (tickers)
+ *
+ * @tparam T type of value
+ *
+ * @note writers must be serialized by the caller
+ */
+template<typename T>
+requires(std::is_trivially_copyable_v<T>)
+class SeqLock {
+public:
+
+    ///store new value
+    void store(const T &val) {
+        Words tmp = {};
+        std::memcpy(tmp.data(), &val, sizeof(T));
+        auto seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < word_count; ++i) {
+            _data[i].store(tmp[i], std::memory_order_relaxed);
+        }
+        _seq.store(seq+2, std::memory_order_release);
+    }
+
+    ///load value
+    /**
+     * @param val variable which receives value
+     * @retval true loaded
+     * @retval false no value has been stored yet
+     */
+    bool load(T &val) const {
+        Words tmp;
+        std::uint64_t seq1, seq2;
+        do {
+            seq1 = _seq.load(std::memory_order_acquire);
+            if (seq1 == 0) return false;
+            for (std::size_t i = 0; i < word_count; ++i) {
+                tmp[i] = _data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq2 = _seq.load(std::memory_order_relaxed);
+        } while (seq1 != seq2 || (seq1 & 1));
+        std::memcpy(static_cast<void *>(&val), tmp.data(), sizeof(T));
+        return true;
+    }
+
+protected:
+    static constexpr std::size_t word_count = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    using Words = std::array<std::uint64_t, word_count>;
+
+    ///odd while the value is written, 0 - never written. 64 bits never wrap
+    std::atomic<std::uint64_t> _seq = 0;
+    std::array<std::atomic<std::uint64_t>, word_count> _data = {};
+};
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <optional>
+#include <vector>
+
+namespace trading_api {
+
+///Bounded lock-free queue for single producer and single consumer
+/**
+ * The producer and the consumer never wait for each other. When the queue
+ * is full, push fails and the producer must decide what to do.
+ *
+ * @tparam T type of item
+ */
+template<typename T>
+class SPSCQueue {
+public:
+
+    ///construct queue
+    /**
+     * @param capacity capacity, rounded up to power of two
+     */
+    explicit SPSCQueue(std::size_t capacity)
+        :_items(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+        ,_mask(_items.size()-1) {}
+
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+    ///push item (producer only)
+    /**
+     * @param val item
+     * @retval true pushed
+     * @retval false queue is full, the item was not moved
+     */
+    template<typename X>
+    bool try_push(X &&val) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache > _mask) {
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache > _mask) return false;
+        }
+        _items[tail & _mask].emplace(std::forward<X>(val));
+        _tail.store(tail+1, std::memory_order_release);
+        return true;
+    }
+
+    ///pop item (consumer only)
+    /**
+     * @param val variable which receives item
+     * @retval true item retrieved
+     * @retval false queue is empty
+     */
+    bool try_pop(T &val) {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache) return false;
+        }
+        auto &item = _items[head & _mask];
+        val = std::move(*item);
+        item.reset();
+        _head.store(head+1, std::memory_order_release);
+        return true;
+    }
+
+    ///returns true if queue is empty (approximate when called by the producer)
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {return _items.size();}
+
+protected:
+    std::vector<std::optional<T> > _items;
+    std::size_t _mask;
+    ///read position, written by consumer
+    alignas(64) std::atomic<std::size_t> _head = 0;
+    ///consumer's copy of _tail
+    std::size_t _tail_cache = 0;
+    ///write position, written by producer
+    alignas(64) std::atomic<std::size_t> _tail = 0;
+    ///producer's copy of _head
+    std::size_t _head_cache = 0;
+};
+
+}
@@ -25,7 +25,14 @@ public:
     ///discard writes
     virtual void rollback() = 0;
     ///determine, whether given fill is duplicate
+    /**
+     * Fill is duplicate, when stored fill is the same fill (see is_same_fill())
+     */
     virtual bool is_duplicate_fill(const Fill &fill) const = 0;
+    ///returns true, if both fills are the same fill (same id and time)
+    static bool is_same_fill(const Fill &a, const Fill &b) {
+        return a.time == b.time && a.id == b.id;
+    }
     ///load recent fills
     /**
      * @param limit limit in count
@@ -42,6 +49,29 @@ public:
      * @return fills
      */
     virtual Fills load_fills(Timestamp limit, std::string_view filter = {}) const = 0;
+    ///enumerate recent fills, newest first
+    /**
+     * Streaming variant of load_fills(), fills are passed to the callback
+     * without building the result
+     *
+     * @param limit limit in count
+     * @param filter label prefix
+     * @param fn callback
+     */
+    virtual void enum_fills(std::size_t limit, std::string_view filter,
+            Function<void(const Fill &)> &fn) const {
+        for (const Fill &f: load_fills(limit, filter)) fn(f);
+    }
+    ///enumerate recent fills, newest first
+    /**
+     * @param limit limit as old timestamp. No older fills are enumerated
+     * @param filter label prefix
+     * @param fn callback
+     */
+    virtual void enum_fills(Timestamp limit, std::string_view filter,
+            Function<void(const Fill &)> &fn) const {
+        for (const Fill &f: load_fills(limit, filter)) fn(f);
+    }
     ///load all open orders (stored binary)
     virtual std::vector<SerializedOrder> load_open_orders() const = 0;
 
@@ -0,0 +1,23 @@
+#include "tsc_clock.h"
+
+#include <thread>
+
+namespace trading_api {
+
+TscClock TscClock::calibrate(std::chrono::milliseconds period) {
+    TscClock out;
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    auto t1 = std::chrono::steady_clock::now();
+    auto c1 = now();
+    std::this_thread::sleep_for(period);
+    auto t2 = std::chrono::steady_clock::now();
+    auto c2 = now();
+    double ns = std::chrono::duration<double, std::nano>(t2 - t1).count();
+    if (c2 > c1 && ns > 0) out._ns_per_tick = ns / static_cast<double>(c2 - c1);
+#else
+    (void)period;
+#endif
+    return out;
+}
+
+}
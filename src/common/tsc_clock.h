@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace trading_api {
+
+///Clock which reads CPU time stamp counter
+/**
+ * Reading of the counter costs few nanoseconds and doesn't enter the kernel,
+ * so it can be used to stamp events on hot path. Ticks are converted to
+ * nanoseconds using ratio measured by calibrate(). On platforms without
+ * time stamp counter, the steady clock is used (one tick is one nanosecond)
+ *
+ * @note counter is expected to be invariant (constant rate, synchronized
+ * between cores), which is true for all current x86 processors
+ */
+class TscClock {
+public:
+
+    ///Read counter
+    static std::uint64_t now() noexcept {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    ///Measure tick rate
+    /**
+     * @param period duration of measurement. Function blocks for this time
+     * @return calibrated clock
+     */
+    static TscClock calibrate(std::chrono::milliseconds period = std::chrono::milliseconds(20));
+
+    ///Convert ticks to nanoseconds
+    double to_ns(std::uint64_t ticks) const {return static_cast<double>(ticks) * _ns_per_tick;}
+
+    ///count of ticks per one nanosecond
+    double get_ticks_per_ns() const {return 1.0/_ns_per_tick;}
+
+protected:
+    double _ns_per_tick = 1.0;
+};
+
+}
@@ -0,0 +1,157 @@
+#include "var_store.h"
+
+#include <algorithm>
+
+namespace trading_api {
+
+namespace {
+
+void write_varint(std::string &out, std::size_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+std::size_t read_varint(std::string_view data, std::size_t &pos) {
+    std::size_t v = 0;
+    int shift = 0;
+    while (true) {
+        auto c = static_cast<unsigned char>(data[pos++]);
+        v |= static_cast<std::size_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return v;
+        shift += 7;
+    }
+}
+
+}
+
+void VarStore::RunCursor::read_entry() {
+    std::string_view data = _owner._data;
+    if (_pos >= data.size()) {
+        _valid = false;
+        return;
+    }
+    std::size_t shared = read_varint(data, _pos);
+    std::size_t unshared = read_varint(data, _pos);
+    std::size_t vsize = read_varint(data, _pos);
+    _key.resize(shared);
+    _key.append(data.substr(_pos, unshared));
+    _pos += unshared;
+    _value = data.substr(_pos, vsize);
+    _pos += vsize;
+    _valid = true;
+}
+
+void VarStore::RunCursor::seek(std::string_view key) {
+    const auto &restarts = _owner._restarts;
+    std::string_view data = _owner._data;
+    //find last restart point with key not greater than searched key
+    auto restart_key = [&](std::uint32_t offset) {
+        std::size_t pos = offset;
+        read_varint(data, pos);
+        std::size_t unshared = read_varint(data, pos);
+        read_varint(data, pos);
+        return data.substr(pos, unshared);
+    };
+    auto iter = std::upper_bound(restarts.begin(), restarts.end(), key, [&](std::string_view k, std::uint32_t offset) {
+        return k < restart_key(offset);
+    });
+    _pos = iter == restarts.begin()?0:*(iter - 1);
+    _key.clear();
+    read_entry();
+    while (_valid && std::string_view(_key) < key) read_entry();
+}
+
+std::optional<std::string_view> VarStore::find_run(std::string_view key) const {
+    if (_data.empty()) return {};
+    RunCursor c(*this);
+    c.seek(key);
+    if (c.valid() && c.key() == key) return c.value();
+    return {};
+}
+
+std::optional<std::string> VarStore::get(std::string_view key) const {
+    auto iter = _delta.find(key);
+    if (iter != _delta.end()) return iter->second;
+    auto v = find_run(key);
+    if (v.has_value()) return std::string(*v);
+    return {};
+}
+
+bool VarStore::contains(std::string_view key) const {
+    auto iter = _delta.find(key);
+    if (iter != _delta.end()) return iter->second.has_value();
+    return find_run(key).has_value();
+}
+
+void VarStore::put(std::string_view key, std::string_view value) {
+    if (!contains(key)) ++_count;
+    auto iter = _delta.find(key);
+    if (iter == _delta.end()) _delta.emplace(key, std::string(value));
+    else if (iter->second.has_value()) iter->second->assign(value);   //reuse buffer
+    else iter->second.emplace(value);
+    check_compact();
+}
+
+bool VarStore::erase(std::string_view key) {
+    auto iter = _delta.find(key);
+    bool in_run = find_run(key).has_value();
+    if (iter != _delta.end()) {
+        if (!iter->second.has_value()) return false;
+        //tombstone is needed only if the run contains the key
+        if (in_run) iter->second.reset();
+        else _delta.erase(iter);
+    } else {
+        if (!in_run) return false;
+        _delta.emplace(key, std::nullopt);
+    }
+    --_count;
+    check_compact();
+    return true;
+}
+
+void VarStore::clear() {
+    _data.clear();
+    _restarts.clear();
+    _run_count = 0;
+    _delta.clear();
+    _count = 0;
+}
+
+void VarStore::check_compact() {
+    if (_delta.size() > std::max(min_delta, _run_count / 4)) compact();
+}
+
+void VarStore::compact() {
+    if (_delta.empty()) return;
+    std::string data;
+    std::vector<std::uint32_t> restarts;
+    std::string last_key;
+    std::size_t n = 0;
+    data.reserve(_data.size() + _data.size() / 4);
+    for_each([&](std::string_view k, std::string_view v) {
+        std::size_t shared = 0;
+        if (n % restart_interval == 0) {
+            restarts.push_back(static_cast<std::uint32_t>(data.size()));
+        } else {
+            auto lim = std::min(k.size(), last_key.size());
+            while (shared < lim && k[shared] == last_key[shared]) ++shared;
+        }
+        write_varint(data, shared);
+        write_varint(data, k.size() - shared);
+        write_varint(data, v.size());
+        data.append(k.substr(shared));
+        data.append(v);
+        last_key.assign(k);
+        ++n;
+    });
+    _data = std::move(data);
+    _data.shrink_to_fit();
+    _restarts = std::move(restarts);
+    _run_count = n;
+    _delta.clear();
+}
+
+}
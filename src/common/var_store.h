@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace trading_api {
+
+///Ordered key-value store optimized for many small entries
+/**
+ * Most entries are kept in single sorted run - a buffer of prefix compressed
+ * entries (every entry stores only suffix of the key which differs from the
+ * previous key). Every restart_interval entry contains full key, lookup
+ * uses binary search over these restart points and then decodes at most
+ * restart_interval entries.
+ *
+ * Recent writes are kept in small ordered map (delta), erased keys are stored
+ * as empty values. Reads and scans merge the delta with the run. When the delta
+ * grows (relative to size of the run), it is merged into new run.
+ *
+ * @code
+ * entry: | shared:varint | unshared:varint | value_size:varint | key suffix | value |
+ * @endcode
+ *
+ * @note object is not MT safe. The store must not be modified during enumeration
+ */
+class VarStore {
+public:
+
+    ///Retrieve value
+    /**
+     * @param key key
+     * @return value, or no value if the key doesn't exist
+     */
+    std::optional<std::string> get(std::string_view key) const;
+    ///Determine whether the key exists
+    bool contains(std::string_view key) const;
+    ///Set value (overwrite existing)
+    void put(std::string_view key, std::string_view value);
+    ///Erase key
+    /**
+     * @param key key
+     * @retval true erased
+     * @retval false not found
+     */
+    bool erase(std::string_view key);
+    ///Remove all entries
+    void clear();
+    ///Count of entries
+    std::size_t size() const {return _count;}
+    bool empty() const {return _count == 0;}
+
+    ///Enumerate range of keys
+    /**
+     * @param start first key
+     * @param end last key (inclusive)
+     * @param fn function called with key and value
+     */
+    template<typename Fn>
+    void range(std::string_view start, std::string_view end, Fn &&fn) const {
+        scan(start, [&](std::string_view k, std::string_view v) {
+            if (k > end) return false;
+            fn(k, v);
+            return true;
+        });
+    }
+
+    ///Enumerate keys with given prefix
+    /**
+     * @param prefix prefix
+     * @param fn function called with key and value
+     */
+    template<typename Fn>
+    void prefix(std::string_view prefix, Fn &&fn) const {
+        scan(prefix, [&](std::string_view k, std::string_view v) {
+            if (k.substr(0, prefix.size()) != prefix) return false;
+            fn(k, v);
+            return true;
+        });
+    }
+
+    ///Enumerate all keys
+    template<typename Fn>
+    void for_each(Fn &&fn) const {
+        scan({}, [&](std::string_view k, std::string_view v) {
+            fn(k, v);
+            return true;
+        });
+    }
+
+    ///Merge recent writes into the sorted run
+    void compact();
+
+    ///Retrieve size of the sorted run in bytes (including restart points)
+    std::size_t get_run_size() const {
+        return _data.size() + _restarts.size() * sizeof(std::uint32_t);
+    }
+
+protected:
+
+    ///count of entries between keys stored in full
+    static constexpr std::size_t restart_interval = 16;
+    ///minimal size of delta which triggers compaction
+    static constexpr std::size_t min_delta = 64;
+
+    ///sorted run of prefix compressed entries
+    std::string _data;
+    ///offsets of entries with full key
+    std::vector<std::uint32_t> _restarts;
+    ///count of entries in the run
+    std::size_t _run_count = 0;
+    ///recent writes, no value - key is erased
+    std::map<std::string, std::optional<std::string>, std::less<> > _delta;
+    ///count of existing keys
+    std::size_t _count = 0;
+
+    ///Iterates the sorted run
+    class RunCursor {
+    public:
+        explicit RunCursor(const VarStore &owner):_owner(owner) {}
+        ///move to first entry which is not less than the key
+        void seek(std::string_view key);
+        void next() {read_entry();}
+        bool valid() const {return _valid;}
+        std::string_view key() const {return _key;}
+        std::string_view value() const {return _value;}
+    protected:
+        const VarStore &_owner;
+        std::size_t _pos = 0;
+        std::string _key;
+        std::string_view _value;
+        bool _valid = false;
+        void read_entry();
+    };
+
+    ///find value in the run (valid until next compaction)
+    std::optional<std::string_view> find_run(std::string_view key) const;
+    void check_compact();
+
+    ///enumerate merged entries from key, until fn returns false
+    template<typename Fn>
+    void scan(std::string_view start, Fn &&fn) const {
+        RunCursor c(*this);
+        c.seek(start);
+        auto d = _delta.lower_bound(start);
+        while (c.valid() || d != _delta.end()) {
+            if (d == _delta.end() || (c.valid() && c.key() < d->first)) {
+                if (!fn(c.key(), c.value())) return;
+                c.next();
+            } else {
+                //delta overrides the run
+                if (c.valid() && c.key() == d->first) c.next();
+                if (d->second.has_value() && !fn(std::string_view(d->first), std::string_view(*d->second))) return;
+                ++d;
+            }
+        }
+    }
+};
+
+}
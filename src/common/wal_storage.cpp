@@ -0,0 +1,461 @@
+#include "wal_storage.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trading_api {
+
+static constexpr std::size_t index_initial_capacity = 4096;
+
+static constexpr std::array<std::uint32_t, 256> crc32_table = []{
+    std::array<std::uint32_t, 256> t = {};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1)?(0xEDB88320U ^ (c >> 1)):(c >> 1);
+        t[i] = c;
+    }
+    return t;
+}();
+
+std::uint32_t WalStorage::crc32(std::string_view data, std::uint32_t crc) {
+    std::uint32_t c = crc ^ 0xFFFFFFFFU;
+    for (unsigned char b: data) c = crc32_table[(c ^ b) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFU;
+}
+
+[[noreturn]] static void throw_errno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+static void write_all(int fd, const char *data, std::size_t size, std::uint64_t offset, const std::string &pathname) {
+    while (size) {
+        auto r = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("WalStorage: write failed: " + pathname);
+        }
+        data += r;
+        size -= static_cast<std::size_t>(r);
+        offset += static_cast<std::uint64_t>(r);
+    }
+}
+
+WalStorage::WalStorage(std::string pathname, Config cfg)
+    :MemoryStorage(cfg.fill_window),_pathname(std::move(pathname)),_cfg(cfg) {
+    _fd = ::open(_pathname.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+    if (_fd < 0) throw_errno("WalStorage: unable to open: " + _pathname);
+    try {
+        open_index();
+        recover();
+    } catch (...) {
+        close_index();
+        ::close(_fd);
+        throw;
+    }
+    _syncer = std::thread([this]{syncer();});
+}
+
+WalStorage::~WalStorage() {
+    try {
+        flush();
+    } catch (...) {
+        //nothing to do here
+    }
+    {
+        std::lock_guard _(_sync_mx);
+        _stop = true;
+    }
+    _sync_cond.notify_all();
+    _syncer.join();
+    close_index();
+    ::close(_fd);
+}
+
+void WalStorage::recover() {
+    struct stat st;
+    if (::fstat(_fd, &st) != 0) throw_errno("WalStorage: unable to stat: " + _pathname);
+    auto size = static_cast<std::uint64_t>(st.st_size);
+    if (size == 0) {
+        //snapshot of previous log can't be used
+        ::unlink((_pathname + ".snap").c_str());
+        std::uint32_t hdr[2] = {magic, version};
+        write_all(_fd, reinterpret_cast<const char *>(hdr), header_size, 0, _pathname);
+        _written = _synced = header_size;
+        _idx->count = 0;
+        return;
+    }
+    if (size < header_size) throw std::runtime_error("WalStorage: not a log file: " + _pathname);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (map == MAP_FAILED) throw_errno("WalStorage: unable to map: " + _pathname);
+    std::string_view data(static_cast<const char *>(map), size);
+    std::uint64_t pos = header_size;
+    std::uint64_t n = 0;
+    try {
+        std::uint32_t hdr[2];
+        std::memcpy(hdr, data.data(), header_size);
+        if (hdr[0] != magic || hdr[1] != version) {
+            throw std::runtime_error("WalStorage: not a log file or unsupported version: " + _pathname);
+        }
+        if (auto snap_end = load_snapshot(data)) {
+            pos = snap_end;
+            n = _seq;
+            if (_idx->count < n || index_entries()[n-1] != pos) {
+                //index doesn't cover the snapshot, walk headers of frames
+                _idx->count = 0;
+                std::uint64_t p = header_size;
+                for (std::uint64_t i = 0; i < n; ++i) {
+                    std::uint32_t fsz;
+                    std::memcpy(&fsz, data.data() + p, 4);
+                    p += frame_header_size + fsz;
+                    index_push(p);
+                }
+            }
+        }
+        while (size - pos >= frame_header_size) {
+            std::uint32_t fsz;
+            std::uint32_t fcrc;
+            std::uint64_t fseq;
+            std::memcpy(&fsz, data.data() + pos, 4);
+            std::memcpy(&fcrc, data.data() + pos + 4, 4);
+            std::memcpy(&fseq, data.data() + pos + 8, 8);
+            if (size - pos - frame_header_size < fsz) break;  //incomplete frame
+            if (fseq != _seq + 1) break;                        //garbage
+            auto payload = data.substr(pos + frame_header_size, fsz);
+            if (crc32(payload) != fcrc) break;                  //damaged frame
+            BinaryReader rd(payload);
+            apply_records(rd);
+            _seq = fseq;
+            _last_frame = pos;
+            pos += frame_header_size + fsz;
+            //validate index, rebuild it from first mismatch
+            if (n >= _idx->count || index_entries()[n] != pos) {
+                _idx->count = n;
+                index_push(pos);
+            }
+            ++n;
+        }
+    } catch (...) {
+        ::munmap(map, size);
+        throw;
+    }
+    ::munmap(map, size);
+    _idx->count = n;
+    _stats.recovered = n;
+    _stats.transactions = n;
+    _stats.discarded_bytes = size - pos;
+    if (pos != size) {
+        if (::ftruncate(_fd, static_cast<off_t>(pos)) != 0) throw_errno("WalStorage: unable to truncate: " + _pathname);
+        if (::fdatasync(_fd) != 0) throw_errno("WalStorage: sync failed: " + _pathname);
+    }
+    _written = _synced = pos;
+}
+
+std::uint64_t WalStorage::load_snapshot(std::string_view log) {
+    std::string name = _pathname + ".snap";
+    int fd = ::open(name.c_str(), O_RDONLY|O_CLOEXEC);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return 0;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return 0;
+    std::string_view data(static_cast<const char *>(map), size);
+    SnapshotHeader hdr;
+    std::memcpy(&hdr, data.data(), sizeof(hdr));
+    auto content = data.substr(sizeof(hdr));
+    //the snapshot must refer to the last frame of the same log
+    bool match = hdr.magic == snapshot_magic && hdr.version == version && hdr.seq > 0
+            && hdr.size == content.size()
+            && hdr.frame_offset >= header_size
+            && hdr.log_offset <= log.size()
+            && hdr.frame_offset + frame_header_size <= hdr.log_offset;
+    if (match) {
+        std::uint32_t fsz;
+        std::uint64_t fseq;
+        std::memcpy(&fsz, log.data() + hdr.frame_offset, 4);
+        std::memcpy(&fseq, log.data() + hdr.frame_offset + 8, 8);
+        match = fseq == hdr.seq && hdr.frame_offset + frame_header_size + fsz == hdr.log_offset
+                && crc32(content) == hdr.crc;
+    }
+    if (match) {
+        try {
+            BinaryReader rd(content);
+            MemoryStorage::load_state(rd);
+        } catch (const std::runtime_error &) {
+            //damaged content, start from empty storage
+            clear();
+            match = false;
+        }
+    }
+    ::munmap(map, size);
+    if (!match) return 0;
+    _seq = _snapshot_seq = _snapshot_file_seq = hdr.seq;
+    _last_frame = hdr.frame_offset;
+    _stats.from_snapshot = hdr.seq;
+    return hdr.log_offset;
+}
+
+void WalStorage::snapshot() {
+    if (_transaction_counter) throw std::logic_error("WalStorage: can't write snapshot during transaction");
+    //periodic snapshot of this state can be still pending, flush writes it
+    flush();
+    if (_seq == 0 || _seq == _snapshot_seq) return;
+    PendingSnapshot snap = freeze_snapshot();
+    write_snapshot(snap);
+    _snapshot_seq = _seq;
+}
+
+WalStorage::PendingSnapshot WalStorage::freeze_snapshot() {
+    if (_chunked_fills < _fills.size()) {
+        BinaryWriter wr;
+        save_fills(wr, _chunked_fills, _fills.size());
+        if (!_fill_chunks.empty() && _fill_chunks.back()->size() < fill_chunk_size) {
+            //chunk can be referenced by pending snapshot, so it is copied
+            auto chunk = std::make_shared<std::string>(*_fill_chunks.back());
+            chunk->append(wr.get_data());
+            _fill_chunks.back() = std::move(chunk);
+        } else {
+            _fill_chunks.push_back(std::make_shared<const std::string>(wr.get_data()));
+        }
+        _chunked_fills = _fills.size();
+    }
+    PendingSnapshot snap{{snapshot_magic, version, _seq, _last_frame, _written, 0, 0, 0}, {}, _fill_chunks};
+    save_head(snap.head);
+    snap.head.write_size(_fills.size());
+    snap.hdr.size = snap.head.get_data().size();
+    for (const auto &c: snap.fills) snap.hdr.size += c->size();
+    return snap;
+}
+
+void WalStorage::write_snapshot(PendingSnapshot &snap) {
+    std::lock_guard slk(_snapshot_mx);
+    if (snap.hdr.seq <= _snapshot_file_seq) return;
+    auto head = snap.head.get_data();
+    SnapshotHeader &hdr = snap.hdr;
+    hdr.crc = crc32(head);
+    for (const auto &c: snap.fills) hdr.crc = crc32(*c, hdr.crc);
+    std::string name = _pathname + ".snap";
+    std::string tmp = name + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if (fd < 0) throw_errno("WalStorage: unable to create snapshot: " + tmp);
+    try {
+        write_all(fd, reinterpret_cast<const char *>(&hdr), sizeof(hdr), 0, tmp);
+        std::uint64_t offset = sizeof(hdr);
+        write_all(fd, head.data(), head.size(), offset, tmp);
+        offset += head.size();
+        for (const auto &c: snap.fills) {
+            write_all(fd, c->data(), c->size(), offset, tmp);
+            offset += c->size();
+        }
+        if (::fdatasync(fd) != 0) throw_errno("WalStorage: sync failed: " + tmp);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    ::close(fd);
+    if (::rename(tmp.c_str(), name.c_str()) != 0) throw_errno("WalStorage: unable to replace snapshot: " + name);
+    _snapshot_file_seq = hdr.seq;
+    std::lock_guard _(_sync_mx);
+    ++_stats.snapshots;
+}
+
+void WalStorage::apply_transaction() {
+    auto payload = _transaction.get_data();
+    if (payload.empty()) return;
+    try {
+        append_frame(payload);
+    } catch (...) {
+        _transaction.clear();
+        throw;
+    }
+    MemoryStorage::apply_transaction();
+    if (_cfg.snapshot_interval && _seq - _snapshot_seq >= _cfg.snapshot_interval) {
+        //only serialization is done here, the sync thread writes the file
+        PendingSnapshot snap = freeze_snapshot();
+        {
+            std::lock_guard _(_sync_mx);
+            _pending_snapshot = std::move(snap);
+        }
+        _sync_cond.notify_one();
+        _snapshot_seq = _seq;
+    }
+}
+
+void WalStorage::load_state(BinaryReader &) {
+    throw std::logic_error("WalStorage: content can't be replaced");
+}
+
+void WalStorage::append_frame(std::string_view payload) {
+    if (payload.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("WalStorage: transaction is too large");
+    }
+    std::uint32_t sz = static_cast<std::uint32_t>(payload.size());
+    std::uint32_t crc = crc32(payload);
+    std::uint64_t seq = _seq + 1;
+    _frame.clear();
+    _frame.append(reinterpret_cast<const char *>(&sz), 4);
+    _frame.append(reinterpret_cast<const char *>(&crc), 4);
+    _frame.append(reinterpret_cast<const char *>(&seq), 8);
+    _frame.append(payload);
+    std::uint64_t offset = _written;
+    write_all(_fd, _frame.data(), _frame.size(), offset, _pathname);
+    _seq = seq;
+    _last_frame = offset;
+    std::uint64_t end = offset + _frame.size();
+    index_push(end);
+    bool wait;
+    {
+        std::lock_guard _(_sync_mx);
+        _written = end;
+        ++_stats.transactions;
+        wait = _cfg.sync_commit || _written - _synced > _cfg.max_unsynced;
+    }
+    _sync_cond.notify_one();
+    if (wait) wait_durable(end);
+}
+
+void WalStorage::flush() {
+    std::uint64_t end;
+    {
+        std::lock_guard _(_sync_mx);
+        end = _written;
+    }
+    wait_durable(end);
+    std::unique_lock lk(_sync_mx);
+    _durable_cond.wait(lk, [&]{return (!_pending_snapshot && !_snapshot_busy) || _sync_error;});
+}
+
+void WalStorage::wait_durable(std::uint64_t offset) {
+    std::unique_lock lk(_sync_mx);
+    if (_synced >= offset) return;
+    _sync_request = true;
+    _sync_cond.notify_one();
+    _durable_cond.wait(lk, [&]{return _synced >= offset || _sync_error;});
+    if (_sync_error) {
+        throw std::system_error(_sync_error, std::generic_category(), "WalStorage: sync failed: " + _pathname);
+    }
+}
+
+void WalStorage::syncer() {
+    std::unique_lock lk(_sync_mx);
+    while (true) {
+        _sync_cond.wait(lk, [&]{return _stop || _written > _synced || _pending_snapshot;});
+        if (_written > _synced) {
+            //collect more transactions into single sync
+            if (!_sync_request && !_stop) {
+                _sync_cond.wait_for(lk, _cfg.sync_delay, [&]{return _sync_request || _stop;});
+            }
+            std::uint64_t target = _written;
+            _sync_request = false;
+            lk.unlock();
+            int r = ::fdatasync(_fd);
+            int err = r?errno:0;
+            //index can be rebuilt from the log, so it is not synced
+            lk.lock();
+            if (err) {
+                _sync_error = err;
+            } else {
+                _synced = target;
+                ++_stats.syncs;
+            }
+            _durable_cond.notify_all();
+            if (err) break;
+        }
+        //snapshot must not refer to a transaction which is not durable
+        if (_pending_snapshot && _synced >= _pending_snapshot->hdr.log_offset) {
+            PendingSnapshot snap = std::move(*_pending_snapshot);
+            _pending_snapshot.reset();
+            _snapshot_busy = true;
+            lk.unlock();
+            bool ok = true;
+            try {
+                write_snapshot(snap);
+            } catch (...) {
+                ok = false;
+            }
+            lk.lock();
+            _snapshot_busy = false;
+            if (!ok) ++_stats.snapshot_errors;
+            _durable_cond.notify_all();
+        } else if (_stop && _written == _synced) {
+            break;      //stop requested, everything synced
+        }
+    }
+}
+
+std::uint64_t WalStorage::get_transaction_count() const {
+    return _idx->count;
+}
+
+std::uint64_t WalStorage::get_transaction_offset(std::uint64_t index) const {
+    if (index >= _idx->count) throw std::out_of_range("WalStorage: transaction index out of range");
+    return index_entries()[index];
+}
+
+WalStorage::Stats WalStorage::get_stats() const {
+    std::lock_guard _(_sync_mx);
+    return _stats;
+}
+
+void WalStorage::open_index() {
+    std::string name = _pathname + ".idx";
+    _idx_fd = ::open(name.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+    if (_idx_fd < 0) throw_errno("WalStorage: unable to open index: " + name);
+    struct stat st;
+    if (::fstat(_idx_fd, &st) != 0) throw_errno("WalStorage: unable to stat: " + name);
+    auto size = static_cast<std::size_t>(st.st_size);
+    bool init = size < sizeof(IndexHeader);
+    if (init) {
+        size = sizeof(IndexHeader) + index_initial_capacity * sizeof(std::uint64_t);
+        if (::ftruncate(_idx_fd, static_cast<off_t>(size)) != 0) throw_errno("WalStorage: unable to resize index: " + name);
+    }
+    void *map = ::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, _idx_fd, 0);
+    if (map == MAP_FAILED) throw_errno("WalStorage: unable to map index: " + name);
+    _idx = static_cast<IndexHeader *>(map);
+    _idx_capacity = (size - sizeof(IndexHeader)) / sizeof(std::uint64_t);
+    if (init || _idx->magic != magic || _idx->version != version || _idx->count > _idx_capacity) {
+        //invalid index, it is rebuilt during recovery
+        _idx->magic = magic;
+        _idx->version = version;
+        _idx->count = 0;
+    }
+}
+
+void WalStorage::close_index() {
+    if (_idx) ::munmap(_idx, sizeof(IndexHeader) + _idx_capacity * sizeof(std::uint64_t));
+    _idx = nullptr;
+    if (_idx_fd >= 0) ::close(_idx_fd);
+    _idx_fd = -1;
+}
+
+void WalStorage::index_push(std::uint64_t offset) {
+    if (_idx->count == _idx_capacity) {
+        std::size_t old_size = sizeof(IndexHeader) + _idx_capacity * sizeof(std::uint64_t);
+        std::size_t new_cap = _idx_capacity * 2;
+        std::size_t new_size = sizeof(IndexHeader) + new_cap * sizeof(std::uint64_t);
+        if (::ftruncate(_idx_fd, static_cast<off_t>(new_size)) != 0) throw_errno("WalStorage: unable to resize index");
+        void *map = ::mmap(nullptr, new_size, PROT_READ|PROT_WRITE, MAP_SHARED, _idx_fd, 0);
+        if (map == MAP_FAILED) throw_errno("WalStorage: unable to map index");
+        ::munmap(_idx, old_size);
+        _idx = static_cast<IndexHeader *>(map);
+        _idx_capacity = new_cap;
+    }
+    index_entries()[_idx->count] = offset;
+    ++_idx->count;
+}
+
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "memory_storage.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace trading_api {
+
+///Durable storage - append-only write-ahead log
+/**
+ * Content of the storage is kept in memory (see MemoryStorage), every committed
+ * transaction is appended to the log file as single frame protected by checksum.
+ * When the storage is opened, the log is replayed. Incomplete or damaged frame
+ * at the end of the log (crash during write) is discarded with everything
+ * after it, so the storage always recovers state after the last
+ * complete transaction.
+ *
+ * Transactions are written to the file immediately, but fsync is performed
+ * by a background thread, which joins all transactions committed during
+ * sync_delay into single fsync (group commit). Commit waits for the sync only
+ * when sync_commit is set, or when size of unsynced data exceeds max_unsynced.
+ *
+ * The storage also maintains index file (pathname + ".idx") mapped into
+ * memory, which contains end offset of every transaction. The index is
+ * validated against the log during opening and it is rebuilt when it doesn't match.
+ *
+ * @code
+ * log:   | header | frame | frame | ... |
+ * frame: | size:u32 | crc32:u32 | seq:u64 | record | record | ... |
+ * @endcode
+ *
+ * Records are the transaction log of MemoryStorage, which is written without
+ * conversion.
+ *
+ * Content of the storage can be saved as snapshot (pathname + ".snap"), either
+ * by snapshot() or periodically (snapshot_interval). The snapshot refers to the
+ * last transaction it contains. During opening, the snapshot is mapped into
+ * memory and loaded, and only the transactions after it are replayed. The snapshot
+ * which doesn't match the log is ignored and whole log is replayed.
+ *
+ * Periodic snapshot is serialized to memory during commit, then it is written
+ * and synced by the background thread. Fills are serialized incrementally,
+ * the commit serializes only fills added since the previous snapshot. The
+ * serialized fills are kept in memory and shared with the snapshots.
+ *
+ * @note object is not MT safe (except internal sync thread)
+ */
+class WalStorage: public MemoryStorage {
+public:
+
+    struct Config {
+        ///maximum delay between commit and fsync of the transaction
+        std::chrono::microseconds sync_delay = std::chrono::milliseconds(2);
+        ///commit blocks when amount of unsynced data exceeds this limit
+        std::size_t max_unsynced = 4*1024*1024;
+        ///commit waits until transaction is durable
+        bool sync_commit = false;
+        ///time window of fast duplicate fill detection (see MemoryStorage)
+        std::chrono::system_clock::duration fill_window = default_fill_window;
+        ///write snapshot after given count of transactions (0 - disabled). The
+        ///snapshot is written by the background thread
+        std::uint64_t snapshot_interval = 0;
+    };
+
+    struct Stats {
+        ///count of transactions written (including recovered)
+        std::uint64_t transactions = 0;
+        ///count of fsync calls
+        std::uint64_t syncs = 0;
+        ///count of transactions recovered during opening
+        std::uint64_t recovered = 0;
+        ///count of bytes discarded at the end of the log during recovery
+        std::uint64_t discarded_bytes = 0;
+        ///count of recovered transactions, which were loaded from snapshot
+        std::uint64_t from_snapshot = 0;
+        ///count of snapshots written
+        std::uint64_t snapshots = 0;
+        ///count of periodic snapshots, which were not written because of an error
+        std::uint64_t snapshot_errors = 0;
+    };
+
+    ///Open or create storage
+    /**
+     * @param pathname pathname of log file
+     * @param cfg configuration
+     * @exception std::runtime_error unable to open the log, or the file is not a log
+     */
+    WalStorage(std::string pathname, Config cfg);
+    explicit WalStorage(std::string pathname):WalStorage(std::move(pathname), Config{}) {}
+    WalStorage(const WalStorage &) = delete;
+    WalStorage &operator=(const WalStorage &) = delete;
+    ///Syncs the log and closes files
+    ~WalStorage();
+
+    ///Content can't be replaced, because it would diverge from the log
+    /**
+     * @exception std::logic_error always
+     */
+    virtual void load_state(BinaryReader &rd) override;
+
+    ///Wait until all committed transactions are durable and pending snapshot is written
+    void flush();
+
+    ///Write snapshot of the content
+    /**
+     * The log is synced first, so the snapshot never refers to a transaction
+     * which is not durable. The snapshot is written to temporary file, which
+     * replaces the previous snapshot when it is complete. Unlike periodic
+     * snapshot, it is written by the calling thread.
+     *
+     * @exception std::logic_error transaction is in progress
+     * @exception std::system_error unable to write the snapshot
+     */
+    void snapshot();
+
+    ///Retrieve count of transactions in the log
+    std::uint64_t get_transaction_count() const;
+    ///Retrieve offset of end of given transaction
+    /**
+     * @param index index of transaction (0 - first transaction)
+     * @return offset of the end of the transaction in the log
+     */
+    std::uint64_t get_transaction_offset(std::uint64_t index) const;
+
+    Stats get_stats() const;
+
+protected:
+
+    static constexpr std::uint32_t magic = 0x4C415754;   //"TWAL"
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t header_size = 8;
+    static constexpr std::size_t frame_header_size = 16;
+
+    static constexpr std::uint32_t snapshot_magic = 0x504E5354;   //"TSNP"
+
+    struct SnapshotHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        ///sequence number of the last transaction
+        std::uint64_t seq;
+        ///offset of the frame of the last transaction
+        std::uint64_t frame_offset;
+        ///offset of the end of the last transaction
+        std::uint64_t log_offset;
+        ///size of the content
+        std::uint64_t size;
+        ///checksum of the content
+        std::uint32_t crc;
+        std::uint32_t reserved;
+    };
+
+    struct IndexHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t count;
+    };
+
+    std::string _pathname;
+    Config _cfg;
+    int _fd = -1;
+    int _idx_fd = -1;
+    IndexHeader *_idx = nullptr;
+    std::size_t _idx_capacity = 0;
+
+    ///buffer for frame being written
+    std::string _frame;
+    std::uint64_t _seq = 0;
+    ///offset of the frame of the last transaction
+    std::uint64_t _last_frame = 0;
+    ///sequence number of the last snapshot (written or pending)
+    std::uint64_t _snapshot_seq = 0;
+
+    ///snapshot serialized by the writer, the file is written by the sync thread
+    struct PendingSnapshot {
+        SnapshotHeader hdr;
+        ///variables, orders and count of fills
+        BinaryWriter head;
+        ///serialized fills
+        std::vector<std::shared_ptr<const std::string> > fills;
+    };
+    ///chunks smaller than this are extended (copied) instead of adding new chunk
+    static constexpr std::size_t fill_chunk_size = 64*1024;
+    ///serialized fills, chunks are immutable, they are shared with snapshots
+    std::vector<std::shared_ptr<const std::string> > _fill_chunks;
+    ///count of fills in _fill_chunks
+    std::size_t _chunked_fills = 0;
+    ///serializes writing of snapshot files
+    std::mutex _snapshot_mx;
+    ///sequence number of the snapshot in the file
+    std::uint64_t _snapshot_file_seq = 0;
+
+    mutable std::mutex _sync_mx;
+    std::condition_variable _sync_cond;
+    std::condition_variable _durable_cond;
+    std::thread _syncer;
+    ///size of the log written
+    std::uint64_t _written = 0;
+    ///size of the log synced
+    std::uint64_t _synced = 0;
+    ///a writer waits for sync
+    bool _sync_request = false;
+    bool _stop = false;
+    ///errno of failed fsync (reported to the writer)
+    int _sync_error = 0;
+    ///snapshot waiting for sync of the log
+    std::optional<PendingSnapshot> _pending_snapshot;
+    ///pending snapshot is being written
+    bool _snapshot_busy = false;
+    Stats _stats;
+
+    void recover();
+    ///load snapshot, if it matches the log
+    /**
+     * @param log mapped log
+     * @return offset of the end of the transaction stored in the snapshot, or 0
+     * if the snapshot was not loaded
+     */
+    std::uint64_t load_snapshot(std::string_view log);
+    ///write transaction log as frame, then apply it
+    virtual void apply_transaction() override;
+    void append_frame(std::string_view payload);
+    void wait_durable(std::uint64_t offset);
+    void syncer();
+    ///serialize content for snapshot, only new fills are serialized
+    PendingSnapshot freeze_snapshot();
+    ///write snapshot file, older snapshot doesn't replace newer one
+    /**
+     * @exception std::system_error unable to write the snapshot
+     */
+    void write_snapshot(PendingSnapshot &snap);
+
+    void open_index();
+    void close_index();
+    void index_push(std::uint64_t offset);
+    std::uint64_t *index_entries() const {
+        return reinterpret_cast<std::uint64_t *>(_idx + 1);
+    }
+
+    ///calculate crc32, pass crc of previous data to continue calculation
+    static std::uint32_t crc32(std::string_view data, std::uint32_t crc = 0);
+};
+
+}
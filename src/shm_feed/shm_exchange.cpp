@@ -0,0 +1,292 @@
+#include <trading_api/exchange.h>
+#include <trading_api/module.h>
+
+#include "shm_feed.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace trading_api;
+
+///Instrument of shared memory feed - market data only, not tradable
+class ShmInstrument: public IInstrument {
+public:
+    ShmInstrument(std::string id, Exchange ex):_id(std::move(id)),_ex(std::move(ex)) {}
+
+    virtual const Config &get_config() const override {return _cfg;}
+    virtual std::string get_id() const override {return _id;}
+    virtual std::string get_label() const override {return _id;}
+    virtual std::string get_category() const override {return {};}
+    virtual Exchange get_exchange() const override {return _ex;}
+
+protected:
+    Config _cfg = {};
+    std::string _id;
+    Exchange _ex;
+};
+
+///Order returned for every order request - the feed doesn't support trading
+class ShmUnsupportedOrder: public IOrder::Null {
+public:
+    ShmUnsupportedOrder(Instrument i, Account a):_i(std::move(i)),_a(std::move(a)) {}
+    virtual State get_state() const override {return State::discarded;}
+    virtual Reason get_reason() const override {return Reason::unsupported;}
+    virtual std::string_view get_message() const override {return "Shared memory feed doesn't support trading";}
+    virtual Instrument get_instrument() const override {return _i;}
+    virtual Account get_account() const override {return _a;}
+    virtual Origin get_origin() const override {return Origin::strategy;}
+protected:
+    Instrument _i;
+    Account _a;
+};
+
+///Exchange which receives market data from shared memory feed
+/**
+ * The feed is written by a feed handler (see ShmFeedWriter and shm_feeder).
+ * The exchange reads the feed in own thread and passes tickers and
+ * orderbook updates to the exchange context. Orderbooks of all known
+ * instruments are maintained, so new subscriber receives full orderbook.
+ * Consecutive orderbook updates of the same instrument are passed as
+ * single batch
+ *
+ * When the reader is overrun, orderbook updates are lost. All orderbooks
+ * are cleared and updates are ignored until the feed sends next snapshot
+ * of the orderbook (book_clear followed by all levels)
+ */
+class ShmFeedExchange: public IExchangeService {
+public:
+
+    ~ShmFeedExchange() {
+        _stop = true;
+        if (_thr.joinable()) _thr.join();
+    }
+
+    virtual void init(ExchangeContext context, const StrategyConfig &config) override {
+        _ctx = context;
+        unsigned int feed_id = static_cast<int>(config["feed_id"]);
+        _idle_sleep = std::chrono::microseconds(static_cast<int>(config["idle_sleep_us"](50)));
+        _reader = std::make_unique<ShmFeedReader>(shm_feed::feed_name(feed_id));
+        _thr = std::thread([this]{worker();});
+    }
+
+    virtual StrategyConfigSchema get_config_schema() const override {
+        using namespace trading_api::params;
+        return {
+            Number("feed_id", 0, {.min = 0, .max = 65535, .step = 1}),
+            Number("idle_sleep_us", 50, {.min = 0, .max = 10000, .step = 1}),
+        };
+    }
+
+    virtual void subscribe(SubscriptionType type, const Instrument &i) override {
+        std::lock_guard _(_mx);
+        auto iter = _states.find(i.get_id());
+        if (iter == _states.end()) return;
+        State &st = *iter->second;
+        if (type == SubscriptionType::ticker) {
+            st.ticker.store(true, std::memory_order_relaxed);
+        } else {
+            st.orderbook.store(true, std::memory_order_relaxed);
+            //worker sends current orderbook
+            _snapshot_requests.push_back(&st);
+        }
+    }
+
+    virtual void unsubscribe(SubscriptionType type, const Instrument &i) override {
+        std::lock_guard _(_mx);
+        auto iter = _states.find(i.get_id());
+        if (iter == _states.end()) return;
+        if (type == SubscriptionType::ticker) iter->second->ticker.store(false, std::memory_order_relaxed);
+        else iter->second->orderbook.store(false, std::memory_order_relaxed);
+    }
+
+    virtual void update_account(const Account &a) override {
+        _ctx.object_updated(a);
+    }
+
+    virtual void update_instrument(const Instrument &i) override {
+        _ctx.object_updated(i);
+    }
+
+    virtual void batch_place(std::span<Order>) override {}
+    virtual void batch_cancel(std::span<Order>) override {}
+
+    virtual void create_accounts(std::vector<std::string>, Function<void(std::vector<Account>)> cb) override {
+        cb({});
+    }
+
+    virtual void create_instruments(std::vector<std::string> instruments, Account, Function<void(std::vector<Instrument>)> cb) override {
+        std::vector<Instrument> out;
+        {
+            std::lock_guard _(_mx);
+            for (auto &id: instruments) {
+                auto iter = _states.find(id);
+                if (iter == _states.end()) {
+                    Instrument i(std::make_shared<ShmInstrument>(id, _ctx.get_exchange()));
+                    iter = _states.emplace(id, std::make_unique<State>(i)).first;
+                    ++_generation;
+                }
+                out.push_back(iter->second->instrument);
+            }
+        }
+        cb(std::move(out));
+    }
+
+    virtual std::string get_name() const override {return "Shared memory feed";}
+    virtual std::string get_id() const override {return "shm_feed";}
+    virtual std::optional<IExchange::Icon> get_icon() const override {return {};}
+
+    virtual Order create_order(const Instrument &instrument, const Account &account, const Order::Setup &) override {
+        return Order(std::make_shared<ShmUnsupportedOrder>(instrument, account));
+    }
+    virtual Order create_order_replace(const Order &replace, const Order::Setup &, bool) override {
+        return Order(std::make_shared<ShmUnsupportedOrder>(replace.get_instrument(), replace.get_account()));
+    }
+    virtual void restore_orders(void *, std::span<SerializedOrder>) override {}
+    virtual void order_apply_report(const Order &, const Order::Report &) override {}
+    virtual void order_apply_fill(const Order &, const Fill &) override {}
+
+protected:
+
+    struct State {
+        Instrument instrument;
+        std::atomic<bool> ticker = false;
+        std::atomic<bool> orderbook = false;
+        ///accessed by worker only
+        OrderBook book = {};
+        ///accessed by worker only - book is not known (the reader started at
+        ///live position or updates were lost), wait for snapshot
+        bool stale = true;
+        State(Instrument i):instrument(std::move(i)) {}
+    };
+
+    ExchangeContext _ctx;
+    std::unique_ptr<ShmFeedReader> _reader;
+    std::thread _thr;
+    std::atomic<bool> _stop = false;
+    std::chrono::microseconds _idle_sleep = {};
+
+    std::mutex _mx;
+    std::map<std::string, std::unique_ptr<State>, std::less<> > _states;
+    std::vector<State *> _snapshot_requests;
+    ///incremented when instrument is added
+    std::atomic<unsigned int> _generation = 0;
+
+    ///worker's map of feed index to state (nullptr - instrument is not used)
+    std::vector<State *> _index;
+    unsigned int _index_generation = ~0U;
+    ///pending orderbook updates
+    State *_pending_state = nullptr;
+    std::vector<OrderBook::Update> _pending_updates;
+    bool _pending_snapshot = false;
+    ///lost records already handled
+    std::uint64_t _lost = 0;
+
+    State *resolve(std::uint32_t idx) {
+        auto gen = _generation.load(std::memory_order_relaxed);
+        if (gen != _index_generation) {
+            _index.clear();
+            _index_generation = gen;
+        }
+        if (idx >= _index.size()) {
+            std::lock_guard _(_mx);
+            while (_index.size() <= idx) {
+                auto id = _reader->get_instrument(static_cast<std::uint32_t>(_index.size()));
+                auto iter = _states.find(id);
+                _index.push_back(iter == _states.end()?nullptr:iter->second.get());
+            }
+        }
+        return _index[idx];
+    }
+
+    void flush_updates() {
+        if (!_pending_state) return;
+        if (_pending_state->orderbook.load(std::memory_order_relaxed)) {
+            _ctx.income_data(_pending_state->instrument, _pending_updates, _pending_snapshot);
+        }
+        _pending_state = nullptr;
+        _pending_updates.clear();
+        _pending_snapshot = false;
+    }
+
+    void send_snapshots() {
+        std::vector<State *> req;
+        {
+            std::lock_guard _(_mx);
+            std::swap(req, _snapshot_requests);
+        }
+        for (State *st: req) {
+            if (!st->book.empty()) _ctx.income_data(st->instrument, st->book);
+        }
+    }
+
+    ///clear all orderbooks after records were lost
+    void invalidate_books() {
+        std::vector<State *> states;
+        {
+            std::lock_guard _(_mx);
+            for (auto &[id, st]: _states) states.push_back(st.get());
+        }
+        for (State *st: states) {
+            st->book = OrderBook();
+            st->stale = true;
+            if (st->orderbook.load(std::memory_order_relaxed)) {
+                _ctx.income_data(st->instrument, std::span<const OrderBook::Update>(), true);
+            }
+        }
+    }
+
+    void process(const shm_feed::Record &rec) {
+        State *st = resolve(rec.instrument);
+        if (!st) return;
+        if (rec.kind == shm_feed::Kind::ticker) {
+            flush_updates();
+            if (st->ticker.load(std::memory_order_relaxed)) {
+                const double *f = rec.fields;
+                _ctx.income_data(st->instrument, Ticker{f[0], f[1], f[2], f[3], f[4], f[5], f[6]});
+            }
+            return;
+        }
+        //book is incomplete, wait for snapshot
+        if (st->stale && rec.kind != shm_feed::Kind::book_clear) return;
+        if (st != _pending_state) flush_updates();
+        _pending_state = st;
+        if (rec.kind == shm_feed::Kind::book_clear) {
+            st->book = OrderBook();
+            st->stale = false;
+            _pending_updates.clear();
+            _pending_snapshot = true;
+            return;
+        }
+        OrderBook::Update up{rec.kind == shm_feed::Kind::bid_update?Side::buy:Side::sell,
+                             rec.fields[0], rec.fields[1]};
+        st->book.update(up);
+        _pending_updates.push_back(up);
+    }
+
+    void worker() {
+        shm_feed::Record rec;
+        while (!_stop.load(std::memory_order_relaxed)) {
+            send_snapshots();
+            bool any = false;
+            //limit the batch, so snapshot requests are not starving
+            for (int n = 0; n < 4096 && _reader->read(rec); ++n) {
+                process(rec);
+                any = true;
+            }
+            flush_updates();
+            if (_reader->get_lost() != _lost) {
+                _lost = _reader->get_lost();
+                invalidate_books();
+            }
+            if (!any) {
+                if (_idle_sleep.count()) std::this_thread::sleep_for(_idle_sleep);
+                else std::this_thread::yield();
+            }
+        }
+    }
+};
+
+
+EXPORT_EXCHANGE(ShmFeedExchange);
@@ -0,0 +1,165 @@
+#include "shm_feed.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trading_api {
+
+namespace shm_feed {
+
+std::string feed_name(unsigned int feed_id) {
+    return "/trading_api_feed_" + std::to_string(feed_id);
+}
+
+static std::size_t map_size(std::uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Slot);
+}
+
+static Slot *get_slots(void *map) {
+    return reinterpret_cast<Slot *>(reinterpret_cast<char *>(map) + sizeof(Header));
+}
+
+}
+
+using namespace shm_feed;
+
+ShmFeedWriter::ShmFeedWriter(const std::string &name, std::size_t capacity) {
+    std::uint64_t cap = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+    _map_size = map_size(cap);
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC, 0644);
+    if (fd < 0) throw std::runtime_error("Unable to create shared memory: " + name);
+    if (::ftruncate(fd, static_cast<off_t>(_map_size)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("Unable to allocate shared memory: " + name);
+    }
+    _map = ::mmap(nullptr, _map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (_map == MAP_FAILED) {
+        _map = nullptr;
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("Unable to map shared memory: " + name);
+    }
+    //the object is zero filled, so all slots are empty (seq == 0)
+    _hdr = new(_map) Header{magic, 0, cap, {0}, {0}, {}};
+    _slots = get_slots(_map);
+    _mask = cap - 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    //version is written last, readers refuse the feed until it is initialized
+    std::atomic_ref(_hdr->version).store(shm_feed::version, std::memory_order_release);
+}
+
+ShmFeedWriter::~ShmFeedWriter() {
+    if (_map) ::munmap(_map, _map_size);
+}
+
+void ShmFeedWriter::remove(const std::string &name) {
+    ::shm_unlink(name.c_str());
+}
+
+std::uint32_t ShmFeedWriter::instrument_index(std::string_view id) {
+    auto cnt = _hdr->instrument_count.load(std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < cnt; ++i) {
+        if (id == _hdr->instruments[i]) return i;
+    }
+    if (cnt >= max_instruments) throw std::length_error("Too many instruments in shared memory feed");
+    if (id.size() >= max_instrument_id) throw std::length_error("Instrument identifier is too long");
+    std::memcpy(_hdr->instruments[cnt], id.data(), id.size());
+    _hdr->instruments[cnt][id.size()] = 0;
+    _hdr->instrument_count.store(cnt+1, std::memory_order_release);
+    return cnt;
+}
+
+void ShmFeedWriter::write(const Record &rec) {
+    Slot &slot = _slots[_pos & _mask];
+    slot.seq.store(2 * _pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.words[0].store(static_cast<std::uint64_t>(rec.time_ns), std::memory_order_relaxed);
+    slot.words[1].store(rec.instrument | (static_cast<std::uint64_t>(rec.kind) << 32), std::memory_order_relaxed);
+    for (unsigned int i = 0; i < field_count; ++i) {
+        slot.words[2+i].store(std::bit_cast<std::uint64_t>(rec.fields[i]), std::memory_order_relaxed);
+    }
+    slot.seq.store(2 * _pos + 2, std::memory_order_release);
+    ++_pos;
+    _hdr->write_pos.store(_pos, std::memory_order_release);
+}
+
+ShmFeedReader::ShmFeedReader(const std::string &name) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY|O_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error("Unable to open shared memory: " + name);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid shared memory feed: " + name);
+    }
+    _map_size = st.st_size;
+    _map = ::mmap(nullptr, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (_map == MAP_FAILED) {
+        _map = nullptr;
+        throw std::runtime_error("Unable to map shared memory: " + name);
+    }
+    _hdr = reinterpret_cast<const Header *>(_map);
+    auto ver = std::atomic_ref(const_cast<std::uint32_t &>(_hdr->version)).load(std::memory_order_acquire);
+    if (_hdr->magic != magic || ver != shm_feed::version
+            || std::popcount(_hdr->capacity) != 1
+            || map_size(_hdr->capacity) > _map_size) {
+        ::munmap(_map, _map_size);
+        _map = nullptr;
+        throw std::runtime_error("Invalid shared memory feed: " + name);
+    }
+    _slots = get_slots(_map);
+    _mask = _hdr->capacity - 1;
+    _pos = _hdr->write_pos.load(std::memory_order_acquire);
+}
+
+ShmFeedReader::~ShmFeedReader() {
+    if (_map) ::munmap(_map, _map_size);
+}
+
+bool ShmFeedReader::read(Record &rec) {
+    const Slot &slot = _slots[_pos & _mask];
+    std::uint64_t expected = 2 * _pos + 2;
+    std::uint64_t seq1 = slot.seq.load(std::memory_order_acquire);
+    //older generation or being written
+    if (seq1 < expected) return false;
+    std::uint64_t words[2+field_count];
+    if (seq1 == expected) {
+        for (unsigned int i = 0; i < 2+field_count; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == expected) {
+            rec.time_ns = static_cast<std::int64_t>(words[0]);
+            rec.instrument = static_cast<std::uint32_t>(words[1]);
+            rec.kind = static_cast<Kind>(words[1] >> 32);
+            for (unsigned int i = 0; i < field_count; ++i) {
+                rec.fields[i] = std::bit_cast<double>(words[2+i]);
+            }
+            ++_pos;
+            return true;
+        }
+    }
+    //writer has overwritten the slot, continue at live position
+    auto wp = _hdr->write_pos.load(std::memory_order_acquire);
+    _lost += wp - _pos;
+    _pos = wp;
+    return false;
+}
+
+std::string_view ShmFeedReader::get_instrument(std::uint32_t index) const {
+    if (index >= _hdr->instrument_count.load(std::memory_order_acquire)) return {};
+    const char *id = _hdr->instruments[index];
+    return std::string_view(id, ::strnlen(id, max_instrument_id));
+}
+
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace trading_api {
+
+///Market data feed in POSIX shared memory
+/**
+ * Single writer (feed handler) broadcasts records to any count of readers
+ * (strategy processes). The writer never waits for readers. A reader which
+ * is too slow is overrun, skips to the live position and counts lost records.
+ * Because lost orderbook updates can't be recovered, the writer periodically
+ * sends full orderbooks (book_clear followed by all levels)
+ *
+ * @code
+ * +--------+-------------------+------+------+ ... +------+
+ * | header | instrument table  | slot | slot |     | slot |
+ * +--------+-------------------+------+------+ ... +------+
+ * @endcode
+ *
+ * Every slot has a sequence number. While the writer writes the slot,
+ * the sequence is odd, then it is set to 2*(position+1). The reader
+ * accepts the slot only when the sequence matches the position it expects,
+ * and when the sequence didn't change while the slot was copied.
+ *
+ * This header doesn't depend on other parts of the library, so it
+ * can be used with single header API in modules
+ */
+namespace shm_feed {
+
+static constexpr std::uint32_t magic = 0x46484D53;   //"SMHF"
+static constexpr std::uint32_t version = 1;
+static constexpr unsigned int field_count = 7;
+static constexpr std::size_t max_instruments = 1024;
+static constexpr std::size_t max_instrument_id = 64;
+
+///kind of record, values are the same as TickStore::Kind
+enum class Kind: std::uint8_t {
+    ///ticker, fields are in order of declaration of Ticker
+    ticker = 0,
+    ///update of bid side, f0 = level, f1 = amount
+    bid_update = 1,
+    ///update of ask side, f0 = level, f1 = amount
+    ask_update = 2,
+    ///orderbook is cleared, following updates are snapshot
+    book_clear = 3
+};
+
+struct Record {
+    ///time in nanoseconds since epoch
+    std::int64_t time_ns = 0;
+    ///index of instrument in instrument table
+    std::uint32_t instrument = 0;
+    Kind kind = Kind::ticker;
+    double fields[field_count] = {};
+};
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    ///count of slots (power of two)
+    std::uint64_t capacity;
+    ///count of instruments in instrument table
+    std::atomic<std::uint32_t> instrument_count;
+    ///position of next record
+    alignas(64) std::atomic<std::uint64_t> write_pos;
+    ///instrument identifiers (zero terminated)
+    alignas(64) char instruments[max_instruments][max_instrument_id];
+};
+
+struct alignas(64) Slot {
+    std::atomic<std::uint64_t> seq;
+    ///time, instrument | kind << 32, fields
+    std::atomic<std::uint64_t> words[2+field_count];
+};
+
+///Compose name of shared memory object for given feed number
+std::string feed_name(unsigned int feed_id);
+
+}
+
+///Writes records to the shared memory feed
+class ShmFeedWriter {
+public:
+    ///Create shared memory feed
+    /**
+     * @param name name of shared memory object (starts with '/'). Existing feed is replaced
+     * @param capacity count of records in the ring, rounded up to power of two
+     * @exception std::runtime_error unable to create the feed
+     */
+    ShmFeedWriter(const std::string &name, std::size_t capacity);
+    ShmFeedWriter(const ShmFeedWriter &) = delete;
+    ShmFeedWriter &operator=(const ShmFeedWriter &) = delete;
+    ///unmaps the feed. The shared memory object is not removed (see remove())
+    ~ShmFeedWriter();
+
+    ///Register instrument
+    /**
+     * @param id instrument identifier
+     * @return index of instrument
+     * @exception std::length_error too many instruments or id too long
+     */
+    std::uint32_t instrument_index(std::string_view id);
+
+    ///Write record
+    void write(const shm_feed::Record &rec);
+
+    ///Remove shared memory object
+    static void remove(const std::string &name);
+
+protected:
+    void *_map = nullptr;
+    std::size_t _map_size = 0;
+    shm_feed::Header *_hdr = nullptr;
+    shm_feed::Slot *_slots = nullptr;
+    std::uint64_t _mask = 0;
+    std::uint64_t _pos = 0;
+};
+
+///Reads records from the shared memory feed
+class ShmFeedReader {
+public:
+    ///Open the feed
+    /**
+     * Reader starts at current write position (reads only new records)
+     *
+     * @param name name of shared memory object
+     * @exception std::runtime_error unable to open or invalid format
+     */
+    explicit ShmFeedReader(const std::string &name);
+    ShmFeedReader(const ShmFeedReader &) = delete;
+    ShmFeedReader &operator=(const ShmFeedReader &) = delete;
+    ~ShmFeedReader();
+
+    ///Read next record
+    /**
+     * @param rec receives record
+     * @retval true record read
+     * @retval false no new record
+     */
+    bool read(shm_feed::Record &rec);
+
+    ///Retrieve identifier of instrument
+    /**
+     * @param index index of instrument
+     * @return identifier, empty if not defined
+     */
+    std::string_view get_instrument(std::uint32_t index) const;
+
+    ///count of records lost because the reader was overrun
+    std::uint64_t get_lost() const {return _lost;}
+
+protected:
+    void *_map = nullptr;
+    std::size_t _map_size = 0;
+    const shm_feed::Header *_hdr = nullptr;
+    const shm_feed::Slot *_slots = nullptr;
+    std::uint64_t _mask = 0;
+    std::uint64_t _pos = 0;
+    std::uint64_t _lost = 0;
+};
+
+}
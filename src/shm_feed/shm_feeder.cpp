@@ -0,0 +1,115 @@
+#include "shm_feed.h"
+#include "../simulator/tick_store.h"
+
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace trading_api;
+
+///Write full orderbook, readers use it to recover after they were overrun
+static void write_snapshot(ShmFeedWriter &writer, std::uint32_t instrument, std::int64_t time_ns, OrderBook &book) {
+    shm_feed::Record rec;
+    rec.time_ns = time_ns;
+    rec.instrument = instrument;
+    rec.kind = shm_feed::Kind::book_clear;
+    writer.write(rec);
+    rec.kind = shm_feed::Kind::bid_update;
+    for (const auto &[price, amount]: book.bid()) {
+        rec.fields[0] = price;
+        rec.fields[1] = amount;
+        writer.write(rec);
+    }
+    rec.kind = shm_feed::Kind::ask_update;
+    for (const auto &[price, amount]: book.ask()) {
+        rec.fields[0] = price;
+        rec.fields[1] = amount;
+        writer.write(rec);
+    }
+}
+
+///Replays recorded market data (TickStore file) into shared memory feed
+/**
+ * Usage: shm_feeder <tick_store_file> [feed_id] [speed]
+ *
+ * speed - 1 replays in original pace, 2 twice faster, etc. 0 replays as fast
+ * as possible
+ *
+ * Full orderbooks are sent periodically, so readers which were overrun
+ * can recover
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <tick_store_file> [feed_id] [speed]" << std::endl;
+        return 1;
+    }
+    try {
+        unsigned int feed_id = argc > 2?static_cast<unsigned int>(std::stoul(argv[2])):0;
+        double speed = argc > 3?std::stod(argv[3]):1.0;
+
+        MappedTickStore store(argv[1]);
+        auto name = shm_feed::feed_name(feed_id);
+        constexpr std::size_t capacity = 1 << 16;
+        //snapshots are several times in the ring, so overrun reader finds one soon
+        constexpr std::size_t snapshot_step = capacity / 4;
+        ShmFeedWriter writer(name, capacity);
+
+        std::vector<std::uint32_t> index;
+        for (const auto &id: store.get_instruments()) {
+            index.push_back(writer.instrument_index(id));
+        }
+
+        //orderbooks of instruments (by index in store), nullopt - no orderbook data
+        std::vector<std::optional<OrderBook> > books(index.size());
+
+        std::cerr << "Feed " << name << ", records: " << store.size() << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        Timestamp first = store.size()?store.get_time(0):Timestamp();
+        constexpr std::size_t prefetch_step = 4096;
+
+        shm_feed::Record rec;
+        for (std::size_t i = 0, cnt = store.size(); i < cnt; ++i) {
+            if (i % prefetch_step == 0) store.prefetch(i + prefetch_step, prefetch_step);
+            Timestamp tp = store.get_time(i);
+            if (speed > 0) {
+                auto offset = std::chrono::duration<double>(tp - first) / speed;
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+            }
+            rec.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+            rec.instrument = index[store.get_instrument_index(i)];
+            switch (store.get_kind(i)) {
+                case TickStore::Kind::ticker: {
+                    Ticker tk = store.get_ticker(i);
+                    rec.kind = shm_feed::Kind::ticker;
+                    double f[] = {tk.bid, tk.bid_volume, tk.ask, tk.ask_volume, tk.last, tk.volume, tk.index};
+                    std::copy(std::begin(f), std::end(f), rec.fields);
+                } break;
+                default: {
+                    OrderBook::Update up = store.get_orderbook_update(i);
+                    auto &book = books[store.get_instrument_index(i)];
+                    if (!book) book.emplace();
+                    book->update(up);
+                    rec.kind = up.side == Side::buy?shm_feed::Kind::bid_update:shm_feed::Kind::ask_update;
+                    std::fill(std::begin(rec.fields), std::end(rec.fields), 0.0);
+                    rec.fields[0] = up.level;
+                    rec.fields[1] = up.amount;
+                } break;
+            }
+            writer.write(rec);
+            if ((i + 1) % snapshot_step == 0) {
+                for (std::size_t b = 0; b < books.size(); ++b) {
+                    if (books[b]) write_snapshot(writer, index[b], rec.time_ns, *books[b]);
+                }
+            }
+        }
+        std::cerr << "Done" << std::endl;
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,47 @@
+#include "sim_data_source.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace trading_api {
+
+TickStoreSource::TickStoreSource(std::shared_ptr<const MappedTickStore> store, std::vector<Instrument> instruments)
+    :_store(std::move(store))
+    ,_instruments(std::move(instruments)) {
+    _instruments.resize(_store->get_instruments().size());
+    load();
+}
+
+void TickStoreSource::next() {
+    ++_pos;
+    load();
+}
+
+void TickStoreSource::seek(std::uint64_t pos) {
+    _pos = std::min<std::size_t>(pos, _store->size());
+    _prefetched = _pos;
+    load();
+}
+
+void TickStoreSource::load() {
+    std::size_t sz = _store->size();
+    for (;_pos < sz; ++_pos) {
+        if (!_store->is_valid(_pos)) throw std::runtime_error("Corrupted tick store, record: " + std::to_string(_pos));
+        if (_instruments[_store->get_instrument_index(_pos)].defined()) break;
+    }
+    //advise next window when the reader crosses half of the current one
+    if (_pos + prefetch_window/2 >= _prefetched) {
+        _store->prefetch(_prefetched, prefetch_window);
+        _prefetched += prefetch_window;
+    }
+    if (_pos >= sz) return;
+    _rec.tp = _store->get_time(_pos);
+    _rec.i = _instruments[_store->get_instrument_index(_pos)];
+    if (_store->get_kind(_pos) == MappedTickStore::Kind::ticker) {
+        _rec.data = _store->get_ticker(_pos);
+    } else {
+        _rec.data = _store->get_orderbook_update(_pos);
+    }
+}
+
+}
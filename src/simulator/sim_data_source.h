@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../trading_ifc/instrument.h"
+#include "../trading_ifc/orderbook.h"
+#include "../trading_ifc/function.h"
+#include "tick_store.h"
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+namespace trading_api {
+
+///Market data record replayed by the simulator
+struct SimRecord {
+    Timestamp tp;
+    Instrument i;
+    std::variant<Ticker, OrderBook::Update> data;
+};
+
+///Sorted stream of market data records
+/**
+ * The simulator merges multiple sources and pulls records from them as
+ * the simulation time advances. Records of a single source must be
+ * ordered by time
+ */
+class ISimDataSource {
+public:
+    virtual ~ISimDataSource() = default;
+
+    ///Retrieve current record
+    /**
+     * @return pointer to current record, or nullptr if the stream is exhausted.
+     * The pointer is valid until next() is called
+     */
+    virtual const SimRecord *current() const = 0;
+
+    ///Advance to next record
+    virtual void next() = 0;
+
+    ///Retrieve position of the current record
+    /**
+     * @return opaque position which can be passed to seek(). Returns no
+     * value if the source can't seek (default)
+     */
+    virtual std::optional<std::uint64_t> tell() const {return {};}
+
+    ///Move to position returned by tell()
+    /**
+     * @param pos position
+     * @exception std::logic_error source can't seek (default)
+     */
+    virtual void seek(std::uint64_t pos) {
+        throw std::logic_error("Data source doesn't support seek: " + std::to_string(pos));
+    }
+};
+
+///Source which pulls records from a generator function
+class GeneratorSource: public ISimDataSource {
+public:
+
+    ///Generator function - fills the record and returns true, or returns false at the end of stream
+    using Generator = Function<bool(SimRecord &)>;
+
+    GeneratorSource(Generator gen):_gen(std::move(gen)) {
+        next();
+    }
+
+    virtual const SimRecord *current() const override {
+        return _valid?&_rec:nullptr;
+    }
+    virtual void next() override {
+        _valid = _gen(_rec);
+    }
+
+protected:
+    Generator _gen;
+    SimRecord _rec;
+    bool _valid = false;
+};
+
+///Source which reads records from memory mapped tick store
+/**
+ * The source reads records directly from the mapping and advises the
+ * kernel to read ahead a window of records, so only the window is
+ * resident in memory. Every record is validated before it is used, the
+ * source throws std::runtime_error when it reaches a corrupted record
+ */
+class TickStoreSource: public ISimDataSource {
+public:
+
+    ///count of records advised to be read ahead from the tick store
+    static constexpr std::size_t prefetch_window = 65536;
+
+    ///Construct the source
+    /**
+     * @param store mapped tick store
+     * @param instruments instrument objects for every instrument identifier of
+     * the store (MappedTickStore::get_instruments()). Records of instruments which
+     * are not defined in this list are skipped. This also allows to create
+     * separate stream per instrument from single file.
+     */
+    TickStoreSource(std::shared_ptr<const MappedTickStore> store, std::vector<Instrument> instruments);
+
+    virtual const SimRecord *current() const override {
+        return _pos < _store->size()?&_rec:nullptr;
+    }
+    virtual void next() override;
+    virtual std::optional<std::uint64_t> tell() const override {return _pos;}
+    virtual void seek(std::uint64_t pos) override;
+
+protected:
+    std::shared_ptr<const MappedTickStore> _store;
+    std::vector<Instrument> _instruments;
+    std::size_t _pos = 0;
+    std::size_t _prefetched = 0;
+    SimRecord _rec;
+
+    void load();
+};
+
+}
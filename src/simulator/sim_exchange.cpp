@@ -39,16 +39,30 @@ std::optional<IExchange::Icon> SimExchange::get_icon() const {
     return {};
 }
 
-void SimExchange::subscribe(SubscriptionType , const Instrument &) {
-    //empty
+void SimExchange::subscribe(SubscriptionType type, const Instrument &i) {
+    std::lock_guard _(_mx);
+    InstrumentState &st = _states[i];
+    switch (type) {
+        case SubscriptionType::ticker: st.ticker_subscribed = true;break;
+        case SubscriptionType::orderbook: st.orderbook_subscribed = true;break;
+    }
+    //records could be skipped, so send current state to the new subscriber
+    _pending.push_back({i, type});
+    reschedule();
 }
 
 void SimExchange::update_instrument(const Instrument &i) {
     ctx.object_updated(i);
 }
 
-void SimExchange::unsubscribe(SubscriptionType , const Instrument &i) {
-    //empty
+void SimExchange::unsubscribe(SubscriptionType type, const Instrument &i) {
+    std::lock_guard _(_mx);
+    InstrumentState *st = _states.find(i);
+    if (!st) return;
+    switch (type) {
+        case SubscriptionType::ticker: st->ticker_subscribed = false;break;
+        case SubscriptionType::orderbook: st->orderbook_subscribed = false;break;
+    }
 }
 
 void SimExchange::order_apply_report(const Order &order,
@@ -92,11 +106,22 @@ std::string SimExchange::get_name() const {
 
 SimExchange::SimExchange(GlobalScheduler scheduler, Config config)
 :_scheduler(std::move(scheduler))
+,_next_event(std::move(config.next_event))
+,_simul_accounts(std::move(config.simul_accounts))
 {
+    _sources.push_back(std::make_unique<QueueSource>());
+    _processed.push_back(0);
     std::transform(config.accounts.begin(), config.accounts.end(),
             std::inserter(_accounts, _accounts.end()), [&](const Account &a){
         return std::pair(a.get_id(), a);
     });
+    for (const auto &a: _simul_accounts) {
+        _accounts.emplace(a->get_id(), Account(a));
+        a->set_instrument_resolver([this](std::string_view id) {
+            auto iter = _instruments.find(std::string(id));
+            return iter == _instruments.end()?Instrument():iter->second;
+        });
+    }
     std::transform(config.instruments.begin(), config.instruments.end(),
             std::inserter(_instruments, _instruments.end()), [&](const Instrument &a){
         return std::pair(a.get_id(), a);
@@ -105,36 +130,212 @@ SimExchange::SimExchange(GlobalScheduler scheduler, Config config)
 
 void SimExchange::on_timer(Timestamp tp) {
     std::lock_guard _(_mx);
-    if (_price_data.empty()) return;
-    if (_price_data.front().tp <= tp) {
-        auto v = std::move(_price_data.front());
-        _price_data.pop();
-        if (std::holds_alternative<Ticker>(v.data)) {
-            const auto &tk = std::get<Ticker>(v.data);
-            ctx.income_data(v.i, tk);
-        } else if (std::holds_alternative<Ticker>(v.data)) {
-            const auto &up = std::get<OrderBook::Update>(v.data);
-            OrderBook &ob = _orderbooks[v.i];
-            ob.update(up);
-            ctx.income_data(v.i, ob);
-        }
+    _cur_time = std::max(_cur_time, tp);
+    send_pending();
+    auto next = get_next_time();
+    while (next.has_value() && *next <= tp) {
+        dispatch_next();
+        next = get_next_time();
     }
+    fast_forward();
     reschedule();
 }
 
+void SimExchange::fast_forward() {
+    if (!_next_event) return;
+    auto horizon = _next_event();
+    Timestamp limit = horizon.has_value()?*horizon:Timestamp::max();
+    auto next = get_next_time();
+    while (next.has_value() && *next < limit) {
+        if (is_interesting(*_sources[_merge.winner()]->current())) break;
+        dispatch_next();
+        next = get_next_time();
+    }
+}
+
+bool SimExchange::is_interesting(const SimRecord &rec) const {
+    const InstrumentState *st = _states.find(rec.i);
+    if (!st) return false;
+    return std::holds_alternative<Ticker>(rec.data)?st->ticker_subscribed
+                                                   :st->orderbook_subscribed;
+}
+
+void SimExchange::send_pending() {
+    auto pending = std::move(_pending);
+    _pending.clear();
+    for (const auto &[i, type]: pending) {
+        const InstrumentState &st = _states[i];
+        switch (type) {
+            case SubscriptionType::ticker:
+                if (st.ticker_subscribed && st.ticker.has_value()) ctx.income_data(i, *st.ticker);
+                break;
+            case SubscriptionType::orderbook:
+                if (st.orderbook_subscribed && st.has_orderbook) ctx.income_data(i, st.orderbook);
+                break;
+        }
+    }
+}
+
+Timestamp SimExchange::get_source_time(const ISimDataSource &src) {
+    const SimRecord *rec = src.current();
+    return rec?rec->tp:Timestamp::max();
+}
+
+std::optional<Timestamp> SimExchange::get_next_time() {
+    if (_merge_dirty) {
+        std::vector<Timestamp> keys;
+        keys.reserve(_sources.size());
+        for (const auto &src: _sources) keys.push_back(get_source_time(*src));
+        _merge.build(std::move(keys));
+        _merge_dirty = false;
+    }
+    const SimRecord *rec = _sources[_merge.winner()]->current();
+    if (rec == nullptr) return {};
+    return rec->tp;
+}
+
+void SimExchange::dispatch_next() {
+    auto w = _merge.winner();
+    ISimDataSource &src = *_sources[w];
+    //advance the source before dispatching, the callback can add records
+    //which changes the queue and the tree
+    SimRecord rec = *src.current();
+    ++_processed[w];
+    src.next();
+    _merge.replace_top(get_source_time(src));
+    std::visit([&](const auto &data){dispatch(rec.i, data);}, rec.data);
+}
+
+void SimExchange::dispatch(const Instrument &i, const Ticker &tk) {
+    InstrumentState &st = _states[i];
+    st.ticker = tk;
+    for (const auto &a: _simul_accounts) a->update_price(i, tk.last);
+    if (st.ticker_subscribed) ctx.income_data(i, tk);
+}
+
+void SimExchange::dispatch(const Instrument &i, const OrderBook::Update &up) {
+    InstrumentState &st = _states[i];
+    st.orderbook.update(up);
+    st.has_orderbook = true;
+    if (st.orderbook_subscribed) ctx.income_data(i, std::span(&up, 1));
+}
+
 void SimExchange::reschedule() {
-    if (_price_data.empty()) return;
-    _scheduler(_price_data.front().tp, [this](Timestamp st){on_timer(st);}, this);
+    auto next = get_next_time();
+    if (!_pending.empty()) next = _cur_time;
+    if (!next.has_value()) return;
+    _scheduler(*next, [this](Timestamp st){on_timer(st);}, this);
 }
 
 void SimExchange::add_record(const Timestamp &tp, const Instrument &i, const OrderBook::Update &ordb) {
     std::lock_guard _(_mx);
-    _price_data.push({tp, i, ordb});
-    reschedule();
+    push_record({tp, i, ordb});
 }
 
 void SimExchange::add_record(const Timestamp &tp, const Instrument &i, const Ticker &tk) {
-    _price_data.push({tp, i, tk});
+    std::lock_guard _(_mx);
+    push_record({tp, i, tk});
+}
+
+void SimExchange::push_record(SimRecord rec) {
+    //the tree must be rebuilt only if the queue got new head
+    if (!_merge_dirty && rec.tp < _merge.get_key(0)) _merge_dirty = true;
+    static_cast<QueueSource &>(*_sources.front()).push(std::move(rec));
+    reschedule();
+}
+
+void SimExchange::add_records(std::shared_ptr<const MappedTickStore> store) {
+    std::vector<Instrument> instruments;
+    for (const auto &id: store->get_instruments()) {
+        auto iter = _instruments.find(id);
+        instruments.push_back(iter == _instruments.end()?Instrument():iter->second);
+    }
+    add_source(std::make_unique<TickStoreSource>(std::move(store), std::move(instruments)));
+}
+
+void SimExchange::add_source(std::unique_ptr<ISimDataSource> source) {
+    std::lock_guard _(_mx);
+    _sources.push_back(std::move(source));
+    _processed.push_back(0);
+    _merge_dirty = true;
+    reschedule();
+}
+
+void SimExchange::save_state(BinaryWriter &wr) const {
+    std::lock_guard _(_mx);
+    wr.write(_cur_time);
+    wr.write_size(_processed.size());
+    for (std::size_t i = 0; i < _processed.size(); ++i) {
+        wr.write(_processed[i]);
+        auto pos = _sources[i]->tell();
+        wr.write(pos.has_value());
+        if (pos.has_value()) wr.write(*pos);
+    }
+    wr.write_size(_states.size());
+    _states.for_each([&](const Instrument &i, const InstrumentState &st) {
+        wr.write(i.get_id());
+        wr.write(st.ticker.has_value());
+        if (st.ticker.has_value()) wr.write(*st.ticker);
+        wr.write(st.has_orderbook);
+        if (st.has_orderbook) {
+            OrderBook ob = st.orderbook;
+            auto write_side = [&](auto &side) {
+                std::size_t levels = 0;
+                for (auto iter = side.begin(); iter != side.end(); ++iter) ++levels;
+                wr.write_size(levels);
+                for (const auto &[price, amount]: side) {
+                    wr.write(price);
+                    wr.write(amount);
+                }
+            };
+            write_side(ob.bid());
+            write_side(ob.ask());
+        }
+    });
+}
+
+void SimExchange::load_state(BinaryReader &rd) {
+    std::lock_guard _(_mx);
+    _cur_time = rd.read_timestamp();
+    std::size_t cnt = rd.read_size();
+    if (cnt != _sources.size()) throw std::runtime_error("SimExchange: count of data sources doesn't match the checkpoint");
+    for (std::size_t i = 0; i < cnt; ++i) {
+        std::uint64_t processed = rd.read<std::uint64_t>();
+        ISimDataSource &src = *_sources[i];
+        if (rd.read<bool>()) {
+            src.seek(rd.read<std::uint64_t>());
+            _processed[i] = processed;
+        } else {
+            for (_processed[i] = 0; _processed[i] < processed && src.current(); ++_processed[i]) src.next();
+        }
+    }
+    _merge_dirty = true;
+    //subscribers received the state before the checkpoint
+    _pending.clear();
+    _states.for_each([&](const Instrument &, InstrumentState &st) {
+        st.ticker.reset();
+        st.orderbook = OrderBook();
+        st.has_orderbook = false;
+    });
+    cnt = rd.read_size();
+    for (std::size_t n = 0; n < cnt; ++n) {
+        std::string id = rd.read_string();
+        auto iter = _instruments.find(id);
+        if (iter == _instruments.end()) throw std::runtime_error("SimExchange: unknown instrument in the checkpoint: " + id);
+        InstrumentState &st = _states[iter->second];
+        if (rd.read<bool>()) st.ticker = rd.read<Ticker>();
+        st.has_orderbook = rd.read<bool>();
+        if (st.has_orderbook) {
+            for (std::size_t k = 0, levels = rd.read_size(); k < levels; ++k) {
+                double price = rd.read<double>();
+                st.orderbook.update_bid(price, rd.read<double>());
+            }
+            for (std::size_t k = 0, levels = rd.read_size(); k < levels; ++k) {
+                double price = rd.read<double>();
+                st.orderbook.update_ask(price, rd.read<double>());
+            }
+        }
+    }
     reschedule();
 }
 
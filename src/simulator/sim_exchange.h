@@ -4,16 +4,45 @@
 #include "../trading_ifc/ticker.h"
 #include "../trading_ifc/orderbook.h"
 #include "../common/priority_queue.h"
-
+#include "../common/loser_tree.h"
+#include "../common/checkpoint.h"
+#include "../common/dense_map.h"
+#include "sim_data_source.h"
+#include "simulator_account.h"
+
+#include <functional>
+#include <optional>
 #include <vector>
 namespace trading_api {
 
-class SimExchange: public IExchangeService {
+class SimExchange: public IExchangeService, public ICheckpointable {
 public:
 
     struct Config {
         std::vector<Account> accounts;
         std::vector<Instrument> instruments;
+        ///Returns time of next event of the global scheduler
+        /**
+         * When set, fast-forward mode is enabled. Records which nobody is
+         * interested in are applied to the last state of the instrument
+         * without dispatching, and the exchange continues to the next record
+         * without going through the scheduler, until it reaches time of the
+         * next event or a record which must be dispatched. The scheduler
+         * then jumps directly to that record.
+         *
+         * For ManualContextScheduler use its get_next_event()
+         *
+         * @note all interaction with the simulation must go through the scheduler
+         */
+        std::function<std::optional<Timestamp>()> next_event;
+        ///Simulated accounts
+        /**
+         * The accounts are available to the strategy as other accounts. Every
+         * ticker of the replayed data updates price of the instrument
+         * in these accounts. Instrument resolver of the accounts is
+         * set to resolve the instruments of this exchange
+         */
+        std::vector<std::shared_ptr<SimulAccount> > simul_accounts = {};
     };
 
     using GlobalScheduler = std::function<void(Timestamp,std::function<void(Timestamp)>, const void *)>;
@@ -51,30 +80,103 @@ public:
     void add_record(const Timestamp &tp, const Instrument &i, const Ticker &tk);
     void add_record(const Timestamp &tp, const Instrument &i, const OrderBook::Update &ordb);
 
+    ///Add records from memory mapped tick store
+    /**
+     * Records are not copied, they are read directly from the mapping as the
+     * simulation advances. Instrument identifiers stored in the file are resolved
+     * against instruments from configuration. Records of unknown instruments are
+     * skipped
+     *
+     * @param store mapped tick store
+     */
+    void add_records(std::shared_ptr<const MappedTickStore> store);
+
+    ///Add streaming data source
+    /**
+     * Sources are merged by time. Records are pulled from the source only
+     * when the simulation reaches their time, so the source can generate or
+     * read data lazily
+     *
+     * @param source data source
+     */
+    void add_source(std::unique_ptr<ISimDataSource> source);
+
+    ///Store last state of instruments and position in data sources
+    virtual void save_state(BinaryWriter &wr) const override;
+    ///Restore state
+    /**
+     * All sources must be added in the same order as in saved simulation.
+     * Sources which support seek() are moved directly to the saved position,
+     * records of other sources which were already processed are skipped.
+     * Subscribers are not sent the current state again.
+     */
+    virtual void load_state(BinaryReader &rd) override;
+
 protected:
 
-    struct Record {
-        Timestamp tp;
-        Instrument i;
-        std::variant<Ticker, OrderBook::Update> data;
+    ///Source of records inserted by add_record()
+    class QueueSource: public ISimDataSource {
+    public:
+        virtual const SimRecord *current() const override {
+            return _queue.empty()?nullptr:&_queue.front();
+        }
+        virtual void next() override {
+            _queue.pop();
+        }
+        void push(SimRecord rec) {
+            _queue.push(std::move(rec));
+        }
+    protected:
         struct ordering {
-            bool operator()(const Record &a, const Record &b) const {
+            bool operator()(const SimRecord &a, const SimRecord &b) const {
                 return a.tp > b.tp;
             }
         };
+        PriorityQueue<SimRecord, ordering> _queue;
     };
 
 
-    std::mutex _mx;
+    ///Last known state of an instrument
+    struct InstrumentState {
+        std::optional<Ticker> ticker;
+        OrderBook orderbook;
+        bool has_orderbook = false;
+        bool ticker_subscribed = false;
+        bool orderbook_subscribed = false;
+    };
+
+    mutable std::recursive_mutex _mx;
     ExchangeContext ctx;
     GlobalScheduler _scheduler;
+    std::function<std::optional<Timestamp>()> _next_event;
     std::unordered_map<std::string, Account> _accounts;
+    std::vector<std::shared_ptr<SimulAccount> > _simul_accounts;
     std::unordered_map<std::string, Instrument> _instruments;
-    std::map<Instrument, OrderBook> _orderbooks;
-    PriorityQueue<Record, Record::ordering> _price_data;
+    DenseMap<Instrument, InstrumentState> _states;
+    ///states to be sent to new subscribers
+    std::vector<std::pair<Instrument, SubscriptionType> > _pending;
+    ///time of last processed timer
+    Timestamp _cur_time = Timestamp::min();
+    ///all sources, the first source is always QueueSource
+    std::vector<std::unique_ptr<ISimDataSource> > _sources;
+    ///count of records processed from every source
+    std::vector<std::uint64_t> _processed;
+    ///merges sources by time of their current record
+    LoserTree<Timestamp> _merge;
+    ///set when key of any source other than winner changed
+    bool _merge_dirty = true;
 
     void on_timer(Timestamp tp);
     void reschedule();
+    std::optional<Timestamp> get_next_time();
+    static Timestamp get_source_time(const ISimDataSource &src);
+    void dispatch_next();
+    void fast_forward();
+    void send_pending();
+    bool is_interesting(const SimRecord &rec) const;
+    void push_record(SimRecord rec);
+    void dispatch(const Instrument &i, const Ticker &tk);
+    void dispatch(const Instrument &i, const OrderBook::Update &up);
 
 };
 
@@ -1,12 +1,14 @@
 #include "simulator_account.h"
 
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include "../common/acb.h"
 
 namespace trading_api {
 
-SimulAccount::SimulAccount(std::string label, std::string currency, double equity, double leverage)
-        :_label(label), _currency(currency), _equity(equity), _leverage(leverage)
+SimulAccount::SimulAccount(std::string label, std::string currency, double equity, double leverage, Exchange exchange)
+        :_label(label), _currency(currency), _exchange(std::move(exchange)), _equity(equity), _leverage(leverage)
 {
 
 }
@@ -18,7 +20,7 @@ double SimulAccount::record_fill(const Instrument &instrument, Side side, double
     const auto &icfg = instrument.get_config();
 
     //check
-    InstrumentInfo &ii = _positions[instrument.get_handle().get()];
+    InstrumentInfo &ii = get_instrument_info(instrument);
 
     double blk = calc_blocked();
     double lev = _leverage?_leverage:1.0;
@@ -58,12 +60,12 @@ double SimulAccount::record_fill(const Instrument &instrument, Side side, double
                 iter->amount -= amount;
                 realize_position(icfg, p, price);
                 filled += p.amount;
-                update_overall(ii);
+                update_state(ii);
                 return filled;
             }
         }
         if (behaviour == Order::Behavior::reduce) {
-            update_overall(ii);
+            update_state(ii);
             return filled;
         }
     }
@@ -71,6 +73,7 @@ double SimulAccount::record_fill(const Instrument &instrument, Side side, double
         double blk = calc_blocked();
         blk += Instrument::calc_margin(icfg, price, amount, lev);
         if (blk > _equity) {
+            update_state(ii);
             return amount;
         }
         ii.list.push_back({
@@ -81,6 +84,7 @@ double SimulAccount::record_fill(const Instrument &instrument, Side side, double
         });
         filled += amount;
     }
+    update_state(ii);
     return filled;
 
 }
@@ -101,23 +105,125 @@ SimulAccount::OverallPosition SimulAccount::get_position(const Instrument &instr
 }
 
 double SimulAccount::calc_blocked() const {
+    return _margin + _pnl;
+}
+
+double SimulAccount::calc_blocked_full() const {
     double blocked = 0;
-    double maintenace_leverage = _leverage?_leverage/2.0:1;
+    double lev = maintenance_leverage();
     for (auto &[k, v]: _positions) {
-        auto instrument = v.instrument.lock();
-        auto siminstr = dynamic_cast<const SimulInstrument *>(instrument.get());
-        if (siminstr == nullptr) continue;
+        InstrumentInfo tmp = v;
+        tmp.overall = calc_overall(v);
+        blocked += calc_pnl(tmp);
+        blocked += calc_margin(tmp, lev);
+    }
+    return blocked;
+}
+
+void SimulAccount::update_price(const Instrument &instrument, double price) {
+    std::lock_guard _(_mx);
+    auto iter = _positions.find(instrument.get_handle().get());
+    if (iter == _positions.end()) return;
+    iter->second.last_price = price;
+    update_pnl(iter->second);
+}
+
+void SimulAccount::set_consistency_check(bool enable) {
+    std::lock_guard _(_mx);
+    _consistency_check = enable;
+    if (enable) check_consistency();
+}
 
-        double last_price = siminstr->get_last_price();
-        if (last_price <= 0) last_price = v.overall.open_price;
+void SimulAccount::set_instrument_resolver(InstrumentResolver resolver) {
+    std::lock_guard _(_mx);
+    _resolver = std::move(resolver);
+}
 
-        const auto &cfg = instrument->get_config();
-        blocked += v.overall.locked_in_pnl;
-        blocked += Instrument::calculate_pnl(cfg, v.overall, last_price);
-        blocked += Instrument::calc_margin(cfg, v.overall.amount,  v.overall.open_price , maintenace_leverage);
+void SimulAccount::save_state(BinaryWriter &wr) const {
+    std::lock_guard _(_mx);
+    wr.write(_equity);
+    wr.write(_fees);
+    wr.write(_position_counter);
+    wr.write_size(_positions.size());
+    for (const auto &[k, v]: _positions) {
+        wr.write(k->get_id());
+        wr.write(v.last_price);
+        wr.write_size(v.list.size());
+        for (const Position &pos: v.list) wr.write(pos);
+    }
+}
 
+void SimulAccount::load_state(BinaryReader &rd) {
+    std::lock_guard _(_mx);
+    if (!_resolver) throw std::logic_error("SimulAccount: instrument resolver is not set");
+    _equity = rd.read<double>();
+    _fees = rd.read<double>();
+    _position_counter = rd.read<PositionID>();
+    _positions.clear();
+    _margin = 0;
+    _pnl = 0;
+    for (std::size_t i = 0, cnt = rd.read_size(); i < cnt; ++i) {
+        std::string id = rd.read_string();
+        Instrument instrument = _resolver(id);
+        if (!instrument.defined()) throw std::runtime_error("SimulAccount: unknown instrument in the checkpoint: " + id);
+        InstrumentInfo &ii = get_instrument_info(instrument);
+        ii.last_price = rd.read<double>();
+        std::size_t npos = rd.read_size();
+        ii.list.reserve(npos);
+        for (std::size_t j = 0; j < npos; ++j) ii.list.push_back(rd.read<Position>());
+        update_state(ii);
+    }
+}
+
+SimulAccount::InstrumentInfo &SimulAccount::get_instrument_info(const Instrument &instrument) {
+    auto iter = _positions.find(instrument.get_handle().get());
+    if (iter != _positions.end()) return iter->second;
+    InstrumentInfo &ii = _positions[instrument.get_handle().get()];
+    ii.cfg = instrument.get_config();
+    return ii;
+}
+
+double SimulAccount::maintenance_leverage() const {
+    return _leverage?_leverage/2.0:1;
+}
+
+double SimulAccount::calc_pnl(const InstrumentInfo &ii) {
+    //flat position has no open price (inverted contract divides by the price)
+    if (ii.overall.amount == 0) return ii.overall.locked_in_pnl;
+    double last_price = ii.last_price;
+    if (last_price <= 0) last_price = ii.overall.open_price;
+    return ii.overall.locked_in_pnl + Instrument::calculate_pnl(ii.cfg, ii.overall, last_price);
+}
+
+double SimulAccount::calc_margin(const InstrumentInfo &ii, double leverage) {
+    if (ii.overall.amount == 0) return 0;
+    return Instrument::calc_margin(ii.cfg, ii.overall.open_price, ii.overall.amount, leverage);
+}
+
+void SimulAccount::update_state(InstrumentInfo &ii) {
+    update_overall(ii);
+    double m = calc_margin(ii, maintenance_leverage());
+    _margin += m - ii.margin;
+    ii.margin = m;
+    update_pnl(ii);
+}
+
+void SimulAccount::update_pnl(InstrumentInfo &ii) {
+    double p = calc_pnl(ii);
+    _pnl += p - ii.pnl;
+    ii.pnl = p;
+    if (_consistency_check) check_consistency();
+}
+
+void SimulAccount::check_consistency() const {
+    double full = calc_blocked_full();
+    double incr = calc_blocked();
+    double tolerance = std::max(std::abs(full), 1.0) * 1e-9;
+    if (std::abs(full - incr) > tolerance) {
+        throw std::logic_error("SimulAccount: incremental blocked amount "
+                + std::to_string(incr) + " doesn't match recalculated value "
+                + std::to_string(full));
     }
-    return blocked;
 }
 
 void SimulAccount::update_overall(InstrumentInfo &ii)  {
@@ -136,7 +242,7 @@ SimulAccount::OverallPosition SimulAccount::calc_overall(const InstrumentInfo &i
     double a = acb.getPos();
     out.amount = std::abs(a);
     out.locked_in_pnl = acb.getRPnL();
-    out.open_price = acb.getOpen();
+    out.open_price = a?acb.getOpen():0;
     out.side = a < 0?Side::sell:a>0?Side::buy:Side::undefined;
     return out;
 
@@ -168,7 +274,7 @@ SimulAccount::HedgePosition SimulAccount::get_hedge_position(const Instrument &i
     return hg;
 }
 
-SimulAccount::Position SimulAccount::get_position_by_id(const Instrument &instrument, PositionID id) const {
+Position SimulAccount::get_position_by_id(const Instrument &instrument, PositionID id) const {
     switch (id) {
         case overall_position:return get_position(instrument);
         case buy_position: return get_hedge_position(instrument).buy;
@@ -192,7 +298,16 @@ std::string SimulAccount::get_label() const {
     return _label;
 }
 
+Exchange SimulAccount::get_exchange() const {
+    return _exchange;
+}
+
+std::string SimulAccount::get_id() const {
+    return _label;
+}
+
 SimulAccount::Info SimulAccount::get_info() const {
+    std::lock_guard _(_mx);
     double blocked = calc_blocked();
     double balance = _equity * _leverage - blocked;
     return {
@@ -214,7 +329,7 @@ void SimulAccount::realize_position(const Instrument::Config &icfg, const Positi
 
 bool SimulAccount::close_position(const Instrument &instrument, PositionID id, double price) {
     std::lock_guard _(_mx);
-    InstrumentInfo &ii = _positions[instrument.get_handle().get()];
+    InstrumentInfo &ii = get_instrument_info(instrument);
     if (ii.list.empty()) return false;
     if (id < 0) {
         const auto &icfg = instrument.get_config();
@@ -225,7 +340,7 @@ bool SimulAccount::close_position(const Instrument &instrument, PositionID id, d
                     realize_position(icfg, pos, price);
                 }
                 ii.list.clear();
-                update_overall(ii);
+                update_state(ii);
                 return true;
             case buy_position: close_side = Side::buy;break;
             case sell_position: close_side = Side::sell;break;
@@ -238,7 +353,7 @@ bool SimulAccount::close_position(const Instrument &instrument, PositionID id, d
             ok = true;
             return true;
         }), ii.list.end());
-        update_overall(ii);
+        update_state(ii);
         return ok;
     } else {
         auto iter = std::find_if(ii.list.begin(), ii.list.end(), [&](const Position &pos){
@@ -248,7 +363,7 @@ bool SimulAccount::close_position(const Instrument &instrument, PositionID id, d
             const auto &icfg = instrument.get_config();
             realize_position(icfg, *iter, price);
             ii.list.erase(iter);
-            update_overall(ii);
+            update_state(ii);
             return true;
         } else {
             return false;
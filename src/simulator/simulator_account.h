@@ -2,15 +2,14 @@
 
 #include <mutex>
 #include "../trading_ifc/strategy_context.h"
-
-#include "simulator_instrument.h"
+#include "../common/checkpoint.h"
 
 namespace trading_api {
 
-class SimulAccount: public IAccount {
+class SimulAccount: public IAccount, public ICheckpointable {
 public:
 
-    SimulAccount(std::string label, std::string currency, double equity, double leverage);
+    SimulAccount(std::string label, std::string currency, double equity, double leverage, Exchange exchange = {});
     //frontent
     virtual PositionList get_all_positions(const Instrument &instrument) const override;
     virtual OverallPosition get_position(const Instrument &instrument) const override;
@@ -18,14 +17,57 @@ public:
     virtual std::string get_label() const override;
     virtual HedgePosition get_hedge_position(const Instrument &instrument) const override;
     virtual Info get_info() const override;
+    virtual Exchange get_exchange() const override;
+    virtual std::string get_id() const override;
 
     //backend
 
     double record_fill(const Instrument &instrument, Side side, double price, double amount, Order::Behavior behaviour);
     bool close_position(const Instrument &instrument, PositionID pos, double price);
 
+    ///Update last price of an instrument
+    /**
+     * Recalculates unrealized pnl of the position on given instrument. Other
+     * instruments are not touched
+     * @param instrument instrument
+     * @param price last price
+     */
+    void update_price(const Instrument &instrument, double price);
+
+    ///Retrieve blocked amount (margin and unrealized pnl)
+    /**
+     * @return value maintained incrementally, complexity O(1)
+     */
     double calc_blocked() const;
 
+    ///Recalculate blocked amount from all positions
+    /**
+     * @return blocked amount calculated from scratch, complexity O(instruments)
+     */
+    double calc_blocked_full() const;
+
+    ///Enable consistency check
+    /**
+     * When enabled, every incremental update is compared with full recalculation
+     * and std::logic_error is thrown on mismatch. Intended for testing
+     * @param enable true to enable
+     */
+    void set_consistency_check(bool enable);
+
+    ///Function which returns instrument for given instrument id
+    using InstrumentResolver = Function<Instrument(std::string_view)>;
+
+    ///Set function used to resolve instruments while state is loaded
+    void set_instrument_resolver(InstrumentResolver resolver);
+
+    ///Store equity and all positions
+    virtual void save_state(BinaryWriter &wr) const override;
+    ///Restore equity and positions
+    /**
+     * @note requires instrument resolver
+     */
+    virtual void load_state(BinaryReader &rd) override;
+
     static constexpr PositionID overall_position = -1;
     static constexpr PositionID buy_position = -2;
     static constexpr PositionID sell_position = -3;
@@ -33,25 +75,47 @@ public:
 protected:
 
     struct InstrumentInfo {
-        std::weak_ptr<IInstrument> instrument;
+        Instrument::Config cfg;
         PositionList list;
         OverallPosition overall;
+        ///last known price (zero if unknown)
+        double last_price = 0;
+        ///margin of overall position (contribution to _margin)
+        double margin = 0;
+        ///pnl of overall position including locked in pnl (contribution to _pnl)
+        double pnl = 0;
     };
 
     mutable std::mutex _mx;
 
     std::string _label;
     std::string _currency;
+    Exchange _exchange;
     double _equity;
     double _leverage;
     double _fees = 0;
     PositionID _position_counter = 1;
+    ///sum of margins of all positions
+    double _margin = 0;
+    ///sum of pnl of all positions
+    double _pnl = 0;
+    bool _consistency_check = false;
+    InstrumentResolver _resolver;
 
     mutable std::unordered_map<const IInstrument *, InstrumentInfo> _positions;
     void realize_position(const Instrument::Config &icfg, const Position &pos, double price);
 
     static OverallPosition calc_overall(const InstrumentInfo &ii);
     static void update_overall(InstrumentInfo &ii) ;
+    InstrumentInfo &get_instrument_info(const Instrument &instrument);
+    ///recalculate contribution of the instrument and update totals
+    void update_state(InstrumentInfo &ii);
+    ///recalculate pnl contribution of the instrument and update totals
+    void update_pnl(InstrumentInfo &ii);
+    double maintenance_leverage() const;
+    static double calc_pnl(const InstrumentInfo &ii);
+    static double calc_margin(const InstrumentInfo &ii, double leverage);
+    void check_consistency() const;
 
 };
 
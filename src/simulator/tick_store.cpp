@@ -0,0 +1,202 @@
+#include "tick_store.h"
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trading_api {
+
+static constexpr unsigned int column_count = 3+TickStore::field_count;
+static constexpr std::size_t column_elem_size[column_count] = {
+        sizeof(std::int64_t), sizeof(std::uint32_t), sizeof(std::uint8_t),
+        sizeof(double), sizeof(double), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(double), sizeof(double)
+};
+
+TickStoreWriter::TickStoreWriter(std::string pathname)
+    :_pathname(std::move(pathname)) {
+    for (unsigned int i = 0; i < column_count; ++i) {
+        _columns[i].open(column_pathname(i), std::ios::out|std::ios::trunc|std::ios::binary);
+        if (!_columns[i]) throw std::runtime_error("Unable to create file: " + column_pathname(i));
+    }
+}
+
+TickStoreWriter::~TickStoreWriter() {
+    try {
+        close();
+    } catch (...) {
+        //ignore
+    }
+}
+
+std::string TickStoreWriter::column_pathname(unsigned int idx) const {
+    return _pathname + ".col" + std::to_string(idx) + ".tmp";
+}
+
+std::uint32_t TickStoreWriter::instrument_index(std::string_view instrument_id) {
+    auto iter = _instrument_map.find(std::string(instrument_id));
+    if (iter != _instrument_map.end()) return iter->second;
+    auto idx = static_cast<std::uint32_t>(_instruments.size());
+    _instruments.push_back(std::string(instrument_id));
+    _instrument_map.emplace(_instruments.back(), idx);
+    return idx;
+}
+
+void TickStoreWriter::add_record(const Timestamp &tp, std::string_view instrument_id,
+        TickStore::Kind kind, std::span<const double> fields) {
+    if (_closed) throw std::logic_error("TickStoreWriter is closed");
+    std::int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+    if (_count && t < _last_time) throw std::invalid_argument("TickStoreWriter: records must be ordered by time");
+    std::uint32_t idx = instrument_index(instrument_id);
+    std::uint8_t k = static_cast<std::uint8_t>(kind);
+    _columns[0].write(reinterpret_cast<const char *>(&t), sizeof(t));
+    _columns[1].write(reinterpret_cast<const char *>(&idx), sizeof(idx));
+    _columns[2].write(reinterpret_cast<const char *>(&k), sizeof(k));
+    for (unsigned int i = 0; i < TickStore::field_count; ++i) {
+        double v = i < fields.size()?fields[i]:0.0;
+        _columns[3+i].write(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+    _last_time = t;
+    ++_count;
+}
+
+void TickStoreWriter::add(const Timestamp &tp, std::string_view instrument_id, const Ticker &tk) {
+    double fields[] = {tk.bid, tk.bid_volume, tk.ask, tk.ask_volume, tk.last, tk.volume, tk.index};
+    add_record(tp, instrument_id, TickStore::Kind::ticker, fields);
+}
+
+void TickStoreWriter::add(const Timestamp &tp, std::string_view instrument_id, const OrderBook::Update &up) {
+    double fields[] = {up.level, up.amount};
+    add_record(tp, instrument_id,
+            up.side == Side::buy?TickStore::Kind::bid_update:TickStore::Kind::ask_update,
+            fields);
+}
+
+void TickStoreWriter::close() {
+    if (_closed) return;
+    _closed = true;
+    for (auto &c: _columns) c.close();
+
+    TickStore::Header hdr = {};
+    hdr.magic = TickStore::magic;
+    hdr.version = TickStore::version;
+    hdr.record_count = _count;
+    hdr.instrument_count = static_cast<std::uint32_t>(_instruments.size());
+    hdr.instrument_table = sizeof(hdr);
+    std::size_t offset = hdr.instrument_table;
+    for (const auto &s: _instruments) offset += s.size()+1;
+    std::uint64_t *col_offsets[column_count] = {&hdr.time_column, &hdr.index_column, &hdr.kind_column};
+    for (unsigned int i = 0; i < TickStore::field_count; ++i) col_offsets[3+i] = &hdr.field_column[i];
+    for (unsigned int i = 0; i < column_count; ++i) {
+        offset = TickStore::align(offset);
+        *col_offsets[i] = offset;
+        offset += column_elem_size[i] * _count;
+    }
+
+    std::ofstream out(_pathname, std::ios::out|std::ios::trunc|std::ios::binary);
+    if (!out) throw std::runtime_error("Unable to create file: " + _pathname);
+    out.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    for (const auto &s: _instruments) out.write(s.c_str(), s.size()+1);
+    for (unsigned int i = 0; i < column_count; ++i) {
+        auto pos = static_cast<std::size_t>(out.tellp());
+        while (pos < *col_offsets[i]) {
+            out.put(0);
+            ++pos;
+        }
+        std::ifstream in(column_pathname(i), std::ios::in|std::ios::binary);
+        if (_count) out << in.rdbuf();
+        in.close();
+        std::filesystem::remove(column_pathname(i));
+    }
+    if (!out) throw std::runtime_error("Failed to write file: " + _pathname);
+}
+
+MappedTickStore::MappedTickStore(const std::string &pathname) {
+    int fd = ::open(pathname.c_str(), O_RDONLY|O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error("Unable to open file: " + pathname);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(TickStore::Header)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid tick store file: " + pathname);
+    }
+    _map_size = st.st_size;
+    _map = ::mmap(nullptr, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (_map == MAP_FAILED) {
+        _map = nullptr;
+        throw std::runtime_error("Unable to map file: " + pathname);
+    }
+    ::madvise(_map, _map_size, MADV_SEQUENTIAL);
+
+    const char *base = static_cast<const char *>(_map);
+    _hdr = reinterpret_cast<const TickStore::Header *>(base);
+    auto check_column = [&](std::uint64_t offset, std::size_t elem_size) {
+        return offset % TickStore::alignment == 0
+                && offset <= _map_size
+                && (_map_size - offset) / elem_size >= _hdr->record_count;
+    };
+    bool ok = _hdr->magic == TickStore::magic && _hdr->version == TickStore::version
+            && _hdr->instrument_table >= sizeof(TickStore::Header)
+            && _hdr->instrument_table <= _hdr->time_column
+            && check_column(_hdr->time_column, sizeof(std::int64_t))
+            && check_column(_hdr->index_column, sizeof(std::uint32_t))
+            && check_column(_hdr->kind_column, sizeof(std::uint8_t));
+    for (unsigned int i = 0; ok && i < TickStore::field_count; ++i) {
+        ok = check_column(_hdr->field_column[i], sizeof(double));
+    }
+    if (!ok) {
+        ::munmap(_map, _map_size);
+        throw std::runtime_error("Invalid tick store file: " + pathname);
+    }
+
+    const char *tbl = base + _hdr->instrument_table;
+    const char *tbl_end = base + _hdr->time_column;
+    for (std::uint32_t i = 0; i < _hdr->instrument_count && tbl < tbl_end; ++i) {
+        std::size_t len = strnlen(tbl, tbl_end - tbl);
+        //identifier must not be empty and must be terminated inside of the table
+        if (len == 0 || len == static_cast<std::size_t>(tbl_end - tbl)) break;
+        _instruments.push_back(std::string(tbl, len));
+        tbl += len+1;
+    }
+    if (_instruments.size() != _hdr->instrument_count) {
+        ::munmap(_map, _map_size);
+        throw std::runtime_error("Invalid tick store file: " + pathname);
+    }
+
+    _time = reinterpret_cast<const std::int64_t *>(base + _hdr->time_column);
+    _index = reinterpret_cast<const std::uint32_t *>(base + _hdr->index_column);
+    _kind = reinterpret_cast<const std::uint8_t *>(base + _hdr->kind_column);
+    for (unsigned int i = 0; i < TickStore::field_count; ++i) {
+        _fields[i] = reinterpret_cast<const double *>(base + _hdr->field_column[i]);
+    }
+}
+
+MappedTickStore::~MappedTickStore() {
+    if (_map) ::munmap(_map, _map_size);
+}
+
+void MappedTickStore::advise_range(const void *column, std::size_t elem_size, std::size_t from, std::size_t count) const {
+    static const std::uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    auto beg = reinterpret_cast<std::uintptr_t>(column) + from * elem_size;
+    auto end = beg + count * elem_size;
+    beg &= ~(page_size-1);
+    ::madvise(reinterpret_cast<void *>(beg), end - beg, MADV_WILLNEED);
+}
+
+void MappedTickStore::prefetch(std::size_t from, std::size_t count) const {
+    if (from >= size()) return;
+    count = std::min(count, size() - from);
+    advise_range(_time, sizeof(*_time), from, count);
+    advise_range(_index, sizeof(*_index), from, count);
+    advise_range(_kind, sizeof(*_kind), from, count);
+    for (const double *f: _fields) {
+        advise_range(f, sizeof(*f), from, count);
+    }
+}
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "../trading_ifc/ticker.h"
+#include "../trading_ifc/orderbook.h"
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace trading_api {
+
+///Column oriented on-disk format of market data for simulator replay
+/**
+ * The file is designed to be mapped into memory. Every column is stored
+ * as contiguous array aligned to the cache line, so the reader can access
+ * records directly from the mapping without any parsing or allocation
+ *
+ * @code
+ * +--------+-------------+------+-------+------+----+----+ ... +----+
+ * | header | instruments | time | index | kind | f0 | f1 |     | f6 |
+ * +--------+-------------+------+-------+------+----+----+ ... +----+
+ * @endcode
+ *
+ * Records are ordered by time. Fields of the ticker are stored in columns
+ * f0-f6 in order of declaration. Orderbook update uses f0 for level and
+ * f1 for amount, the side is encoded in the kind column.
+ */
+class TickStore {
+public:
+
+    enum class Kind: std::uint8_t {
+        ///record is ticker
+        ticker = 0,
+        ///record is update of bid side of orderbook
+        bid_update = 1,
+        ///record is update of ask side of orderbook
+        ask_update = 2
+    };
+
+    static constexpr std::uint32_t magic = 0x4B435454;  //"TTCK"
+    static constexpr std::uint32_t version = 1;
+    static constexpr unsigned int field_count = 7;
+    static constexpr std::size_t alignment = 64;
+
+    struct Header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t record_count;
+        std::uint32_t instrument_count;
+        std::uint32_t reserved;
+        ///offset of instrument table (zero terminated strings)
+        std::uint64_t instrument_table;
+        ///offset of timestamp column (int64, nanoseconds since epoch)
+        std::uint64_t time_column;
+        ///offset of instrument index column (uint32)
+        std::uint64_t index_column;
+        ///offset of kind column (uint8)
+        std::uint64_t kind_column;
+        ///offsets of field columns (double)
+        std::uint64_t field_column[field_count];
+    };
+
+    static constexpr std::size_t align(std::size_t offset) {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+};
+
+///Writes market data to TickStore file
+/**
+ * Columns are spilled to temporary files while records are added, so
+ * the writer doesn't need to keep whole dataset in memory. Final file
+ * is assembled by close()
+ */
+class TickStoreWriter {
+public:
+
+    ///Create writer
+    /**
+     * @param pathname pathname of target file
+     * @exception std::runtime_error unable to create file
+     */
+    explicit TickStoreWriter(std::string pathname);
+    TickStoreWriter(const TickStoreWriter &) = delete;
+    TickStoreWriter &operator=(const TickStoreWriter &) = delete;
+    ~TickStoreWriter();
+
+    ///add ticker record
+    /**
+     * @param tp timestamp - must not be less than timestamp of previous record
+     * @param instrument_id instrument identifier (Instrument::get_id())
+     * @param tk ticker
+     * @exception std::invalid_argument records are not ordered
+     */
+    void add(const Timestamp &tp, std::string_view instrument_id, const Ticker &tk);
+    ///add orderbook update record
+    /**
+     * @param tp timestamp - must not be less than timestamp of previous record
+     * @param instrument_id instrument identifier (Instrument::get_id())
+     * @param up orderbook update
+     * @exception std::invalid_argument records are not ordered
+     */
+    void add(const Timestamp &tp, std::string_view instrument_id, const OrderBook::Update &up);
+
+    ///finish the file
+    /**
+     * @note called by destructor, but exceptions are ignored there
+     */
+    void close();
+
+protected:
+    std::string _pathname;
+    std::ofstream _columns[3+TickStore::field_count];
+    std::unordered_map<std::string, std::uint32_t> _instrument_map;
+    std::vector<std::string> _instruments;
+    std::uint64_t _count = 0;
+    std::int64_t _last_time = 0;
+    bool _closed = false;
+
+    std::string column_pathname(unsigned int idx) const;
+    std::uint32_t instrument_index(std::string_view instrument_id);
+    void add_record(const Timestamp &tp, std::string_view instrument_id,
+            TickStore::Kind kind, std::span<const double> fields);
+};
+
+///Read only memory mapped TickStore file
+class MappedTickStore {
+public:
+
+    using Kind = TickStore::Kind;
+
+    ///Map file into memory
+    /**
+     * @param pathname pathname of file
+     * @exception std::runtime_error unable to open file or invalid format
+     */
+    explicit MappedTickStore(const std::string &pathname);
+    MappedTickStore(const MappedTickStore &) = delete;
+    MappedTickStore &operator=(const MappedTickStore &) = delete;
+    ~MappedTickStore();
+
+    ///count of records
+    std::size_t size() const {return _hdr->record_count;}
+    ///list of instrument identifiers, instrument index refers this list
+    std::span<const std::string> get_instruments() const {return _instruments;}
+
+    Timestamp get_time(std::size_t idx) const {
+        return Timestamp(std::chrono::duration_cast<TimeSpan>(std::chrono::nanoseconds(_time[idx])));
+    }
+    std::uint32_t get_instrument_index(std::size_t idx) const {return _index[idx];}
+    Kind get_kind(std::size_t idx) const {return static_cast<Kind>(_kind[idx]);}
+
+    ///Check that record refers existing instrument and has known kind
+    /**
+     * Columns are not validated when the file is opened, because it would
+     * need to read whole file. The reader must check every record before
+     * it is used
+     *
+     * @param idx index of record
+     * @retval true record is valid
+     * @retval false record is corrupted
+     */
+    bool is_valid(std::size_t idx) const {
+        return _index[idx] < _instruments.size()
+                && _kind[idx] <= static_cast<std::uint8_t>(Kind::ask_update);
+    }
+
+    ///retrieve ticker (valid only if kind is ticker)
+    Ticker get_ticker(std::size_t idx) const {
+        return Ticker{_fields[0][idx], _fields[1][idx], _fields[2][idx], _fields[3][idx],
+                      _fields[4][idx], _fields[5][idx], _fields[6][idx]};
+    }
+    ///retrieve orderbook update (valid only if kind is bid_update or ask_update)
+    OrderBook::Update get_orderbook_update(std::size_t idx) const {
+        return OrderBook::Update{get_kind(idx) == Kind::bid_update?Side::buy:Side::sell,
+                                 _fields[0][idx], _fields[1][idx]};
+    }
+
+    ///Advise kernel to read range of records ahead
+    /**
+     * @param from index of first record
+     * @param count count of records
+     */
+    void prefetch(std::size_t from, std::size_t count) const;
+
+protected:
+    void *_map = nullptr;
+    std::size_t _map_size = 0;
+    const TickStore::Header *_hdr = nullptr;
+    const std::int64_t *_time = nullptr;
+    const std::uint32_t *_index = nullptr;
+    const std::uint8_t *_kind = nullptr;
+    const double *_fields[TickStore::field_count] = {};
+    std::vector<std::string> _instruments;
+
+    void advise_range(const void *column, std::size_t elem_size, std::size_t from, std::size_t count) const;
+};
+
+
+}
@@ -0,0 +1,117 @@
+#include "check.h"
+#include "../common/async_log.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace trading_api;
+
+class CaptureLog: public ILog {
+public:
+    virtual void output(Serverity level, std::string_view msg) override {
+        std::lock_guard _(_mx);
+        lines.push_back({level, std::string(msg)});
+    }
+    virtual Serverity get_min_level() const override {return Serverity::debug;}
+
+    std::vector<std::pair<Serverity, std::string> > take() {
+        std::lock_guard _(_mx);
+        return std::move(lines);
+    }
+protected:
+    std::mutex _mx;
+    std::vector<std::pair<Serverity, std::string> > lines;
+};
+
+struct Price {
+    double v;
+};
+
+std::ostream &operator<<(std::ostream &out, const Price &p) {
+    return out << "$" << p.v;
+}
+
+///write same lines to the log
+static void write_lines(Log &log) {
+    std::string s = "temp";
+    std::vector<int> v = {1,2,3};
+    log.output(Log::Serverity::info, "int {} double {}", 42, 1.5);
+    log.output(Log::Serverity::warning, "str {} {} {}", s, std::string_view("view"), "literal");
+    log.output(Log::Serverity::info, "container {} pair {}", v, std::pair(1, "x"));
+    log.output(Log::Serverity::info, "lazy {} custom {}", [&]{return s + "!";}, Price{10.25});
+    log.output(Log::Serverity::trace, "filtered {}", 1);
+    log.output(Log::Serverity::error, Log::runtime_pattern(std::string("dynamic {} pattern {3}")), 7);
+}
+
+int main() {
+    auto sync_target = std::make_shared<CaptureLog>();
+    auto async_target = std::make_shared<CaptureLog>();
+    auto async_log = std::make_shared<AsyncLog>(async_target);
+
+    //deferred formatting gives same result as immediate formatting
+    {
+        Log sync(Log(sync_target), "ctx{}", 1);
+        Log async(Log(async_log), "ctx{}", 1);
+        write_lines(sync);
+        write_lines(async);
+        async_log->flush();
+        auto expected = sync_target->take();
+        auto result = async_target->take();
+        CHECK_EQUAL(result.size(), 5U);
+        CHECK_EQUAL(result.size(), expected.size());
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            CHECK(result[i].first == expected[i].first);
+            CHECK_EQUAL(result[i].second, expected[i].second);
+        }
+        //formatted message passed directly
+        async_log->output(Log::Serverity::info, "raw message");
+        async_log->flush();
+        CHECK_EQUAL(async_target->take()[0].second, "raw message");
+    }
+
+    //lines of each thread keep their order
+    {
+        constexpr int threads = 4;
+        constexpr int lines = 5000;
+        std::vector<std::thread> thr;
+        for (int t = 0; t < threads; ++t) {
+            thr.emplace_back([&, t]{
+                Log log(Log(async_log), "t{}", t);
+                for (int i = 0; i < lines; ++i) log.output(Log::Serverity::info, "{}", i);
+            });
+        }
+        for (auto &t: thr) t.join();
+        async_log->flush();
+        std::map<std::string, int> next;
+        int mismatch = 0;
+        auto result = async_target->take();
+        for (const auto &[lv, ln]: result) {
+            auto p = ln.find(']');
+            int &n = next[ln.substr(0, p)];
+            mismatch += std::stoi(ln.substr(p+1)) != n;
+            ++n;
+        }
+        CHECK_EQUAL(mismatch, 0);
+        CHECK_EQUAL(result.size(), static_cast<std::size_t>(threads * lines));
+        CHECK_EQUAL(async_log->get_stats().dropped, 0U);
+    }
+
+    //full ring drops records and reports them
+    {
+        auto target = std::make_shared<CaptureLog>();
+        auto small = std::make_shared<AsyncLog>(target, AsyncLog::Config{
+            .ring_size = 256, .poll_interval = std::chrono::seconds(10)});
+        Log log(small);
+        for (int i = 0; i < 100; ++i) log.output(Log::Serverity::info, "line {}", i);
+        small->flush();
+        auto st = small->get_stats();
+        CHECK_GREATER(st.dropped, 0U);
+        CHECK_EQUAL(st.written + st.dropped, 100U);
+        auto result = target->take();
+        CHECK(result.back().first == Log::Serverity::warning);
+        CHECK_EQUAL(result.size(), st.written + 1);
+    }
+}
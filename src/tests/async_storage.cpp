@@ -0,0 +1,137 @@
+#include "check.h"
+#include "../common/async_storage.h"
+#include "../common/memory_storage.h"
+
+#include <atomic>
+#include <future>
+#include <map>
+
+using namespace trading_api;
+
+///memory storage which blocks commit until gate is opened
+class GateStorage: public MemoryStorage {
+public:
+    void open() {
+        {
+            std::lock_guard _(_mx);
+            _open = true;
+        }
+        _cond.notify_all();
+    }
+    virtual void commit() override {
+        std::unique_lock lk(_mx);
+        _cond.wait(lk, [&]{return _open;});
+        lk.unlock();
+        MemoryStorage::commit();
+    }
+    virtual void put_var(std::string_view name, std::string_view value) override {
+        if (name == "fail") throw std::runtime_error("backend failure");
+        MemoryStorage::put_var(name, value);
+    }
+protected:
+    std::mutex _mx;
+    std::condition_variable _cond;
+    bool _open = false;
+};
+
+static Fill make_fill(int n) {
+    Fill f = {};
+    f.time = Timestamp(std::chrono::seconds(1000 + n));
+    f.id = "fill" + std::to_string(n);
+    f.label = n & 1?"odd":"even";
+    f.price = 100.0 + n;
+    f.amount = 1.0;
+    return f;
+}
+
+static std::string dump_vars(const IStorage &st, std::string_view prefix) {
+    std::string out;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+        out.append(k).append("=").append(v).append(";");
+    };
+    st.enum_vars(prefix, std::string(prefix) + "\xFF", fn);
+    return out;
+}
+
+int main() {
+    auto backend = std::make_unique<GateStorage>();
+    GateStorage *gate = backend.get();
+    //writer thread holds the first transaction in backend, so next two stay pending
+    AsyncStorage st(std::move(backend), {.max_pending = 3});
+
+    st.begin_transaction();
+    st.put_var("a", "1");
+    st.put_var("b", "1");
+    //read-your-writes in open transaction
+    CHECK_EQUAL(st.get_var("a"), "1");
+    st.commit();
+
+    st.begin_transaction();
+    st.put_var("a", "2");
+    st.erase_var("b");
+    st.put_fill(make_fill(1));
+    st.put_fill(make_fill(2));
+    st.commit();
+
+    st.begin_transaction();
+    st.put_var("c", "3");
+    st.put_fill(make_fill(3));
+    st.commit();
+
+    //nothing is applied yet, values are read from pending transactions
+    CHECK_EQUAL(gate->get_var("a"), "");
+    CHECK_EQUAL(st.get_var("a"), "2");
+    CHECK_EQUAL(st.get_var("b"), "");
+    CHECK(st.is_duplicate_fill(make_fill(2)));
+
+    //queue is full, next commit blocks until writer makes space
+    auto blocked = std::async(std::launch::async, [&]{
+        st.begin_transaction();
+        st.put_var("d", "4");
+        st.commit();
+    });
+    CHECK(blocked.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+    gate->open();
+    blocked.get();
+    //pending fill with the same id and different time is a different fill
+    Fill other = make_fill(3);
+    other.time += std::chrono::seconds(1);
+    CHECK(!st.is_duplicate_fill(other));
+    CHECK_EQUAL(st.get_stats().backpressure, 1U);
+
+    st.flush();
+    CHECK_EQUAL(st.get_stats().applied, 4U);
+    CHECK_EQUAL(gate->get_var("a"), "2");
+    CHECK_EQUAL(dump_vars(*gate, ""), "a=2;c=3;d=4;");
+    CHECK(!st.is_duplicate_fill(make_fill(4)));
+
+    //merged reads are consistent, regardless of how many transactions are applied
+    std::map<std::string, std::string> ref = {{"a","2"},{"c","3"},{"d","4"}};
+    int mismatch = 0;
+    for (int i = 0; i < 2000; ++i) {
+        std::string k = "k" + std::to_string(i % 50);
+        st.begin_transaction();
+        if (i % 3 == 0) {
+            st.erase_var(k);
+            ref.erase(k);
+        } else {
+            st.put_var(k, std::to_string(i));
+            ref[k] = std::to_string(i);
+        }
+        st.put_fill(make_fill(i + 10));
+        st.commit();
+        std::string expected;
+        for (const auto &[rk, rv]: ref) expected.append(rk).append("=").append(rv).append(";");
+        mismatch += dump_vars(st, "") != expected;
+        mismatch += st.get_var(k) != (ref.count(k)?ref[k]:std::string());
+        mismatch += st.load_fills(std::size_t(1), {})[0].id != make_fill(i + 10).id;
+    }
+    CHECK_EQUAL(mismatch, 0);
+    st.flush();
+    CHECK_EQUAL(st.load_fills(std::size_t(10000), {}).size(), 2003U);
+
+    //backend error is reported to the strategy thread
+    st.put_var("fail", "x");
+    CHECK_EXCEPTION(std::runtime_error, st.flush());
+    CHECK_EXCEPTION(std::runtime_error, st.put_var("e", "5"));
+}
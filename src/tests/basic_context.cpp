@@ -0,0 +1,104 @@
+#include "check.h"
+#include "../common/basic_context.h"
+#include "../common/memory_storage.h"
+#include "../common/context_scheduler.h"
+#include "../simulator/sim_exchange.h"
+
+#include <future>
+#include <thread>
+
+using namespace trading_api;
+
+class TestInstrument: public IInstrument::Null {
+public:
+    TestInstrument(Exchange ex):_ex(std::move(ex)) {}
+    virtual std::string get_id() const override {return "TEST";}
+    virtual Exchange get_exchange() const override {return _ex;}
+protected:
+    Exchange _ex;
+};
+
+class TestAccount: public IAccount::Null {
+public:
+    TestAccount(Exchange ex):_ex(std::move(ex)) {}
+    virtual std::string get_id() const override {return "TEST";}
+    virtual Exchange get_exchange() const override {return _ex;}
+protected:
+    Exchange _ex;
+};
+
+class NullLog: public ILog {
+public:
+    virtual void output(Serverity, std::string_view) override {}
+    virtual Serverity get_min_level() const override {return Serverity::fatal;}
+};
+
+///Records fills, blocks processing of the first fill until released
+class FillStrategy: public AbstractStrategy {
+public:
+    virtual void on_init(const Context &) override {}
+    virtual std::string on_fill(Order, const Fill &fill) override {
+        if (prices.empty()) {
+            while (!release.load()) std::this_thread::yield();
+        }
+        prices.push_back(fill.price);
+        received.store(prices.size());
+        return {};
+    }
+    std::atomic<bool> release = false;
+    std::atomic<std::size_t> received = 0;
+    std::vector<double> prices;
+};
+
+static void test_inbound_overflow() {
+    auto ectx = std::make_unique<BasicExchangeContext>();
+    BasicExchangeContext *e = ectx.get();
+    IExchangeContext *svc_ctx = e;
+    ectx->init(std::make_unique<SimExchange>([](auto, auto, auto){}, SimExchange::Config{}), {});
+    ectx->start_io_thread();
+    Exchange ex = BasicExchange::create(std::move(ectx), "test");
+    Instrument i(std::make_shared<TestInstrument>(ex));
+    Account a(std::make_shared<TestAccount>(ex));
+
+    auto sch = create_scheduler();
+    BasicContext::GlobalScheduler gsch = [sch](Timestamp tp, std::function<void(Timestamp)> fn, const void *ident) mutable {
+        sch(tp, std::move(fn), ident);
+    };
+    auto strategy = std::make_unique<FillStrategy>();
+    FillStrategy *st = strategy.get();
+    BasicContext ctx(std::make_unique<MemoryStorage>(), gsch, Log(std::make_shared<NullLog>()), "test");
+    ctx.init(std::move(strategy), {a}, {i}, {});
+
+    Order order = e->create_order(i, a, Order::Limit(Side::buy, 1, 100));
+    e->batch_place(&ctx, std::span(&order, 1));
+
+    //more events than capacity of the inbound queue, the strategy is blocked
+    //on the first one, so the queue overflows
+    constexpr std::size_t count = 10000;
+    Timestamp tp = std::chrono::system_clock::now();
+    for (std::size_t n = 0; n < count; ++n) {
+        svc_ctx->order_fill(order, Fill{tp, "f" + std::to_string(n), {}, static_cast<double>(n), 0.001, 0});
+    }
+    //ticker is processed by the I/O thread after all fills
+    svc_ctx->income_data(i, Ticker{1, 1, 1, 1, 1, 1, 1});
+    Ticker tk;
+    while (!ex.get_last_ticker(i, tk)) std::this_thread::yield();
+
+    st->release.store(true);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (st->received.load() < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    //wait until the scheduler finishes current event before the context is destroyed
+    std::promise<void> idle;
+    sch(Timestamp::min(), [&](Timestamp){idle.set_value();}, &idle);
+    idle.get_future().wait();
+    CHECK_EQUAL(st->received.load(), count);
+    bool ordered = true;
+    for (std::size_t n = 0; n < count; ++n) ordered = ordered && st->prices[n] == static_cast<double>(n);
+    CHECK(ordered);
+}
+
+int main() {
+    test_inbound_overflow();
+}
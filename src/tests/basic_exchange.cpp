@@ -0,0 +1,196 @@
+#include "check.h"
+#include "../common/basic_exchange.h"
+#include "../common/basic_order.h"
+#include "../simulator/sim_exchange.h"
+
+using namespace trading_api;
+
+///Records times of subscription events
+class Recorder: public IEventTarget {
+public:
+    Recorder(ManualContextScheduler &sch):_sch(sch) {}
+    virtual void on_event(const Instrument &) override {}
+    virtual void on_event(const Account &) override {}
+    virtual void on_event(const Instrument &, SubscriptionType) override {
+        events.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(
+                _sch.get_time().time_since_epoch()).count());
+    }
+    virtual void on_event(const Instrument &i, SubscriptionType type,
+            std::shared_ptr<std::atomic<bool> > pending) override {
+        //keep the flag set, the event is not processed until release()
+        this->pending = std::move(pending);
+        on_event(i, type);
+    }
+    virtual void on_event(const Order &, const Order::Report &) override {}
+    virtual void on_event(const Order &, const Fill &) override {}
+    void release() {
+        pending->store(false, std::memory_order_release);
+    }
+    std::vector<long long> events;
+    std::shared_ptr<std::atomic<bool> > pending;
+protected:
+    ManualContextScheduler &_sch;
+};
+
+///Records orders passed to the exchange
+class RecordingExchange: public SimExchange {
+public:
+    using SimExchange::SimExchange;
+    virtual Order create_order_replace(const Order &replace, const Order::Setup &setup, bool amend) override {
+        if (discard) return Order(std::make_shared<ErrorOrder>(replace.get_instrument(),
+                replace.get_account(), Order::Reason::invalid_params, "test"));
+        return SimExchange::create_order_replace(replace, setup, amend);
+    }
+    virtual void batch_place(std::span<Order> orders) override {
+        placed.insert(placed.end(), orders.begin(), orders.end());
+    }
+    virtual void batch_cancel(std::span<Order> orders) override {
+        canceled.insert(canceled.end(), orders.begin(), orders.end());
+    }
+    bool discard = false;
+    std::vector<Order> placed;
+    std::vector<Order> canceled;
+};
+
+///Records order reports
+class OrderRecorder: public IEventTarget {
+public:
+    virtual void on_event(const Instrument &) override {}
+    virtual void on_event(const Account &) override {}
+    virtual void on_event(const Instrument &, SubscriptionType) override {}
+    virtual void on_event(const Order &order, const Order::Report &report) override {
+        reports.emplace_back(order, report.new_state);
+    }
+    virtual void on_event(const Order &, const Fill &) override {}
+    std::vector<std::pair<Order, Order::State> > reports;
+};
+
+static Timestamp at(int ms) {
+    return Timestamp(std::chrono::milliseconds(ms));
+}
+
+///real clock values, first throttled event is not deferred
+static void test_real_time() {
+    auto sch = create_scheduler_manual();
+    BasicExchangeContext ectx;
+    ectx.init(std::make_unique<SimExchange>([](auto, auto, auto){}, SimExchange::Config{}), {});
+    ectx.set_clock([sch]{return sch.get_time();});
+    ectx.set_scheduler(sch);
+    IExchangeContext &svc_ctx = ectx;
+    Instrument i(std::make_shared<IInstrument::Null>());
+    Timestamp start = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+
+    Recorder throttle(sch);
+    ectx.subscribe(&throttle, SubscriptionType::ticker, i,
+            {SubscriptionPolicy::Mode::throttle, std::chrono::milliseconds(100)});
+    sch.set_time(start);
+    svc_ctx.income_data(i, Ticker{1, 1, 2, 1, 1, 0, 0});
+    CHECK_EQUAL(throttle.events.size(), 1U);
+    CHECK(!sch.get_next_event().has_value());
+    sch.set_time(start + std::chrono::milliseconds(50));
+    svc_ctx.income_data(i, Ticker{3, 1, 4, 1, 3, 0, 0});
+    CHECK_EQUAL(throttle.events.size(), 1U);
+    CHECK(sch.advance());
+    CHECK_EQUAL(throttle.events.size(), 2U);
+    CHECK_EQUAL(throttle.events.back(), std::chrono::duration_cast<std::chrono::milliseconds>(
+            (start + std::chrono::milliseconds(100)).time_since_epoch()).count());
+}
+
+///cancel+new merged by the throttle, the strategy refers the new order
+static void test_throttle_merge() {
+    BasicExchangeContext ectx;
+    auto svc = std::make_unique<RecordingExchange>([](auto, auto, auto){}, SimExchange::Config{});
+    RecordingExchange *ex = svc.get();
+    ectx.init(std::move(svc), {});
+    ectx.set_order_throttle({1.0, 1.0});
+    Instrument i(std::make_shared<IInstrument::Null>());
+    Account a(std::make_shared<IAccount::Null>());
+    OrderRecorder target;
+    auto make = [&](double price) {
+        return ectx.create_order(i, a, Order::Limit(Side::buy, 1, price));
+    };
+    auto place = [&](const Order &o) {return PlaceRequest{o, {}, false};};
+
+    Order o1 = make(100);
+    ectx.batch(&target, {}, std::vector{place(o1)}, at(1000));
+    CHECK_EQUAL(ex->placed.size(), 1U);
+    //cancel and new order wait for a token, they are merged to replace of o1
+    Order o2 = make(101);
+    std::vector<Order> cancels = {o1};
+    ectx.batch(&target, cancels, std::vector{place(o2)}, at(1000));
+    ectx.batch(&target, {}, {}, at(2000));
+    CHECK_EQUAL(ex->placed.size(), 2U);
+    Order n = ex->placed.back();
+    CHECK(n != o2);
+    //the strategy cancels o2, the exchange cancels the order which was sent
+    cancels = {o2};
+    ectx.batch(&target, cancels, {}, at(3000));
+    CHECK_EQUAL(ex->canceled.size(), 1U);
+    CHECK(ex->canceled.back() == n);
+    //replace of o2 replaces the order on the exchange
+    Order r = ectx.create_order_replace(o2, Order::Limit(Side::buy, 1, 102), false);
+    CHECK(!r.discarded());
+    CHECK(dynamic_cast<const BasicOrder &>(*r.get_handle()).get_replaced_order() == n);
+
+    //merged replace is discarded, canceled order is still canceled
+    Order o3 = make(100);
+    ectx.batch(&target, {}, std::vector{place(o3)}, at(4000));
+    Order o4 = make(101);
+    cancels = {o3};
+    ectx.batch(&target, cancels, std::vector{place(o4)}, at(4000));
+    ex->discard = true;
+    ectx.batch(&target, {}, {}, at(5000));
+    CHECK_EQUAL(ex->canceled.size(), 2U);
+    CHECK(ex->canceled.back() == o3);
+    CHECK(!target.reports.empty() && target.reports.back().first == o4
+            && target.reports.back().second == Order::State::discarded);
+}
+
+int main() {
+    test_real_time();
+    test_throttle_merge();
+    auto sch = create_scheduler_manual();
+    BasicExchangeContext ectx;
+    ectx.init(std::make_unique<SimExchange>([](auto, auto, auto){}, SimExchange::Config{}), {});
+    ectx.set_clock([sch]{return sch.get_time();});
+    ectx.set_scheduler(sch);
+    IExchangeContext &svc_ctx = ectx;
+    Instrument i(std::make_shared<IInstrument::Null>());
+
+    Recorder every(sch), conflate(sch), throttle(sch), top(sch);
+    ectx.subscribe(&every, SubscriptionType::ticker, i, {});
+    ectx.subscribe(&conflate, SubscriptionType::ticker, i, {SubscriptionPolicy::Mode::conflate});
+    ectx.subscribe(&throttle, SubscriptionType::ticker, i,
+            {SubscriptionPolicy::Mode::throttle, std::chrono::milliseconds(100)});
+    ectx.subscribe(&top, SubscriptionType::ticker, i, {SubscriptionPolicy::Mode::top_of_book});
+
+    auto send = [&](int ms, double bid, double ask, double last) {
+        sch.set_time(at(ms));
+        svc_ctx.income_data(i, Ticker{bid, 1, ask, 1, last, 0, 0});
+    };
+
+    send(1000, 1, 2, 1);
+    send(1010, 1, 2, 2);        //top of book didn't change
+    send(1050, 3, 4, 3);
+    //update from 1010 and 1050 is delivered at end of the interval
+    CHECK(sch.advance());
+    CHECK_EQUAL(sch.get_time().time_since_epoch().count(), at(1100).time_since_epoch().count());
+    conflate.release();
+    send(1150, 5, 6, 5);
+    CHECK(sch.advance());
+    //no updates during the interval - no trailing event
+    CHECK(!sch.advance());
+    send(1400, 7, 8, 7);        //conflate: still pending, quiet throttle is delivered at once
+    CHECK(!sch.advance());
+
+    CHECK(every.events == (std::vector<long long>{1000, 1010, 1050, 1150, 1400}));
+    CHECK(conflate.events == (std::vector<long long>{1000, 1150}));
+    CHECK(throttle.events == (std::vector<long long>{1000, 1100, 1200, 1400}));
+    CHECK(top.events == (std::vector<long long>{1000, 1050, 1150, 1400}));
+
+    //trailing update is not delivered to disconnected target
+    send(1450, 9, 10, 9);
+    ectx.disconnect(&throttle);
+    CHECK(sch.advance());
+    CHECK_EQUAL(throttle.events.size(), 4U);
+}
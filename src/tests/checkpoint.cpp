@@ -0,0 +1,237 @@
+#include "check.h"
+#include "../common/memory_storage.h"
+#include "../common/basic_context.h"
+#include "../simulator/sim_exchange.h"
+
+#include <filesystem>
+#include <sstream>
+
+using namespace trading_api;
+
+static Timestamp at(int ms) {
+    return Timestamp(std::chrono::milliseconds(ms));
+}
+
+template<typename T>
+static T make_scheduler(ManualContextScheduler &sch) {
+    return [sch](Timestamp tp, std::function<void(Timestamp)> fn, const void *ident) mutable {
+        sch(tp, std::move(fn), ident);
+    };
+}
+
+class TestInstrument: public IInstrument::Null {
+public:
+    TestInstrument(std::string id):_id(std::move(id)) {}
+    virtual std::string get_id() const override {return _id;}
+protected:
+    std::string _id;
+};
+
+class Recorder: public IExchangeContext::Null {
+public:
+    Recorder(ManualContextScheduler &sch):_sch(sch) {}
+    virtual void income_data(const Instrument &i, const Ticker &tk) override {
+        std::ostringstream s;
+        s << _sch.get_time().time_since_epoch().count() << " " << i.get_id() << " T " << tk.last;
+        events.push_back(s.str());
+    }
+    virtual void income_data(const Instrument &i, const OrderBook &) override {
+        events.push_back(i.get_id() + " B");
+    }
+    virtual void income_data(const Instrument &i, std::span<const OrderBook::Update> up, bool) override {
+        for (const auto &u: up) {
+            std::ostringstream s;
+            s << _sch.get_time().time_since_epoch().count() << " " << i.get_id() << " U " << u.level << " " << u.amount;
+            events.push_back(s.str());
+        }
+    }
+    std::vector<std::string> events;
+protected:
+    ManualContextScheduler &_sch;
+};
+
+class CountingTickSource: public TickStoreSource {
+public:
+    using TickStoreSource::TickStoreSource;
+    virtual void next() override {
+        ++calls;
+        TickStoreSource::next();
+    }
+    int calls = 0;
+};
+
+///Simulation which is constructed the same way for every run
+struct Replay {
+    ManualContextScheduler sch = create_scheduler_manual();
+    Recorder rec{sch};
+    std::shared_ptr<SimulAccount> acc = std::make_shared<SimulAccount>("acc", "USD", 1e6, 1);
+    SimExchange ex;
+    CountingTickSource *tick_source;
+
+    Replay(std::shared_ptr<const MappedTickStore> store, const std::vector<Instrument> &instruments)
+        :ex(make_scheduler<SimExchange::GlobalScheduler>(sch), {{}, instruments, {}, {acc}}) {
+        ex.init(ExchangeContext(&rec), {});
+        for (const auto &i: instruments) {
+            ex.subscribe(SubscriptionType::ticker, i);
+            ex.subscribe(SubscriptionType::orderbook, i);
+        }
+        acc->record_fill(instruments[0], Side::buy, 100, 1, Order::Behavior::standard);
+        auto src = std::make_unique<CountingTickSource>(store, instruments);
+        tick_source = src.get();
+        ex.add_source(std::move(src));
+        int t = 0;
+        ex.add_source(std::make_unique<GeneratorSource>([=](SimRecord &r) mutable {
+            if (t >= 100) return false;
+            r = {at(t*20+5), instruments[1], Ticker{0, 0, 0, 0, 1.0*t, 0, 0}};
+            ++t;
+            return true;
+        }));
+        ex.add_record(at(777), instruments[0], Ticker{0, 0, 0, 0, 777, 0, 0});
+        ex.add_record(at(1555), instruments[0], Ticker{0, 0, 0, 0, 1555, 0, 0});
+    }
+
+    void run_until(Timestamp tp) {
+        while (sch.get_next_event().has_value() && *sch.get_next_event() < tp) sch.advance();
+    }
+};
+
+static void test_sim_exchange_resume() {
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_checkpoint_ticks.bin").string();
+    auto chkname = (std::filesystem::temp_directory_path() / "tests_checkpoint_sim.bin").string();
+    {
+        TickStoreWriter wr(pathname);
+        for (int i = 0; i < 200; ++i) {
+            if (i % 3) wr.add(at(i*10), "BTCUSD", Ticker{0, 0, 0, 0, 100.0+i, 0, 0});
+            else wr.add(at(i*10), "ETHUSD", OrderBook::Update{Side::buy, 50.0+i, 1.0*i});
+        }
+    }
+    auto store = std::make_shared<MappedTickStore>(pathname);
+    std::vector<Instrument> instruments = {
+        Instrument(std::make_shared<TestInstrument>("BTCUSD")),
+        Instrument(std::make_shared<TestInstrument>("ETHUSD")),
+    };
+
+    Replay full(store, instruments);
+    full.run_until(Timestamp::max());
+    CHECK_GREATER(full.rec.events.size(), 300U);
+
+    Replay first(store, instruments);
+    first.run_until(at(1000));
+    std::vector<std::string> events = first.rec.events;
+    save_checkpoint(chkname, first.sch.get_time(), std::initializer_list<const ICheckpointable *>{&first.ex, first.acc.get()});
+
+    Replay second(store, instruments);
+    second.tick_source->calls = 0;
+    Timestamp tm = load_checkpoint(chkname, std::initializer_list<ICheckpointable *>{&second.ex, second.acc.get()});
+    //tick store is not replayed record by record
+    CHECK_EQUAL(second.tick_source->calls, 0);
+    second.sch.set_time(tm);
+    second.run_until(Timestamp::max());
+    events.insert(events.end(), second.rec.events.begin(), second.rec.events.end());
+
+    CHECK(events == full.rec.events);
+    CHECK_EQUAL(second.acc->calc_blocked(), full.acc->calc_blocked());
+    CHECK_EQUAL(second.acc->calc_blocked(), second.acc->calc_blocked_full());
+
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(chkname);
+}
+
+class NullLog: public ILog {
+public:
+    virtual void output(Serverity, std::string_view) override {}
+    virtual Serverity get_min_level() const override {return Serverity::fatal;}
+};
+
+class TimerStrategy: public AbstractStrategy {
+public:
+    TimerStrategy(std::vector<TimerID> &fired, bool resumed):_fired(fired),_resumed(resumed) {}
+    virtual void on_init(const Context &ctx) override {
+        _ctx = ctx;
+        if (_resumed) {
+            //replaced by the checkpoint
+            _ctx.set_timer(at(5), 9);
+        } else {
+            _ctx.set_timer(at(10), 1);
+            _ctx.set_timer(at(30), 3);
+            _ctx.set_timer(at(20), 2);
+        }
+    }
+    virtual void on_timer(TimerID id) override {
+        _fired.push_back(id);
+        if (id == 1) _ctx.set("state", "one");
+    }
+protected:
+    std::vector<TimerID> &_fired;
+    bool _resumed;
+    Context _ctx;
+};
+
+static void test_basic_context_resume() {
+    auto chkname = (std::filesystem::temp_directory_path() / "tests_checkpoint_ctx.bin").string();
+    Log log(std::make_shared<NullLog>());
+    std::vector<TimerID> fired;
+    Timestamp tm;
+    {
+        auto sch = create_scheduler_manual();
+        BasicContext ctx(std::make_unique<MemoryStorage>(), make_scheduler<BasicContext::GlobalScheduler>(sch), log, "test");
+        ctx.init(std::make_unique<TimerStrategy>(fired, false), {}, {}, {});
+        sch.set_time(at(15));
+        CHECK(fired == std::vector<TimerID>{1});
+        save_checkpoint(chkname, sch.get_time(), std::initializer_list<const ICheckpointable *>{&ctx});
+        tm = sch.get_time();
+    }
+    fired.clear();
+    auto sch = create_scheduler_manual();
+    BasicContext ctx(std::make_unique<MemoryStorage>(), make_scheduler<BasicContext::GlobalScheduler>(sch), log, "test");
+    ctx.init(std::make_unique<TimerStrategy>(fired, true), {}, {}, {});
+    CHECK_EQUAL(load_checkpoint(chkname, std::initializer_list<ICheckpointable *>{&ctx}).time_since_epoch().count(), tm.time_since_epoch().count());
+    sch.set_time(tm);
+    while (sch.advance());
+    CHECK(fired == (std::vector<TimerID>{2, 3}));
+    CHECK_EQUAL(ctx.get_var("state"), "one");
+
+    std::filesystem::remove(chkname);
+}
+
+int main() {
+
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_checkpoint.bin").string();
+    Timestamp tm = std::chrono::system_clock::now();
+
+    MemoryStorage st1;
+    st1.put_var("alpha", "1");
+    st1.put_var("beta", "2");
+    st1.put_fill(Fill{tm, "f1", "lbl", 100.0, 2.0, 0.1});
+    st1.put_fill(Fill{tm + std::chrono::seconds(1), "f2", "other", 101.0, 3.0, 0.2});
+    save_checkpoint(pathname, tm, std::initializer_list<const ICheckpointable *>{&st1});
+
+    MemoryStorage st2;
+    st2.put_var("gamma", "3");
+    Timestamp tm2 = load_checkpoint(pathname, std::initializer_list<ICheckpointable *>{&st2});
+    CHECK_EQUAL(tm2.time_since_epoch().count(), std::chrono::duration_cast<TimeSpan>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(tm.time_since_epoch())).count());
+
+    std::string vars;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+        vars.append(k).append("=").append(v).append(";");
+    };
+    st2.enum_vars("a", "z", fn);
+    CHECK_EQUAL(vars, "alpha=1;beta=2;");
+
+    Fills f = st2.load_fills(std::size_t(10), {});
+    CHECK_EQUAL(f.size(), 2U);
+    CHECK_EQUAL(f[0].id, "f2");
+    CHECK_EQUAL(f[0].label, "other");
+    CHECK_EQUAL(f[0].amount, 3.0);
+    CHECK_EQUAL(f[1].price, 100.0);
+
+    MemoryStorage st3;
+    CHECK_EXCEPTION(std::runtime_error, load_checkpoint(pathname, std::initializer_list<ICheckpointable *>{&st2, &st3}));
+
+    std::filesystem::remove(pathname);
+
+    test_sim_exchange_resume();
+    test_basic_context_resume();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "check.h"
+#include "../common/fill_archive.h"
+#include "../common/memory_storage.h"
+
+#include <cmath>
+#include <filesystem>
+#include <random>
+
+using namespace trading_api;
+
+static bool same(const Fills &a, const Fills &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Fill &x, const Fill &y) {
+        return x.id == y.id && x.time == y.time && x.label == y.label
+                && x.price == y.price && x.amount == y.amount && x.fees == y.fees;
+    });
+}
+
+int main() {
+    std::mt19937 rnd(7);
+    const char *labels[] = {"btc.spot", "btc.perp", "eth", "sol.grid"};
+    MemoryStorage st;
+    FillArchiveWriter wr(1000);
+    auto t = Timestamp(std::chrono::seconds(1700000000));
+    double price = 30000;
+    for (int i = 0; i < 10000; ++i) {
+        Fill f;
+        t += std::chrono::milliseconds(rnd() % 5000);
+        f.time = t;
+        f.id = std::to_string(8000000000LL + i * 3);
+        f.label = labels[rnd() % 4];
+        price += (static_cast<int>(rnd() % 21) - 10) * 0.5;
+        f.price = price;
+        //exchanges report decimal numbers
+        f.amount = (rnd() % 2?1.0:-1.0) * static_cast<double>(1 + rnd() % 10) / 1000.0;
+        f.fees = std::round(std::abs(f.amount) * f.price * 0.0002 * 1e8) / 1e8;
+        st.put_fill(f);
+        wr.append(f);
+    }
+    FillArchive ar(wr.finish());
+    CHECK_EQUAL(ar.size(), 10000U);
+    CHECK_LESS(ar.get_data_size() * 10, 10000 * sizeof(Fill));
+
+    int mismatch = 0;
+    for (std::string_view filter: {"", "btc", "eth", "sol.grid", "x"}) {
+        for (std::size_t limit: {0, 1, 100, 5000, 20000}) {
+            mismatch += !same(ar.load_fills(limit, filter), st.load_fills(limit, filter));
+        }
+        for (auto tp: {Timestamp::min(), t - std::chrono::hours(2), t}) {
+            mismatch += !same(ar.load_fills(tp, filter), st.load_fills(tp, filter));
+            Fills streamed;
+            Function<void(const Fill &)> fn = [&](const Fill &f) {streamed.push_back(f);};
+            ar.enum_fills(tp, filter, fn);
+            mismatch += !same(streamed, st.load_fills(tp, filter));
+        }
+    }
+    CHECK_EQUAL(mismatch, 0);
+
+    //column scan
+    double volume = 0;
+    std::size_t rows = 0;
+    Function<void(const FillArchive::Columns &)> fn = [&](const FillArchive::Columns &c) {
+        for (std::size_t i = 0; i < c.size(); ++i) volume += c.price[i] * std::abs(c.amount[i]);
+        rows += c.size();
+    };
+    ar.scan(Timestamp::min(), fn);
+    double expected = 0;
+    for (const Fill &f: st.load_fills(std::size_t(20000), {})) expected += f.price * std::abs(f.amount);
+    CHECK_EQUAL(rows, 10000U);
+    CHECK_LESS(std::abs(volume - expected), 1e-6);
+
+    //file
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_fill_archive.far").string();
+    FillArchiveWriter fw;
+    for (const Fill &f: st.load_fills(std::size_t(100), {})) fw.append(f);
+    fw.save(pathname);
+    {
+        FillArchive far = FillArchive::open(pathname);
+        FillArchive moved = std::move(far);
+        CHECK_EQUAL(moved.size(), 100U);
+        CHECK_EQUAL(moved.load_fills(std::size_t(1), {})[0].id, st.load_fills(std::size_t(100), {}).back().id);
+    }
+    std::filesystem::remove(pathname);
+
+    //ids which are not numbers, not decimal values
+    FillArchiveWriter tw(3);
+    Fills text;
+    for (int i = 0; i < 10; ++i) {
+        Fill f = {};
+        f.time = t + std::chrono::nanoseconds(i * 7);
+        f.id = i == 5?"0012":"trade-" + std::to_string(i);
+        f.label = "lbl";
+        f.price = 1.0 / (i + 3);
+        f.amount = i == 4?-0.0:1e-12 * i;
+        //block with decimal fees contains negative zero
+        f.fees = i == 6?-0.0:0.0;
+        tw.append(f);
+        text.insert(text.begin(), f);
+    }
+    FillArchive tar(tw.finish());
+    CHECK(same(tar.load_fills(std::size_t(100), {}), text));
+    CHECK(std::signbit(tar.load_fills(std::size_t(100), {})[5].amount));
+    CHECK(std::signbit(tar.load_fills(std::size_t(100), {})[3].fees));
+    CHECK(!std::signbit(tar.load_fills(std::size_t(100), {})[2].fees));
+    CHECK_EXCEPTION(std::runtime_error, FillArchive("not an archive"));
+}
@@ -0,0 +1,74 @@
+#include "check.h"
+#include "../common/last_value_cache.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace trading_api;
+
+//measures latency of readers and writer while they contend on the same slot
+
+int main() {
+
+    LastValueCache cache;
+    Instrument i1(std::make_shared<IInstrument::Null>());
+    Instrument i2(std::make_shared<IInstrument::Null>());
+    Ticker tk;
+    OrderBook ob;
+    CHECK(!cache.get(i1, tk));
+    CHECK(!cache.get(i1, ob));
+    cache.put(i1, Ticker{1,2,3,4,5,6,7});
+    CHECK(cache.get(i1, tk));
+    CHECK_EQUAL(tk.last, 5.0);
+    CHECK(!cache.get(i2, tk));
+
+    constexpr int writes = 200000;
+    constexpr int readers = 3;
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::vector<std::thread> thrs;
+    std::vector<double> read_ns(readers);
+
+    for (int r = 0; r < readers; ++r) {
+        thrs.emplace_back([&, r]{
+            Ticker t;
+            OrderBook b;
+            std::size_t cnt = 0;
+            auto start = std::chrono::steady_clock::now();
+            while (!done.load(std::memory_order_relaxed)) {
+                if (cache.get(i2, t)) {
+                    if (t.bid != t.ask || t.bid != t.last || t.bid != t.index) ++torn;
+                }
+                cache.get(i2, b);
+                ++cnt;
+            }
+            auto dur = std::chrono::steady_clock::now() - start;
+            read_ns[r] = std::chrono::duration<double, std::nano>(dur).count() / std::max<std::size_t>(cnt,1);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < writes; ++n) {
+        double v = n;
+        cache.put(i2, Ticker{v, v, v, v, v, v, v});
+        if ((n & 63) == 0) {
+            OrderBook b;
+            b.update_bid(v, 1.0);
+            cache.put(i2, b);
+        }
+    }
+    auto write_dur = std::chrono::steady_clock::now() - start;
+    done = true;
+    for (auto &t: thrs) t.join();
+
+    std::cout << "write latency: " << std::chrono::duration<double, std::nano>(write_dur).count() / writes << " ns" << std::endl;
+    for (int r = 0; r < readers; ++r) {
+        std::cout << "reader " << r << " latency: " << read_ns[r] << " ns" << std::endl;
+    }
+    CHECK_EQUAL(torn.load(), 0);
+    CHECK(cache.get(i2, tk));
+    CHECK_EQUAL(tk.bid, writes - 1.0);
+    return 0;
+}
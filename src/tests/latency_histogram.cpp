@@ -0,0 +1,52 @@
+#include "check.h"
+#include "../common/latency_histogram.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace trading_api;
+
+int main() {
+
+    //bucket boundaries are continuous and error is bounded
+    int mismatch = 0;
+    for (unsigned int i = 1; i < LatencyHistogram::bucket_count; ++i) {
+        std::uint64_t low = LatencyHistogram::bucket_high(i-1) + 1;
+        mismatch += LatencyHistogram::bucket_index(low) != i;
+        mismatch += LatencyHistogram::bucket_index(LatencyHistogram::bucket_high(i)) != i;
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK_EQUAL(LatencyHistogram::bucket_index(~std::uint64_t(0)), LatencyHistogram::bucket_count - 1);
+
+    LatencyHistogram h;
+    CHECK_EQUAL(h.percentile(50), 0U);
+    for (std::uint64_t v = 1; v <= 50; ++v) h.record(v);
+    CHECK_EQUAL(h.percentile(50), 25U);
+    CHECK_EQUAL(h.percentile(100), 50U);
+    CHECK_EQUAL(h.min(), 1U);
+    CHECK_EQUAL(h.mean(), 25.5);
+
+    //compare with exact percentiles of random (log-normal) sample
+    std::mt19937 rnd(1);
+    std::lognormal_distribution<double> dist(8.0, 1.5);
+    std::vector<std::uint64_t> sample;
+    LatencyHistogram h1, h2;
+    for (int i = 0; i < 100000; ++i) {
+        auto v = static_cast<std::uint64_t>(dist(rnd));
+        sample.push_back(v);
+        (i & 1?h1:h2).record(v);
+    }
+    h1.merge(h2);
+    CHECK_EQUAL(h1.count(), sample.size());
+    std::sort(sample.begin(), sample.end());
+    for (double p: {1.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+        auto rank = static_cast<std::size_t>(p * static_cast<double>(sample.size()) / 100.0 + 0.5);
+        std::uint64_t exact = sample[std::max<std::size_t>(rank, 1) - 1];
+        std::uint64_t approx = h1.percentile(p);
+        mismatch += approx < exact || static_cast<double>(approx - exact) > static_cast<double>(exact) / 32.0 + 1;
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK_EQUAL(h1.max(), sample.back());
+
+}
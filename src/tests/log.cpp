@@ -0,0 +1,69 @@
+#include "check.h"
+#include "../trading_ifc/log.h"
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace trading_api;
+
+class LastLine: public ILog {
+public:
+    virtual void output(Serverity, std::string_view msg) override {
+        line = msg;
+    }
+    virtual Serverity get_min_level() const override {return Serverity::debug;}
+    std::string line;
+};
+
+int main() {
+    auto target = std::make_shared<LastLine>();
+    Log log(target);
+    auto out = [&] {return target->line;};
+    const auto info = Log::Serverity::info;
+
+    log.output(info, "a {} b {}", 1, 2);
+    CHECK_EQUAL(out(), "a 1 b 2");
+    log.output(info, "{2} {1}", "x", "y");
+    CHECK_EQUAL(out(), "y x");
+    //{} skips arguments referred by index
+    log.output(info, "{2} {} {}", "a", "b", "c");
+    CHECK_EQUAL(out(), "b a c");
+    log.output(info, "{{}} {} }", 5);
+    CHECK_EQUAL(out(), "{} 5 }");
+    log.output(info, "no arguments");
+    CHECK_EQUAL(out(), "no arguments");
+
+    //numbers
+    log.output(info, "{} {} {} {} {}", -42, 1.5, 0.1, 100.25f, std::numeric_limits<std::uint64_t>::max());
+    CHECK_EQUAL(out(), "-42 1.5 0.1 100.25 18446744073709551615");
+    log.output(info, "{}{}{}", 'c', true, false);
+    CHECK_EQUAL(out(), "c10");
+
+    //strings, containers, pairs, invocables
+    std::string s = "str";
+    std::vector<int> v = {1,2,3};
+    std::map<std::string, double> m = {{"a", 0.5}};
+    log.output(info, "{} {} {} {} {}", s, std::string_view("view"), v, m, [&]{return s.size();});
+    CHECK_EQUAL(out(), "str view (1,2,3) (<a:0.5>) 3");
+
+    //context
+    Log ctx(Log(log, "ctx{}", 1), "{}", "sub");
+    ctx.output(info, "line {}", 2);
+    CHECK_EQUAL(out(), "[ctx1][sub]line 2");
+
+    //level below minimum
+    log.output(Log::Serverity::trace, "filtered");
+    CHECK_EQUAL(out(), "[ctx1][sub]line 2");
+
+    //runtime pattern, invalid placeholders are written as they are
+    std::string pattern = "{} {5} {x} {";
+    log.output(info, Log::runtime_pattern(pattern), 1);
+    CHECK_EQUAL(out(), "1 {5} {x} {");
+    std::string many;
+    for (int i = 0; i < 40; ++i) many.append("{}");
+    log.output(info, Log::runtime_pattern(many), 1, 2, 3);
+    CHECK_EQUAL(out(), "123" + many.substr(6));
+}
@@ -0,0 +1,50 @@
+#include "../common/loser_tree.h"
+#include "check.h"
+
+#include <algorithm>
+#include <limits>
+
+int main() {
+
+    //merge 5 sorted streams
+    std::vector<std::vector<int> > streams = {
+            {1,4,7,10},
+            {2,5,8},
+            {},
+            {3,6,9,12,15},
+            {0,4,4,20}
+    };
+    std::vector<std::size_t> pos(streams.size(),0);
+    auto key = [&](std::size_t idx) {
+        return pos[idx] < streams[idx].size()?streams[idx][pos[idx]]:std::numeric_limits<int>::max();
+    };
+
+    trading_api::LoserTree<int> tree;
+    std::vector<int> keys;
+    for (std::size_t i = 0; i < streams.size(); ++i) keys.push_back(key(i));
+    tree.build(keys);
+
+    std::vector<int> result;
+    std::vector<std::size_t> sources;
+    while (tree.top() != std::numeric_limits<int>::max()) {
+        auto w = tree.winner();
+        result.push_back(tree.top());
+        sources.push_back(w);
+        ++pos[w];
+        tree.replace_top(key(w));
+    }
+
+    CHECK_EQUAL(result.size(), 16U);
+    CHECK(std::is_sorted(result.begin(), result.end()));
+    //ties are resolved by stream index
+    auto f = std::find(result.begin(), result.end(), 4) - result.begin();
+    CHECK_EQUAL(sources[f], 0U);
+    CHECK_EQUAL(sources[f+1], 4U);
+    CHECK_EQUAL(sources[f+2], 4U);
+
+    trading_api::LoserTree<int> single;
+    single.build({42});
+    CHECK_EQUAL(single.winner(), 0U);
+    single.replace_top(43);
+    CHECK_EQUAL(single.top(), 43);
+}
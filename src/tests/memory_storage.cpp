@@ -0,0 +1,176 @@
+#include "check.h"
+#include "../common/memory_storage.h"
+#include "../common/wal_storage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+using namespace trading_api;
+
+static std::size_t alloc_count = 0;
+
+void *operator new(std::size_t sz) {
+    ++alloc_count;
+    if (void *p = std::malloc(sz?sz:1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {std::free(p);}
+void operator delete(void *p, std::size_t) noexcept {std::free(p);}
+
+static Fill make_fill(int n, int sec) {
+    Fill f = {};
+    f.time = Timestamp(std::chrono::seconds(sec));
+    f.id = "fill" + std::to_string(n);
+    f.label = "lbl";
+    f.price = 100.0 + n;
+    f.amount = 1.0;
+    return f;
+}
+
+///reference implementation - all fills newer than limit matching filter, newest first
+static Fills reference(const std::vector<Fill> &all, Timestamp limit, std::string_view filter) {
+    Fills out;
+    for (const Fill &f: all) {
+        if (f.time > limit && std::string_view(f.label).substr(0, filter.size()) == filter) out.push_back(f);
+    }
+    std::stable_sort(out.begin(), out.end(), [](const Fill &a, const Fill &b) {return a.time < b.time;});
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+static bool same_ids(const Fills &a, const Fills &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Fill &x, const Fill &y) {
+        return x.id == y.id;
+    });
+}
+
+static void test_fill_queries() {
+    MemoryStorage st;
+    std::vector<Fill> all;
+    const char *labels[] = {"btc.spot", "btc.perp", "eth", "btc", "bt"};
+    for (int i = 0; i < 500; ++i) {
+        //mostly ordered, some fills arrive late, some have equal time
+        int sec = i % 17 == 0?i - 30:i - (i % 3 == 0);
+        Fill f = make_fill(i, 1000 + sec);
+        f.label = labels[(i * 7) % 5];
+        st.put_fill(f);
+        all.push_back(f);
+    }
+    int mismatch = 0;
+    for (std::string_view filter: {"", "btc", "btc.", "btc.perp", "eth", "x", "b"}) {
+        for (std::size_t limit: {0, 1, 10, 1000}) {
+            Fills r = reference(all, Timestamp::min(), filter);
+            if (r.size() > limit) r.resize(limit);
+            mismatch += !same_ids(st.load_fills(limit, filter), r);
+            Fills streamed;
+            Function<void(const Fill &)> fn = [&](const Fill &f) {streamed.push_back(f);};
+            st.enum_fills(limit, filter, fn);
+            mismatch += !same_ids(streamed, r);
+        }
+        for (int sec: {0, 1200, 1400, 1499, 2000}) {
+            Timestamp tp{std::chrono::seconds(sec)};
+            Fills r = reference(all, tp, filter);
+            mismatch += !same_ids(st.load_fills(tp, filter), r);
+            Fills streamed;
+            Function<void(const Fill &)> fn = [&](const Fill &f) {streamed.push_back(f);};
+            st.enum_fills(tp, filter, fn);
+            mismatch += !same_ids(streamed, r);
+        }
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK_EQUAL(st.load_fills(std::size_t(1000), "btc.").size(), 200U);
+}
+
+static void test_transaction_allocations() {
+    MemoryStorage st;
+    char buff[32];
+    auto tick = [&](int i) {
+        st.begin_transaction();
+        std::snprintf(buff, sizeof(buff), "%10d", i);
+        st.put_var("strategy.position", buff);
+        st.put_var("strategy.last_price", buff);
+        st.put_var("strategy.grid.level.0001", buff);
+        st.commit();
+    };
+    //first transactions allocate the buffer and the variables
+    for (int i = 0; i < 10; ++i) tick(i);
+    std::size_t before = alloc_count;
+    for (int i = 0; i < 1000; ++i) tick(i);
+    CHECK_EQUAL(alloc_count - before, 0U);
+    CHECK_EQUAL(st.get_var("strategy.position"), "       999");
+    //rolled back transaction is discarded
+    st.begin_transaction();
+    st.put_var("strategy.position", "x");
+    st.rollback();
+    CHECK_EQUAL(st.get_var("strategy.position"), "       999");
+}
+
+int main() {
+    test_fill_queries();
+    test_transaction_allocations();
+
+    MemoryStorage st(std::chrono::seconds(100));
+    for (int i = 0; i < 1000; ++i) st.put_fill(make_fill(i, 1000 + i));
+    //fill arrived late, it is still indexed
+    st.put_fill(make_fill(5000, 10));
+
+    //fills with equal timestamps are detected
+    CHECK(st.is_duplicate_fill(make_fill(999, 1999)));
+    CHECK(st.is_duplicate_fill(make_fill(950, 1950)));
+    CHECK(st.is_duplicate_fill(make_fill(5000, 10)));
+    //outside of window - linear search
+    CHECK(st.is_duplicate_fill(make_fill(3, 1003)));
+    CHECK(!st.is_duplicate_fill(make_fill(3, 1004)));
+    CHECK(!st.is_duplicate_fill(make_fill(1000, 2000)));
+    CHECK(!st.is_duplicate_fill(make_fill(1000, 500)));
+
+    //uncommitted fill is not duplicate, committed is
+    st.begin_transaction();
+    st.put_fill(make_fill(1000, 2000));
+    CHECK(!st.is_duplicate_fill(make_fill(1000, 2000)));
+    st.commit();
+    CHECK(st.is_duplicate_fill(make_fill(1000, 2000)));
+
+    //the same id with different time is a different fill, both are indexed
+    st.put_fill(make_fill(7777, 1950));
+    st.put_fill(make_fill(7777, 1960));
+    CHECK(st.is_duplicate_fill(make_fill(7777, 1950)));
+    CHECK(st.is_duplicate_fill(make_fill(7777, 1960)));
+    CHECK(!st.is_duplicate_fill(make_fill(7777, 1970)));
+
+    //index is rebuilt after load_state
+    {
+        BinaryWriter wr;
+        st.save_state(wr);
+        MemoryStorage st2(std::chrono::seconds(10));
+        BinaryReader rd(wr.get_data());
+        st2.load_state(rd);
+        int mismatch = 0;
+        for (int i = 0; i <= 1000; ++i) {
+            mismatch += !st2.is_duplicate_fill(make_fill(i, 1000 + i));
+            mismatch += st2.is_duplicate_fill(make_fill(i, 999 + i));
+        }
+        CHECK_EQUAL(mismatch, 0);
+        CHECK(st2.is_duplicate_fill(make_fill(5000, 10)));
+    }
+
+    //durable storage rebuilds the index during recovery
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_memory_storage.log").string();
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+    {
+        WalStorage wal(pathname);
+        for (int i = 0; i < 100; ++i) wal.put_fill(make_fill(i, 1000 + i));
+    }
+    {
+        WalStorage wal(pathname, {.fill_window = std::chrono::seconds(10)});
+        CHECK(wal.is_duplicate_fill(make_fill(99, 1099)));
+        CHECK(wal.is_duplicate_fill(make_fill(0, 1000)));
+        CHECK(!wal.is_duplicate_fill(make_fill(100, 1100)));
+    }
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(pathname + ".idx");
+}
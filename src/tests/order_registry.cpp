@@ -0,0 +1,85 @@
+#include "check.h"
+#include "../common/order_registry.h"
+#include "../common/basic_order.h"
+
+#include <map>
+#include <random>
+
+using namespace trading_api;
+
+int main() {
+
+    Instrument i(std::make_shared<IInstrument::Null>());
+    Account a(std::make_shared<IAccount::Null>());
+
+    OrderRegistry reg;
+    std::map<Order, std::string> ref;
+    std::vector<Order> orders;
+    std::mt19937 rnd(1);
+    int mismatch = 0;
+    IEventTarget *target = nullptr;
+
+    //random inserts and erases, compared with std::map
+    for (int n = 0; n < 20000; ++n) {
+        if (orders.empty() || rnd() % 3) {
+            Order o(std::make_shared<BasicOrder>(i, a, Order::Setup{}, Order::Origin::strategy));
+            auto [e, inserted] = reg.emplace(o, target);
+            mismatch += !inserted;
+            std::string id = "id" + std::to_string(n);
+            reg.set_id(e, id);
+            ref.emplace(o, id);
+            orders.push_back(o);
+        } else {
+            auto pos = rnd() % orders.size();
+            Order o = orders[pos];
+            orders[pos] = orders.back();
+            orders.pop_back();
+            mismatch += !reg.erase(o);
+            ref.erase(o);
+        }
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK_EQUAL(reg.size(), ref.size());
+    for (const auto &[o, id]: ref) {
+        auto e = reg.find(o);
+        mismatch += !e || e->order != o || e->id != id;
+        mismatch += reg.find(id) != e;
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK(reg.find(std::string_view("id-unknown")) == nullptr);
+
+    //rebinding the id moves it to other order
+    auto e1 = reg.find(orders[0]);
+    auto e2 = reg.find(orders[1]);
+    std::string id = e1->id;
+    reg.set_id(e2, id);
+    CHECK(reg.find(id) == e2);
+    CHECK(e1->id.empty());
+
+    //alias index
+    std::vector<Order> aliases;
+    for (std::size_t n = 0; n < 100; ++n) {
+        aliases.push_back(Order(std::make_shared<BasicOrder>(i, a, Order::Setup{}, Order::Origin::strategy)));
+        reg.set_alias(reg.find(orders[n]), aliases.back());
+    }
+    for (std::size_t n = 0; n < 100; ++n) {
+        auto e = reg.find_alias(aliases[n]);
+        mismatch += !e || e->order != orders[n] || e->alias != aliases[n];
+    }
+    CHECK_EQUAL(mismatch, 0);
+    CHECK(reg.find_alias(orders[0]) == nullptr);
+    //erased entry is removed from the alias index
+    reg.erase(orders[5]);
+    CHECK(reg.find_alias(aliases[5]) == nullptr);
+    CHECK(reg.find_alias(aliases[6]) == reg.find(orders[6]));
+    //rebinding the alias moves it to other order
+    reg.set_alias(reg.find(orders[7]), aliases[8]);
+    CHECK(reg.find_alias(aliases[8]) == reg.find(orders[7]));
+    CHECK(reg.find_alias(aliases[7]) == nullptr);
+    CHECK(!reg.find(orders[8])->alias);
+
+    reg.erase_if([](const OrderRegistry::Entry &){return true;});
+    CHECK(reg.find_alias(aliases[8]) == nullptr);
+    CHECK(reg.empty());
+    CHECK(reg.find(id) == nullptr);
+}
@@ -0,0 +1,77 @@
+#include "check.h"
+#include "../common/order_throttle.h"
+#include "../common/basic_order.h"
+
+using namespace trading_api;
+
+int main() {
+
+    Instrument i(std::make_shared<IInstrument::Null>());
+    Account a(std::make_shared<IAccount::Null>());
+    auto make = [&](Side side = Side::buy){
+        return Order(std::make_shared<BasicOrder>(i, a, Order::Limit(side, 1, 100), Order::Origin::strategy));
+    };
+    auto make_replace = [&](const Order &o){
+        return Order(std::make_shared<BasicOrder>(o, Order::Setup{}, false, Order::Origin::strategy));
+    };
+
+    Timestamp t0 = Timestamp::clock::now();
+    OrderThrottle thr;
+    OrderThrottle::Result res;
+    thr.set_config({10.0, 2.0});
+
+    //burst of 2 is sent, third is deferred for 100ms
+    Order o1 = make(), o2 = make(), o3 = make();
+    thr.place({o1, {}, false});
+    thr.place({o2, {}, false});
+    thr.place({o3, {}, false});
+    thr.dispatch(t0, res);
+    CHECK_EQUAL(res.send.size(), 2U);
+    CHECK(res.next == t0 + std::chrono::milliseconds(100));
+    CHECK_EQUAL(thr.get_stats().deferred, 1U);
+
+    //o3 has not been sent - replace supersedes it, cancel removes the replace
+    Order o4 = make_replace(o3);
+    thr.place({o4, o3, false});
+    CHECK_EQUAL(thr.get_stats().superseded, 1U);
+    thr.cancel(o4);
+    thr.dispatch(t0 + std::chrono::milliseconds(50), res);
+    CHECK(res.send.empty());
+    CHECK_EQUAL(res.dropped.size(), 2U);
+    CHECK(thr.empty());
+
+    //cancel+place is merged into replace of the canceled order
+    Order o5 = make();
+    thr.cancel(o1);
+    thr.cancel(o1);
+    thr.place({o5, {}, false});
+    CHECK_EQUAL(thr.get_stats().duplicate_cancels, 1U);
+    CHECK_EQUAL(thr.get_stats().merged, 1U);
+    thr.dispatch(t0 + std::chrono::milliseconds(60), res);
+    CHECK(res.send.empty());
+    thr.dispatch(t0 + std::chrono::milliseconds(100), res);
+    CHECK_EQUAL(res.send.size(), 1U);
+    CHECK(res.send[0].order == o5);
+    CHECK(res.send[0].replaces == o1);
+    CHECK(res.send[0].rewritten);
+    CHECK(res.next == Timestamp::max());
+
+    //new order on the other side is not merged with the cancel
+    Order o6 = make(Side::sell);
+    thr.cancel(o5);
+    thr.place({o6, {}, false});
+    CHECK_EQUAL(thr.get_stats().merged, 1U);
+    thr.dispatch(t0 + std::chrono::milliseconds(400), res);
+    CHECK_EQUAL(res.send.size(), 2U);
+    CHECK(res.send[0].cancel && res.send[0].order == o5);
+    CHECK(res.send[1].order == o6 && !res.send[1].replaces);
+
+    //disabled throttle passes everything
+    thr.set_config({});
+    thr.cancel(o2);
+    thr.place({make(), {}, false});
+    thr.dispatch(t0 + std::chrono::milliseconds(100), res);
+    CHECK_EQUAL(res.send.size(), 1U);
+    CHECK(res.send[0].rewritten);
+    CHECK_EQUAL(thr.get_stats().sent, 6U);
+}
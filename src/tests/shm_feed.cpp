@@ -0,0 +1,85 @@
+#include "check.h"
+#include "../shm_feed/shm_feed.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace trading_api;
+
+static shm_feed::Record make_record(int n) {
+    shm_feed::Record rec;
+    rec.time_ns = n;
+    rec.instrument = static_cast<std::uint32_t>(n % 3);
+    rec.kind = shm_feed::Kind::bid_update;
+    rec.fields[0] = 100 + n;
+    rec.fields[1] = n;
+    return rec;
+}
+
+///Map slots of the feed to simulate writer in the middle of write
+static shm_feed::Slot *map_slots(const std::string &name, std::size_t capacity, void *&map, std::size_t &size) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    size = sizeof(shm_feed::Header) + capacity * sizeof(shm_feed::Slot);
+    map = ::mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    return reinterpret_cast<shm_feed::Slot *>(reinterpret_cast<char *>(map) + sizeof(shm_feed::Header));
+}
+
+int main() {
+    std::string name = "/trading_api_test_feed_" + std::to_string(::getpid());
+    constexpr std::size_t capacity = 8;
+    ShmFeedWriter writer(name, capacity);
+    CHECK_EQUAL(writer.instrument_index("BTCUSD"), 0U);
+    CHECK_EQUAL(writer.instrument_index("ETHUSD"), 1U);
+    CHECK_EQUAL(writer.instrument_index("BTCUSD"), 0U);
+
+    ShmFeedReader reader(name);
+    CHECK_EQUAL(reader.get_instrument(1), "ETHUSD");
+    CHECK_EQUAL(reader.get_instrument(2), "");
+
+    shm_feed::Record rec;
+    CHECK(!reader.read(rec));
+
+    //records are read in order
+    for (int n = 0; n < 3; ++n) writer.write(make_record(n));
+    bool ok = true;
+    for (int n = 0; n < 3; ++n) {
+        ok = ok && reader.read(rec) && rec.time_ns == n && rec.instrument == static_cast<std::uint32_t>(n % 3)
+                && rec.kind == shm_feed::Kind::bid_update && rec.fields[0] == 100 + n;
+    }
+    CHECK(ok);
+    CHECK(!reader.read(rec));
+    CHECK_EQUAL(reader.get_lost(), 0U);
+
+    //slot which is being written (odd sequence) is not read and it is not lost
+    void *map;
+    std::size_t map_size;
+    shm_feed::Slot *slots = map_slots(name, capacity, map, map_size);
+    slots[3].seq.store(2 * 3 + 1);
+    CHECK(!reader.read(rec));
+    CHECK_EQUAL(reader.get_lost(), 0U);
+    ::munmap(map, map_size);
+    writer.write(make_record(3));
+    CHECK(reader.read(rec));
+    CHECK_EQUAL(rec.time_ns, 3);
+
+    //writer overwrites whole ring, reader skips to live position
+    for (int n = 4; n < 24; ++n) writer.write(make_record(n));
+    CHECK(!reader.read(rec));
+    CHECK_EQUAL(reader.get_lost(), 20U);
+    CHECK(!reader.read(rec));
+    writer.write(make_record(24));
+    CHECK(reader.read(rec));
+    CHECK_EQUAL(rec.time_ns, 24);
+    CHECK_EQUAL(reader.get_lost(), 20U);
+
+    //new reader starts at live position
+    ShmFeedReader reader2(name);
+    CHECK(!reader2.read(rec));
+    writer.write(make_record(25));
+    CHECK(reader2.read(rec));
+    CHECK_EQUAL(rec.time_ns, 25);
+
+    ShmFeedWriter::remove(name);
+}
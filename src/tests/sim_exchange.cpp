@@ -0,0 +1,198 @@
+#include "check.h"
+#include "../simulator/sim_exchange.h"
+#include "../common/context_scheduler.h"
+
+#include <filesystem>
+#include <sstream>
+
+using namespace trading_api;
+
+class TestInstrument: public IInstrument::Null {
+public:
+    TestInstrument(std::string id):_id(std::move(id)) {}
+    virtual std::string get_id() const override {return _id;}
+protected:
+    std::string _id;
+};
+
+///Records market data events received from the exchange
+class Recorder: public IExchangeContext::Null {
+public:
+    Recorder(ManualContextScheduler &sch):_sch(sch) {}
+    virtual void income_data(const Instrument &i, const Ticker &tk) override {
+        std::ostringstream s;
+        s << stamp() << " " << i.get_id() << " T " << tk.bid << " " << tk.ask;
+        events.push_back(s.str());
+        if (on_ticker) on_ticker(i, tk);
+    }
+    virtual void income_data(const Instrument &i, const OrderBook &) override {
+        events.push_back(std::to_string(stamp()) + " " + i.get_id() + " B");
+    }
+    virtual void income_data(const Instrument &i, std::span<const OrderBook::Update> up, bool) override {
+        for (const auto &u: up) {
+            std::ostringstream s;
+            s << stamp() << " " << i.get_id() << " U " << static_cast<int>(u.side) << " " << u.level << " " << u.amount;
+            events.push_back(s.str());
+        }
+    }
+    std::vector<std::string> events;
+    std::function<void(const Instrument &, const Ticker &)> on_ticker;
+protected:
+    ManualContextScheduler &_sch;
+    long long stamp() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(_sch.get_time().time_since_epoch()).count();
+    }
+};
+
+static SimExchange::GlobalScheduler make_scheduler(ManualContextScheduler &sch) {
+    return [sch](Timestamp tp, std::function<void(Timestamp)> fn, const void *ident) mutable {
+        sch(tp, std::move(fn), ident);
+    };
+}
+
+static Timestamp at(int ms) {
+    return Timestamp(std::chrono::milliseconds(ms));
+}
+
+static void run(ManualContextScheduler &sch) {
+    while (sch.advance());
+}
+
+static void test_tick_store(const Instrument &btc, const Instrument &eth) {
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_sim_exchange.bin").string();
+    {
+        TickStoreWriter wr(pathname);
+        wr.add(at(10), "BTCUSD", Ticker{1, 0, 2, 0, 0, 0, 0});
+        wr.add(at(20), "XRPUSD", Ticker{9, 0, 9, 0, 0, 0, 0});
+        wr.add(at(20), "ETHUSD", OrderBook::Update{Side::buy, 50, 3});
+        wr.add(at(40), "BTCUSD", Ticker{3, 0, 4, 0, 0, 0, 0});
+    }
+    auto store = std::make_shared<MappedTickStore>(pathname);
+
+    auto sch = create_scheduler_manual();
+    Recorder rec(sch);
+    SimExchange ex(make_scheduler(sch), {{}, {btc, eth}, {}});
+    ex.init(ExchangeContext(&rec), {});
+    ex.subscribe(SubscriptionType::ticker, btc);
+    ex.subscribe(SubscriptionType::orderbook, eth);
+    ex.add_records(store);
+    ex.add_record(at(30), eth, Ticker{5, 0, 6, 0, 0, 0, 0});
+    run(sch);
+
+    //unknown instrument XRPUSD is skipped, ETHUSD ticker is not subscribed
+    std::vector<std::string> expected = {
+        "10 BTCUSD T 1 2",
+        "20 ETHUSD U 1 50 3",
+        "40 BTCUSD T 3 4",
+    };
+    CHECK(rec.events == expected);
+    std::filesystem::remove(pathname);
+}
+
+static void test_reentrant_add(const Instrument &btc) {
+    auto sch = create_scheduler_manual();
+    Recorder rec(sch);
+    SimExchange ex(make_scheduler(sch), {{}, {btc}, {}});
+    ex.init(ExchangeContext(&rec), {});
+    ex.subscribe(SubscriptionType::ticker, btc);
+    int t = 20;
+    ex.add_source(std::make_unique<GeneratorSource>([&](SimRecord &r){
+        if (t > 30) return false;
+        r = {at(t), btc, Ticker{1.0*t, 0, 0, 0, 0, 0, 0}};
+        t += 10;
+        return true;
+    }));
+    ex.add_record(at(50), btc, Ticker{50, 0, 0, 0, 0, 0, 0});
+    //the strategy reacts to the record by adding an earlier record
+    rec.on_ticker = [&](const Instrument &i, const Ticker &tk) {
+        if (tk.bid == 20) ex.add_record(at(15), i, Ticker{15, 0, 0, 0, 0, 0, 0});
+    };
+    run(sch);
+
+    std::vector<std::string> expected = {
+        "20 BTCUSD T 20 0",
+        "20 BTCUSD T 15 0",
+        "30 BTCUSD T 30 0",
+        "50 BTCUSD T 50 0",
+    };
+    CHECK(rec.events == expected);
+}
+
+///Fast forward setup: idle instrument has record every second
+struct FastForward {
+    ManualContextScheduler sch = create_scheduler_manual();
+    Recorder rec{sch};
+    SimExchange ex;
+    int steps = 0;
+
+    FastForward(const Instrument &btc, const Instrument &eth)
+        :ex(make_scheduler(sch), {{}, {btc, eth}, [this]{return sch.get_next_event();}, {}}) {
+        ex.init(ExchangeContext(&rec), {});
+        int t = 1;
+        ex.add_source(std::make_unique<GeneratorSource>([=](SimRecord &r) mutable {
+            if (t > 1000) return false;
+            r = {at(t*1000), eth, Ticker{1.0*t, 0, 0, 0, 0, 0, 0}};
+            ++t;
+            return true;
+        }));
+    }
+    void timer(int ms, const char *name) {
+        sch(at(ms), [this, name](Timestamp) {
+            rec.events.push_back(std::to_string(ms_time()) + " " + name);
+        }, name);
+    }
+    void run() {
+        while (sch.advance()) ++steps;
+    }
+    long long ms_time() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(sch.get_time().time_since_epoch()).count();
+    }
+};
+
+static void test_fast_forward(const Instrument &btc, const Instrument &eth) {
+    FastForward ff(btc, eth);
+    ff.ex.subscribe(SubscriptionType::ticker, btc);
+    ff.ex.add_record(at(500500), btc, Ticker{7, 0, 8, 0, 0, 0, 0});
+    ff.timer(300000, "timer2");
+    ff.timer(100000, "timer1");
+    ff.run();
+
+    //idle records are skipped, timers and subscribed records are processed in order
+    std::vector<std::string> expected = {
+        "100000 timer1",
+        "300000 timer2",
+        "500500 BTCUSD T 7 8",
+    };
+    CHECK(ff.rec.events == expected);
+    CHECK_LESS(ff.steps, 10);
+
+    //skipped records still update state of the instrument. Nothing was
+    //scheduled after the last record, so the time stays there
+    ff.ex.subscribe(SubscriptionType::ticker, eth);
+    ff.run();
+    CHECK_EQUAL(ff.rec.events.back(), "500500 ETHUSD T 1000 0");
+}
+
+static void test_fast_forward_orders(const Instrument &btc, const Instrument &eth) {
+    FastForward ff(btc, eth);
+    Account acc(std::make_shared<IAccount::Null>());
+    //the simulator doesn't match orders, pending order is not interest
+    Order orders[] = {ff.ex.create_order(eth, acc, Order::Stop(Side::buy, 1, 500))};
+    ff.ex.batch_place(orders);
+    ff.timer(100000, "timer1");
+    ff.run();
+
+    std::vector<std::string> expected = {"100000 timer1"};
+    CHECK(ff.rec.events == expected);
+    CHECK_LESS(ff.steps, 10);
+}
+
+int main() {
+    Instrument btc(std::make_shared<TestInstrument>("BTCUSD"));
+    Instrument eth(std::make_shared<TestInstrument>("ETHUSD"));
+
+    test_tick_store(btc, eth);
+    test_reentrant_add(btc);
+    test_fast_forward(btc, eth);
+    test_fast_forward_orders(btc, eth);
+}
@@ -0,0 +1,107 @@
+#include "check.h"
+#include "../simulator/simulator_account.h"
+#include "../simulator/sim_exchange.h"
+#include "../common/context_scheduler.h"
+
+#include <cmath>
+#include <random>
+
+using namespace trading_api;
+
+class TestInstrument: public IInstrument::Null {
+public:
+    TestInstrument(std::string id, Type type):_id(std::move(id)) {
+        _cfg.type = type;
+        _cfg.quantum_factor = 0.5;
+        _cfg.tradable = true;
+        _cfg.can_short = true;
+    }
+    virtual const Config &get_config() const override {return _cfg;}
+    virtual std::string get_id() const override {return _id;}
+protected:
+    std::string _id;
+    Config _cfg;
+};
+
+static bool near(double a, double b) {
+    return std::abs(a - b) <= std::max(std::abs(b), 1.0) * 1e-9;
+}
+
+static void test_random_walk(const std::vector<Instrument> &instruments) {
+    SimulAccount acc("acc", "USD", 1e9, 10);
+    std::mt19937 rnd(12345);
+    std::uniform_int_distribution<int> op(0, 9);
+    std::uniform_int_distribution<std::size_t> sel(0, instruments.size()-1);
+    std::uniform_real_distribution<double> price(50, 150);
+    std::uniform_real_distribution<double> amount(0.1, 5);
+
+    bool ok = true;
+    for (int i = 0; i < 10000 && ok; ++i) {
+        const Instrument &instr = instruments[sel(rnd)];
+        switch (op(rnd)) {
+            case 0: case 1: case 2: case 3:
+                acc.update_price(instr, price(rnd));
+                break;
+            case 4: case 5:
+                acc.record_fill(instr, Side::buy, price(rnd), amount(rnd), Order::Behavior::standard);
+                break;
+            case 6: case 7:
+                acc.record_fill(instr, Side::sell, price(rnd), amount(rnd), Order::Behavior::hedge);
+                break;
+            case 8:
+                acc.record_fill(instr, Side::sell, price(rnd), amount(rnd), Order::Behavior::reduce);
+                break;
+            case 9:
+                acc.close_position(instr, SimulAccount::buy_position, price(rnd));
+                break;
+        }
+        ok = near(acc.get_info().blocked, acc.calc_blocked_full());
+    }
+    CHECK(ok);
+    CHECK_NOT_EQUAL(acc.calc_blocked(), 0.0);
+
+    //check after every update
+    acc.set_consistency_check(true);
+    for (int i = 0; i < 100; ++i) {
+        acc.update_price(instruments[sel(rnd)], price(rnd));
+        acc.record_fill(instruments[sel(rnd)], Side::buy, price(rnd), amount(rnd), Order::Behavior::hedge);
+    }
+    CHECK(near(acc.calc_blocked(), acc.calc_blocked_full()));
+}
+
+static void test_sim_exchange(const Instrument &instr) {
+    auto acc = std::make_shared<SimulAccount>("acc", "USD", 1e6, 1);
+    acc->record_fill(instr, Side::buy, 100, 2, Order::Behavior::standard);
+    double blocked = acc->calc_blocked();
+
+    auto sch = create_scheduler_manual();
+    SimExchange::Config cfg;
+    cfg.instruments = {instr};
+    cfg.simul_accounts = {acc};
+    SimExchange ex([sch](Timestamp tp, std::function<void(Timestamp)> fn, const void *ident) mutable {
+        sch(tp, std::move(fn), ident);
+    }, cfg);
+    ex.add_record(Timestamp(std::chrono::seconds(1)), instr, Ticker{0, 0, 0, 0, 110, 0, 0});
+    ex.add_record(Timestamp(std::chrono::seconds(2)), instr, Ticker{0, 0, 0, 0, 105, 0, 0});
+
+    std::vector<Account> found;
+    ex.create_accounts({"acc"}, [&](std::vector<Account> a) {found = std::move(a);});
+    CHECK_EQUAL(found.size(), 1U);
+
+    CHECK(sch.advance());
+    CHECK(near(acc->calc_blocked(), blocked + 20));
+    CHECK(near(acc->calc_blocked(), acc->calc_blocked_full()));
+    CHECK(sch.advance());
+    CHECK(near(acc->calc_blocked(), blocked + 10));
+    CHECK(near(found[0].get_info().blocked, acc->calc_blocked_full()));
+}
+
+int main() {
+    std::vector<Instrument> instruments = {
+        Instrument(std::make_shared<TestInstrument>("A", IInstrument::Type::contract)),
+        Instrument(std::make_shared<TestInstrument>("B", IInstrument::Type::inverted_contract)),
+        Instrument(std::make_shared<TestInstrument>("C", IInstrument::Type::quantum_contract)),
+    };
+    test_random_walk(instruments);
+    test_sim_exchange(instruments[0]);
+}
@@ -0,0 +1,48 @@
+#include "check.h"
+#include "../common/spsc_queue.h"
+
+#include <memory>
+#include <thread>
+
+using namespace trading_api;
+
+int main() {
+
+    SPSCQueue<std::unique_ptr<int> > q(3);
+    CHECK_EQUAL(q.capacity(), 4U);
+    CHECK(q.empty());
+    for (int i = 0; i < 4; ++i) CHECK(q.try_push(std::make_unique<int>(i)));
+    auto extra = std::make_unique<int>(4);
+    CHECK(!q.try_push(std::move(extra)));
+    CHECK(extra != nullptr);
+    std::unique_ptr<int> v;
+    for (int i = 0; i < 4; ++i) {
+        CHECK(q.try_pop(v));
+        CHECK_EQUAL(*v, i);
+    }
+    CHECK(!q.try_pop(v));
+    CHECK(q.empty());
+
+    //producer and consumer in different threads, order must be kept
+    constexpr int count = 1000000;
+    SPSCQueue<int> q2(64);
+    std::thread thr([&]{
+        for (int i = 0; i < count; ++i) {
+            while (!q2.try_push(i)) std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    int mismatch = 0;
+    while (expected < count) {
+        int x;
+        if (q2.try_pop(x)) {
+            mismatch += x != expected;
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    thr.join();
+    CHECK_EQUAL(mismatch, 0);
+    CHECK(q2.empty());
+}
@@ -0,0 +1,90 @@
+#include "check.h"
+#include "../simulator/tick_store.h"
+#include "../simulator/sim_data_source.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace trading_api;
+
+int main() {
+
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_tick_store.bin").string();
+    Timestamp base = std::chrono::system_clock::now();
+
+    {
+        TickStoreWriter wr(pathname);
+        for (int i = 0; i < 1000; ++i) {
+            Timestamp tp = base + std::chrono::milliseconds(i);
+            if (i & 1) {
+                wr.add(tp, "BTCUSD", OrderBook::Update{i & 2?Side::buy:Side::sell, 100.0+i, 1.0*i});
+            } else {
+                wr.add(tp, i % 4?"ETHUSD":"BTCUSD", Ticker{1.0*i, 2.0, 3.0+i, 4.0, 5.0, 6.0, 7.0});
+            }
+        }
+        CHECK_EXCEPTION(std::invalid_argument, wr.add(base, "BTCUSD", Ticker{}));
+    }
+
+    MappedTickStore st(pathname);
+    CHECK_EQUAL(st.size(), 1000U);
+    CHECK_EQUAL(st.get_instruments().size(), 2U);
+    CHECK_EQUAL(st.get_instruments()[0], "BTCUSD");
+    CHECK_EQUAL(st.get_instruments()[1], "ETHUSD");
+    st.prefetch(0, 100);
+
+    bool ok = true;
+    for (std::size_t i = 0; i < st.size(); ++i) {
+        auto tp = std::chrono::time_point_cast<std::chrono::nanoseconds>(base + std::chrono::milliseconds(i));
+        ok = ok && st.get_time(i) == tp;
+        if (i & 1) {
+            auto up = st.get_orderbook_update(i);
+            ok = ok && st.get_instrument_index(i) == 0
+                    && up.side == (i & 2?Side::buy:Side::sell)
+                    && up.level == 100.0+i && up.amount == 1.0*i;
+        } else {
+            auto tk = st.get_ticker(i);
+            ok = ok && st.get_kind(i) == TickStore::Kind::ticker
+                    && st.get_instrument_index(i) == (i % 4?1U:0U)
+                    && tk.bid == 1.0*i && tk.ask == 3.0+i && tk.index == 7.0;
+        }
+    }
+    CHECK(ok);
+
+    auto patch = [&](std::uint64_t offset, const auto &val) {
+        std::fstream f(pathname, std::ios::in|std::ios::out|std::ios::binary);
+        f.seekp(offset);
+        f.write(reinterpret_cast<const char *>(&val), sizeof(val));
+    };
+    TickStore::Header hdr;
+    {
+        std::ifstream f(pathname, std::ios::binary);
+        f.read(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+    }
+    std::vector<Instrument> instruments(2, Instrument(std::make_shared<IInstrument::Null>()));
+
+    //unknown kind
+    patch(hdr.kind_column + 5, std::uint8_t(7));
+    {
+        auto mst = std::make_shared<MappedTickStore>(pathname);
+        CHECK(mst->is_valid(4));
+        CHECK(!mst->is_valid(5));
+        TickStoreSource src(mst, instruments);
+        CHECK_EXCEPTION(std::runtime_error, for (int i = 0; i < 10; ++i) src.next());
+    }
+    patch(hdr.kind_column + 5, std::uint8_t(TickStore::Kind::bid_update));
+
+    //instrument index out of range
+    patch(hdr.index_column + 3*sizeof(std::uint32_t), std::uint32_t(2));
+    {
+        auto mst = std::make_shared<MappedTickStore>(pathname);
+        CHECK(!mst->is_valid(3));
+        TickStoreSource src(mst, instruments);
+        CHECK_EXCEPTION(std::runtime_error, for (int i = 0; i < 10; ++i) src.next());
+    }
+
+    //instrument table doesn't match the count
+    patch(offsetof(TickStore::Header, instrument_count), std::uint32_t(3));
+    CHECK_EXCEPTION(std::runtime_error, MappedTickStore bad(pathname));
+
+    std::filesystem::remove(pathname);
+}
@@ -0,0 +1,80 @@
+#include "check.h"
+#include "../common/var_store.h"
+#include "../common/memory_storage.h"
+
+#include <map>
+#include <random>
+
+using namespace trading_api;
+
+static std::string dump(const std::map<std::string, std::string> &ref, std::string_view start, std::string_view end) {
+    std::string out;
+    for (auto iter = ref.lower_bound(std::string(start)); iter != ref.end() && iter->first <= end; ++iter) {
+        out.append(iter->first).append("=").append(iter->second).append(";");
+    }
+    return out;
+}
+
+int main() {
+    VarStore st;
+    std::map<std::string, std::string> ref;
+    std::mt19937 rnd(1);
+    int mismatch = 0;
+    for (int i = 0; i < 20000; ++i) {
+        std::string key = "strategy.level." + std::to_string(rnd() % 3000);
+        switch (rnd() % 4) {
+            case 0: {
+                bool erased = st.erase(key);
+                mismatch += erased != (ref.erase(key) > 0);
+            } break;
+            default: {
+                std::string val = std::to_string(i);
+                st.put(key, val);
+                ref[key] = val;
+            } break;
+        }
+        auto v = st.get(key);
+        auto r = ref.find(key);
+        mismatch += v.has_value() != (r != ref.end()) || (v && *v != r->second);
+        mismatch += st.size() != ref.size();
+        if (i % 1000 == 0) {
+            std::string start = "strategy.level." + std::to_string(rnd() % 3000);
+            std::string end = "strategy.level." + std::to_string(rnd() % 3000);
+            std::string out;
+            st.range(start, end, [&](std::string_view k, std::string_view v) {
+                out.append(k).append("=").append(v).append(";");
+            });
+            mismatch += out != dump(ref, start, end);
+        }
+    }
+    CHECK_EQUAL(mismatch, 0);
+    st.compact();
+    std::string all;
+    st.for_each([&](std::string_view k, std::string_view v) {
+        all.append(k).append("=").append(v).append(";");
+    });
+    CHECK_EQUAL(all, dump(ref, "", "\xFF"));
+    std::string pfx;
+    st.prefix("strategy.level.29", [&](std::string_view k, std::string_view v) {
+        pfx.append(k).append("=").append(v).append(";");
+    });
+    CHECK_EQUAL(pfx, dump(ref, "strategy.level.29", "strategy.level.29\xFF"));
+    CHECK(!st.contains("strategy"));
+
+    //storage - prefix enumeration and overwrite in transaction
+    MemoryStorage ms;
+    ms.put_var("a.1", "x");
+    ms.put_var("a.2", "y");
+    ms.put_var("b.1", "z");
+    ms.begin_transaction();
+    ms.put_var("a.1", "w");
+    ms.erase_var("a.2");
+    ms.commit();
+    std::string out;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+        out.append(k).append("=").append(v).append(";");
+    };
+    ms.enum_vars("a.", fn);
+    CHECK_EQUAL(out, "a.1=w;");
+    CHECK_EQUAL(ms.get_var("b.1"), "z");
+}
@@ -0,0 +1,245 @@
+#include "check.h"
+#include "../common/wal_storage.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace trading_api;
+
+class TestOrder: public IOrder::Null {
+public:
+    TestOrder(std::string id, State st):_id(std::move(id)),_st(st) {}
+    virtual State get_state() const override {return _st;}
+    virtual SerializedOrder to_binary() const override {return {_id, "content_" + _id};}
+protected:
+    std::string _id;
+    State _st;
+};
+
+static Order make_order(std::string id, Order::State st) {
+    return Order(std::make_shared<TestOrder>(std::move(id), st));
+}
+
+static Fill make_fill(int n) {
+    Fill f = {};
+    f.time = Timestamp(std::chrono::seconds(1000 + n));
+    f.id = "fill" + std::to_string(n);
+    f.label = "lbl";
+    f.price = 100.0 + n;
+    f.amount = 1.0;
+    f.fees = 0.01;
+    return f;
+}
+
+static std::size_t count_vars(const IStorage &st) {
+    std::size_t cnt = 0;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view, std::string_view) {++cnt;};
+    st.enum_vars("", "\xFF", fn);
+    return cnt;
+}
+
+static std::string dump_vars(const IStorage &st) {
+    std::string out;
+    Function<void(std::string_view,std::string_view)> fn = [&](std::string_view k, std::string_view v) {
+        out.append(k).append("=").append(v).append(";");
+    };
+    st.enum_vars("", "\xFF", fn);
+    return out;
+}
+
+static void test_snapshot() {
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_wal_snapshot.log").string();
+    auto remove_all = [&]{
+        for (const char *ext: {"", ".idx", ".snap"}) std::filesystem::remove(pathname + ext);
+    };
+    remove_all();
+    std::string expected;
+    {
+        WalStorage st(pathname, {.snapshot_interval = 10});
+        for (int i = 0; i < 25; ++i) {
+            st.begin_transaction();
+            st.put_var("var" + std::to_string(i % 7), std::to_string(i));
+            st.put_fill(make_fill(i));
+            st.put_order(make_order("o" + std::to_string(i), Order::State::active));
+            if (i > 2) st.put_order(make_order("o" + std::to_string(i - 3), Order::State::filled));
+            st.commit();
+        }
+        //periodic snapshots are written by the sync thread, pending snapshot
+        //can be replaced by a newer one before it is written
+        st.flush();
+        CHECK_BETWEEN(1U, st.get_stats().snapshots, 2U);
+        expected = dump_vars(st);
+    }
+    //loaded from snapshot, last 5 transactions are replayed
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().recovered, 25U);
+        CHECK_EQUAL(st.get_stats().from_snapshot, 20U);
+        CHECK_EQUAL(dump_vars(st), expected);
+        CHECK_EQUAL(st.load_fills(std::size_t(100), {}).size(), 25U);
+        CHECK_EQUAL(st.load_open_orders().size(), 3U);
+        CHECK(st.is_duplicate_fill(make_fill(3)));
+        st.put_var("after", "snapshot");
+        st.snapshot();
+        CHECK_EQUAL(st.get_stats().snapshots, 1U);
+        expected = dump_vars(st);
+    }
+    //lost index is rebuilt without replaying transactions in the snapshot
+    std::filesystem::remove(pathname + ".idx");
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().from_snapshot, 26U);
+        CHECK_EQUAL(st.get_transaction_count(), 26U);
+        CHECK_EQUAL(st.get_transaction_offset(25), std::filesystem::file_size(pathname));
+        CHECK_EQUAL(dump_vars(st), expected);
+    }
+    //damaged snapshot is ignored
+    {
+        std::fstream f(pathname + ".snap", std::ios::in|std::ios::out|std::ios::binary);
+        f.seekp(-1, std::ios::end);
+        f.put('\x55');
+    }
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().from_snapshot, 0U);
+        CHECK_EQUAL(st.get_stats().recovered, 26U);
+        CHECK_EQUAL(dump_vars(st), expected);
+    }
+    remove_all();
+}
+
+static void test_snapshot_fills() {
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_wal_snapshot_fills.log").string();
+    auto remove_all = [&]{
+        for (const char *ext: {"", ".idx", ".snap"}) std::filesystem::remove(pathname + ext);
+    };
+    remove_all();
+    WalStorage::Config cfg = {.fill_window = std::chrono::seconds(5), .snapshot_interval = 10};
+    {
+        WalStorage st(pathname, cfg);
+        for (int i = 0; i < 25; ++i) {
+            st.put_fill(make_fill(i));
+        }
+        st.flush();
+        CHECK_BETWEEN(1U, st.get_stats().snapshots, 2U);
+        CHECK_EQUAL(st.get_stats().snapshot_errors, 0U);
+    }
+    //snapshot contains fills outside of the fill window
+    {
+        WalStorage st(pathname, cfg);
+        CHECK_EQUAL(st.get_stats().from_snapshot, 20U);
+        auto fills = st.load_fills(std::size_t(100), {});
+        CHECK_EQUAL(fills.size(), 25U);
+        CHECK_EQUAL(fills.back().id, "fill0");
+        CHECK(st.is_duplicate_fill(make_fill(0)));
+        CHECK(st.is_duplicate_fill(make_fill(20)));
+        CHECK(!st.is_duplicate_fill(make_fill(3000)));
+        //more fills than a single chunk of serialized fills
+        for (int i = 25; i < 3000; ++i) {
+            st.put_fill(make_fill(i));
+        }
+        st.flush();
+        CHECK_EQUAL(st.get_stats().snapshot_errors, 0U);
+    }
+    {
+        WalStorage st(pathname, cfg);
+        CHECK_EQUAL(st.get_stats().from_snapshot, 3000U);
+        auto fills = st.load_fills(std::size_t(5000), {});
+        CHECK_EQUAL(fills.size(), 3000U);
+        bool ok = true;
+        for (int i = 0; i < 3000; ++i) {
+            const Fill &f = fills[static_cast<std::size_t>(2999 - i)];
+            ok = ok && f.id == make_fill(i).id && f.price == make_fill(i).price;
+        }
+        CHECK(ok);
+    }
+    remove_all();
+}
+
+int main() {
+    test_snapshot();
+    test_snapshot_fills();
+
+    auto pathname = (std::filesystem::temp_directory_path() / "tests_wal_storage.log").string();
+    auto idxname = pathname + ".idx";
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(idxname);
+
+    {
+        WalStorage st(pathname);
+        for (int i = 0; i < 10; ++i) {
+            st.begin_transaction();
+            st.put_var("var" + std::to_string(i), std::to_string(i));
+            st.put_fill(make_fill(i));
+            st.put_order(make_order("o" + std::to_string(i), Order::State::active));
+            if (i & 1) st.put_order(make_order("o" + std::to_string(i-1), Order::State::filled));
+            st.commit();
+        }
+        //rolled back transaction is not written
+        st.begin_transaction();
+        st.put_var("rolled_back", "x");
+        st.rollback();
+        //write outside of transaction
+        st.erase_var("var0");
+        CHECK_EQUAL(st.get_transaction_count(), 11U);
+        CHECK_EQUAL(st.get_stats().transactions, 11U);
+    }
+
+    std::uint64_t last_frame;
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().recovered, 11U);
+        CHECK_EQUAL(st.get_stats().discarded_bytes, 0U);
+        CHECK_EQUAL(count_vars(st), 9U);
+        CHECK_EQUAL(st.load_fills(std::size_t(100), {}).size(), 10U);
+        CHECK_EQUAL(st.load_open_orders().size(), 5U);
+        last_frame = st.get_transaction_offset(9);
+        CHECK_EQUAL(st.get_transaction_offset(10), std::filesystem::file_size(pathname));
+    }
+
+    //crash during write of the last frame
+    std::filesystem::resize_file(pathname, std::filesystem::file_size(pathname) - 3);
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().recovered, 10U);
+        CHECK_GREATER(st.get_stats().discarded_bytes, 0U);
+        CHECK_EQUAL(std::filesystem::file_size(pathname), last_frame);
+        CHECK_EQUAL(count_vars(st), 10U);
+        //log continues after recovery
+        st.put_var("after", "crash");
+    }
+
+    //damaged content of the last frame and garbage at the end
+    {
+        std::fstream f(pathname, std::ios::in|std::ios::out|std::ios::binary);
+        f.seekp(-2, std::ios::end);
+        f.put('\x55');
+        f.seekp(0, std::ios::end);
+        f.write("garbage garbage garbage", 23);
+    }
+    {
+        WalStorage st(pathname);
+        CHECK_EQUAL(st.get_stats().recovered, 10U);
+        CHECK_EQUAL(count_vars(st), 10U);
+    }
+
+    //lost index is rebuilt
+    std::filesystem::remove(idxname);
+    {
+        WalStorage st(pathname, {.sync_delay = std::chrono::microseconds(100), .sync_commit = true});
+        CHECK_EQUAL(st.get_transaction_count(), 10U);
+        CHECK_EQUAL(st.get_transaction_offset(9), last_frame);
+        st.put_var("durable", "1");
+        CHECK_GREATER(st.get_stats().syncs, 0U);
+    }
+
+    //not a log
+    {
+        std::ofstream f(pathname, std::ios::trunc);
+        f << "this is not a log file";
+    }
+    CHECK_EXCEPTION(std::runtime_error, WalStorage st(pathname));
+
+    std::filesystem::remove(pathname);
+    std::filesystem::remove(idxname);
+}
@@ -21,7 +21,7 @@ inline Side reverse(Side side) {
 
 class Instrument;
 
-class IAccount {
+class IAccount: public DenseIndex<IAccount> {
 public:
     struct Info {
         double equity = 0;
@@ -64,7 +64,7 @@ public:
         operator T () const {
             if (ref == nullptr) return T();
             return std::visit([&](const auto &x){
-                if constexpr(std::is_constructible_v<decltype(x), T>) {
+                if constexpr(std::is_constructible_v<T, decltype(x)>) {
                     return T(x);
                 } else {
                     return T();
@@ -76,7 +76,7 @@ public:
         T operator()(const T &defval) const {
             if (ref == nullptr) return defval;
             return std::visit([&](const auto &x){
-                if constexpr(std::is_constructible_v<decltype(x), T>) {
+                if constexpr(std::is_constructible_v<T, decltype(x)>) {
                     return T(x);
                 } else {
                     return defval;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace trading_api {
+
+///Assigns small dense integer to an object
+/**
+ * Every object gets unique index from process-wide counter of given type,
+ * so tables can be implemented as arrays indexed by this index instead of
+ * trees keyed by pointers. The index is assigned on first request (objects
+ * can be constructed in constant expression). Indexes are never reused,
+ * so the table doesn't need to handle stale entries.
+ *
+ * Index 0 is reserved for null object (see Wrapper::get_index())
+ *
+ * @tparam Tag type which defines the counter
+ */
+template<typename Tag>
+class DenseIndex {
+public:
+
+    constexpr DenseIndex() = default;
+    ///copy of the object is a different object, so it gets own index
+    constexpr DenseIndex(const DenseIndex &) {}
+    constexpr DenseIndex &operator=(const DenseIndex &) {return *this;}
+
+    ///Retrieve index of the object
+    std::uint32_t get_dense_index() const {
+        auto idx = _index.load(std::memory_order_relaxed);
+        if (idx) return idx;
+        auto new_idx = _counter.fetch_add(1, std::memory_order_relaxed);
+        if (_index.compare_exchange_strong(idx, new_idx, std::memory_order_relaxed)) return new_idx;
+        return idx;
+    }
+
+protected:
+    mutable std::atomic<std::uint32_t> _index = 0;
+    static inline std::atomic<std::uint32_t> _counter = 1;
+};
+
+}
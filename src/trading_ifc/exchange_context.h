@@ -3,6 +3,9 @@
 #include "config.h"
 #include "order.h"
 #include "fill.h"
+#include "orderbook.h"
+
+#include <span>
 
 namespace trading_api {
 
@@ -27,6 +30,17 @@ public:
      * @param o orderbook
      */
     virtual void income_data(const Instrument &i, const OrderBook &o) = 0;
+    ///call this function when orderbook changes arrived
+    /**
+     * The context owns the orderbook and applies updates in place, so the
+     * exchange doesn't need to maintain a copy of the orderbook.
+     *
+     * @param i instrument
+     * @param updates list of updates. Update with zero amount removes the level
+     * @param snapshot set true if updates contain whole orderbook. Current
+     * content of the orderbook is discarded before updates are applied
+     */
+    virtual void income_data(const Instrument &i, std::span<const OrderBook::Update> updates, bool snapshot) = 0;
     ///call this function when account is updated
     virtual void object_updated(const Account &i) = 0;
     ///call this function when instrument is updated
@@ -55,6 +69,25 @@ public:
      * @param order restored order instance
      */
     virtual void order_restore(void *context, const Order &order) = 0;
+    ///call this function when exchange assigned ID to the order
+    /**
+     * Allows to find the order by the ID, when the exchange reports only ID
+     *
+     * @param order order instance
+     * @param id exchange's order ID
+     */
+    virtual void bind_order_id(const Order &order, std::string_view id) = 0;
+    ///find order by exchange's order ID
+    /**
+     * @param id order ID bound by bind_order_id()
+     * @return order instance, or null order if not found (or already finished)
+     */
+    virtual Order find_order(std::string_view id) const = 0;
+    ///retrieve exchange object which represents this exchange
+    /**
+     * @return exchange object. Use it to create instruments and accounts
+     */
+    virtual Exchange get_exchange() const = 0;
 
     class Null;
 
@@ -67,9 +100,13 @@ public:
     virtual void order_restore(void *, const Order &) override{throw_error();}
     virtual void order_fill(const Order &, const Fill &) override{throw_error();}
     virtual void income_data(const Instrument &, const OrderBook &) override{throw_error();}
+    virtual void income_data(const Instrument &, std::span<const OrderBook::Update>, bool) override{throw_error();}
     virtual void object_updated(const Account &) override{throw_error();}
     virtual void object_updated(const Instrument &) override{throw_error();}
     virtual void income_data(const Instrument &, const Ticker &) override{throw_error();}
+    virtual void bind_order_id(const Order &, std::string_view) override{throw_error();}
+    virtual Order find_order(std::string_view) const override{throw_error();}
+    virtual Exchange get_exchange() const override{throw_error();}
 };
 
 class ExchangeContext {
@@ -100,6 +137,15 @@ public:
     void income_data(const Instrument &i, const OrderBook &o) {
         _ptr->income_data(i, o);
     }
+    ///call this function when orderbook changes arrived
+    /**
+     * @param i instrument
+     * @param updates list of updates. Update with zero amount removes the level
+     * @param snapshot set true if updates contain whole orderbook
+     */
+    void income_data(const Instrument &i, std::span<const OrderBook::Update> updates, bool snapshot = false) {
+        _ptr->income_data(i, updates, snapshot);
+    }
     ///call this function when account is updated
     void object_updated(const Account &a) {
         _ptr->object_updated(a);
@@ -143,6 +189,31 @@ public:
     void order_restore(void *context, const Order &order) {
         return _ptr->order_restore(context, order);
     }
+    ///call this function when exchange assigned ID to the order
+    /**
+     * Allows to find the order by the ID, when the exchange reports only ID
+     *
+     * @param order order instance
+     * @param id exchange's order ID
+     */
+    void bind_order_id(const Order &order, std::string_view id) {
+        _ptr->bind_order_id(order, id);
+    }
+    ///find order by exchange's order ID
+    /**
+     * @param id order ID bound by bind_order_id()
+     * @return order instance, or null order if not found (or already finished)
+     */
+    Order find_order(std::string_view id) const {
+        return _ptr->find_order(id);
+    }
+    ///retrieve exchange object which represents this exchange
+    /**
+     * @return exchange object. Use it to create instruments and accounts
+     */
+    Exchange get_exchange() const {
+        return _ptr->get_exchange();
+    }
 
 protected:
     IExchangeContext *_ptr;
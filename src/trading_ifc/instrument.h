@@ -3,6 +3,8 @@
 #include <cmath>
 #include "position.h"
 #include "exchange.h"
+#include "dense_index.h"
+#include "timer.h"
 
 namespace trading_api {
 
@@ -12,9 +14,29 @@ enum class SubscriptionType {
     orderbook,
 };
 
+///Specifies how often are events of a subscription delivered to the strategy
+struct SubscriptionPolicy {
+
+    enum class Mode {
+        ///every update generates event
+        every,
+        ///latest value - no event is generated until the strategy processes the previous one
+        conflate,
+        ///at most one event per interval. If updates arrive during the
+        ///interval, one event is generated at the end of the interval
+        throttle,
+        ///event is generated only when best bid or ask (price or volume) changes
+        top_of_book
+    };
+
+    Mode mode = Mode::every;
+    ///interval for throttle mode
+    TimeSpan interval = {};
+};
+
 
 
-class IInstrument {
+class IInstrument: public DenseIndex<IInstrument> {
 public:
 
 
@@ -2,7 +2,15 @@
 
 #include "wrapper.h"
 #include <iterator>
-#include <bitset>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <new>
+#include <ostream>
+#include <tuple>
+#include <vector>
 
 #include <string_view>
 namespace trading_api {
@@ -24,6 +32,55 @@ public:
     virtual ~ILog() = default;
 
     class Null;
+    class Deferred;
+
+    ///Retrieve interface which accepts unformatted records
+    /**
+     * @return pointer to interface, or nullptr, if the log accepts only
+     * formatted messages (default)
+     */
+    virtual Deferred *get_deferred() {return nullptr;}
+};
+
+///Accepts log records which are formatted later (by other thread)
+/**
+ * The record is written by Log::output. It starts by Header, which is followed
+ * by context, pattern (only if Header::pattern is nullptr) and arguments.
+ * The arguments are decoded and formatted by Header::format. Arguments
+ * written by Log::output start by segments of the parsed pattern, so the
+ * pattern is not parsed again
+ *
+ * @code
+ * | Header | context | pattern | arguments |
+ * @endcode
+ */
+class ILog::Deferred {
+public:
+
+    ///Formats arguments stored in the record
+    using FormatFn = void (*)(std::string_view pattern, const char *args, std::vector<char> &out);
+
+    struct Header {
+        FormatFn format;
+        ///pattern with static storage duration, nullptr if pattern is stored in the record
+        const char *pattern;
+        std::uint32_t pattern_size;
+        std::uint32_t context_size;
+        Serverity level;
+    };
+
+    ///Reserve space for the record
+    /**
+     * @param size size of the record
+     * @return pointer to reserved space, or nullptr, if the record can't be
+     * stored (it is dropped)
+     *
+     * @note every successful reservation must be followed by commit() on the same thread
+     */
+    virtual char *reserve(std::size_t size) = 0;
+    ///Publish reserved record
+    virtual void commit() = 0;
+    virtual ~Deferred() = default;
 };
 
 template<typename T>
@@ -39,6 +96,112 @@ concept is_pair = requires(T x) {
     {x.second};
 };
 
+///Parsed pattern of log line
+/**
+ * Pattern is split to segments. Every segment is a literal text optionally
+ * followed by an argument.
+ *
+ * - {} - next argument
+ * - {N} - N-th argument (first argument is {1}). Following {} skip arguments
+ *   which were already referred by an index
+ * - {{ and }} - literal { and }
+ */
+class LogPattern {
+public:
+
+    static constexpr std::size_t max_segments = 32;
+    static constexpr std::size_t max_pattern_size = 0xFFFF;
+    static constexpr std::uint8_t no_arg = 0xFF;
+
+    struct Segment {
+        ///end of literal text (start is the end of previous segment)
+        std::uint16_t end;
+        ///count of characters skipped after the literal (placeholder)
+        std::uint8_t skip;
+        ///index of argument or no_arg
+        std::uint8_t arg;
+    };
+
+    ///pattern text
+    std::string_view pattern = {};
+    std::array<Segment, max_segments> segments = {};
+    ///count of segments, zero - the pattern is written as it is
+    std::uint8_t count = 0;
+    ///pattern is a constant (has static storage duration)
+    bool is_static = false;
+
+    ///Parse the pattern
+    /**
+     * @param text pattern
+     * @param arg_count count of arguments
+     * @param strict report errors. Otherwise invalid placeholders are
+     * written as literal text and segments over the limit are merged to the
+     * last literal
+     * @return nullptr when pattern is valid, otherwise description of the error
+     */
+    constexpr const char *parse(std::string_view text, std::size_t arg_count, bool strict) {
+        pattern = text;
+        count = 0;
+        if (text.size() > max_pattern_size) {
+            return strict?"log pattern is too long":nullptr;
+        }
+        std::uint64_t used = 0;
+        std::size_t cur = 0;
+        std::size_t pos = 0;
+        auto add = [&](std::size_t end, std::size_t skip, std::size_t arg) {
+            segments[count] = {static_cast<std::uint16_t>(end),
+                    static_cast<std::uint8_t>(skip), static_cast<std::uint8_t>(arg)};
+            ++count;
+        };
+        while (pos < text.size()) {
+            if (count + std::size_t(1) >= max_segments) {
+                if (strict) return "too many placeholders in log pattern";
+                break;
+            }
+            char c = text[pos];
+            if ((c == '{' || c == '}') && pos + 1 < text.size() && text[pos+1] == c) {
+                add(pos+1, 1, no_arg);
+                pos += 2;
+            } else if (c == '{') {
+                std::size_t q = pos + 1;
+                std::size_t index = 0;
+                while (q < text.size() && q - pos < 4 && text[q] >= '0' && text[q] <= '9') {
+                    index = index * 10 + static_cast<std::size_t>(text[q] - '0');
+                    ++q;
+                }
+                if (q >= text.size() || text[q] != '}') {
+                    if (strict) return "invalid placeholder in log pattern";
+                    ++pos;
+                    continue;
+                }
+                if (index == 0) {
+                    ++cur;
+                    while (cur <= 64 && ((used >> (cur-1)) & 1)) ++cur;
+                    index = cur;
+                } else if (index <= 64) {
+                    used |= std::uint64_t(1) << (index-1);
+                }
+                if (index > arg_count) {
+                    if (strict) return "log pattern refers to missing argument";
+                    pos = q + 1;
+                    continue;
+                }
+                add(pos, q + 1 - pos, index - 1);
+                pos = q + 1;
+            } else {
+                ++pos;
+            }
+        }
+        add(text.size(), 0, no_arg);
+        return nullptr;
+    }
+
+    ///called during compile-time parsing when the pattern is invalid (causes compile error)
+    static void invalid_pattern(const char *error) {
+        throw std::invalid_argument(error);
+    }
+};
+
 class Log  {
 public:
 
@@ -70,7 +233,44 @@ public:
 
     using Serverity = ILog::Serverity;
 
-    explicit Log(std::shared_ptr<ILog> ptr):_ptr(std::move(ptr)),_min_level(_ptr->get_min_level()) {}
+    ///Pattern of log line, parsed and checked against arguments at compile time
+    /**
+     * Pattern must be a constant expression. Invalid placeholders and
+     * placeholders which refer to missing arguments are reported as compile errors.
+     * To use pattern which is not known at compile time, use runtime_pattern()
+     */
+    template<typename ... Args>
+    class Pattern: public LogPattern {
+    public:
+        template<typename S>
+        requires(std::is_convertible_v<const S &, std::string_view>)
+        consteval Pattern(const S &text) {
+            const char *err = parse(text, sizeof...(Args), true);
+            if (err) invalid_pattern(err);
+            is_static = true;
+        }
+        Pattern(const LogPattern &runtime) {
+            parse(runtime.pattern, sizeof...(Args), false);
+        }
+    };
+
+    ///Create pattern which is parsed at runtime
+    /**
+     * @param text pattern, must stay valid during the call of the output function
+     * @return pattern, which can be passed to the output function or to the constructor
+     *
+     * Invalid placeholders are written as they are
+     */
+    static LogPattern runtime_pattern(std::string_view text) {
+        LogPattern p;
+        p.pattern = text;
+        return p;
+    }
+
+    explicit Log(std::shared_ptr<ILog> ptr)
+        :_ptr(std::move(ptr))
+        ,_deferred(_ptr->get_deferred())
+        ,_min_level(_ptr->get_min_level()) {}
 
     ///Create new log object with context
     /**
@@ -82,31 +282,44 @@ public:
      *      [context1][context2][context3] log line
      */
     template<typename ... Args>
-    Log(const Log &other, std::string_view pattern, Args && ... args)
+    Log(const Log &other, Pattern<std::type_identity_t<Args>...> pattern, Args && ... args)
         :_ptr(other._ptr)
+        ,_deferred(other._deferred)
         ,_buffer(other._buffer)
         ,_min_level(other._min_level)
     {
-        append_context(pattern, std::forward<Args>(args)...);
+        append_context(pattern, args...);
     }
 
     template<typename ... Args>
-    Log(Log &&other, std::string_view pattern, Args && ... args)
+    Log(Log &&other, Pattern<std::type_identity_t<Args>...> pattern, Args && ... args)
         :_ptr(std::move(other._ptr))
+        ,_deferred(other._deferred)
         ,_buffer(std::move(other._buffer))
         ,_min_level(other._min_level)
     {
-        append_context(pattern, std::forward<Args>(args)...);
+        append_context(pattern, args...);
     }
 
+    ///Output log line
+    /**
+     * @param level severity
+     * @param pattern pattern, {} are replaced by arguments (see LogPattern)
+     * @param args arguments
+     *
+     * If the log supports deferred formatting (ILog::get_deferred), arguments
+     * are copied to the record and formatted by the log later. Strings are copied,
+     * trivially copyable types are copied as bytes (so they must not refer
+     * to data which can change), other types are formatted immediately.
+     */
     template<typename ... Args>
-    void output(Serverity level, std::string_view pattern, Args && ... args) {
+    void output(Serverity level, Pattern<std::type_identity_t<Args>...> pattern, Args && ... args) {
         if (level >= _min_level) {
-            {
-                vector_streambuf buffer(_buffer);
-                std::ostream os(&buffer);
-                format(os, pattern, std::forward<Args>(args)...);
+            if (_deferred) {
+                output_deferred(level, pattern, args...);
+                return;
             }
+            format(_buffer, pattern, args...);
             _ptr->output(level, {_buffer.data(), _buffer.size()});
             _buffer.resize(_context_size);
         }
@@ -115,89 +328,202 @@ public:
 
 protected:
     std::shared_ptr<ILog> _ptr;
+    ILog::Deferred *_deferred = nullptr;
     std::vector<char> _buffer;
     Serverity _min_level;
     std::size_t _context_size = 0;
 
     template<typename ... Args>
-    void append_context(std::string_view pattern, Args && ... args) {
+    void append_context(const LogPattern &pattern, const Args & ... args) {
         _buffer.push_back('[');
-        {
-            vector_streambuf buffer(_buffer);
-            std::ostream os(&buffer);
-            format(os, pattern, std::forward<Args>(args)...);
-        }
+        format(_buffer, pattern, args...);
         _buffer.push_back(']');
         _context_size = _buffer.size();
     }
 
+    static void append(std::vector<char> &out, std::string_view text) {
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
     template<typename T>
-    void format_item(std::ostream &out, const T &val) {
+    static void format_item(std::vector<char> &out, const T &val) {
         if constexpr(std::is_invocable_v<T>) {
             format_item(out,val());
+        } else if constexpr(std::is_same_v<T, char>) {
+            out.push_back(val);
+        } else if constexpr(std::is_same_v<T, bool>) {
+            out.push_back(val?'1':'0');
+        } else if constexpr(std::is_arithmetic_v<T>) {
+            char buf[64];
+            auto res = std::to_chars(buf, buf + sizeof(buf), val);
+            out.insert(out.end(), buf, res.ptr);
+        } else if constexpr(std::is_convertible_v<const T &, std::string_view>) {
+            append(out, std::string_view(val));
         } else if constexpr(is_container<T>) {
-            out << '(';
+            out.push_back('(');
             auto beg = val.begin();
             auto end = val.end();
             if (beg != end) {
                 format_item(out,*beg);
                 ++beg;
                 while (beg != end) {
-                    out << ',';
+                    out.push_back(',');
                     format_item(out,*beg);
                     ++beg;
                 }
             }
-            out << ')';
+            out.push_back(')');
         } else if constexpr(is_pair<T>) {
-            _buffer.push_back('<');
-            format_item(val.first);
-            _buffer.push_back(':');
-            format_item(val.second);
-            _buffer.push_back('>');
+            out.push_back('<');
+            format_item(out,val.first);
+            out.push_back(':');
+            format_item(out,val.second);
+            out.push_back('>');
         } else {
-            out << val;
+            vector_streambuf buffer(out);
+            std::ostream os(&buffer);
+            os << val;
         }
     }
 
     template<typename ... Args>
-    void format(std::ostream &out, std::string_view pattern, Args && ... args) {
-        std::bitset<64> mask={};
-        auto iter = pattern.begin();
-        auto end = pattern.end();
-        unsigned int cur_index = 0;
-        while (iter != end) {
-            if (*iter == '{') {
-                unsigned int index = 0;
-                ++iter;
-                while (iter != end && *iter >='0' && *iter <='9') {
-                    index = index * 10 +  (*iter-'0');
-                }
-                if (index == 0) {
-                    ++cur_index;
-                    while (cur_index < mask.size() && mask[cur_index-1]) ++cur_index;
-                    index = cur_index;
-                } else {
-                    mask.set(index-1);
-                }
-                format_nth_item(index-1, out, std::forward<Args>(args)...);
-            } else {
-                out.put(*iter);
-                ++iter;
-            }
+    static void format(std::vector<char> &out, const LogPattern &pattern, const Args & ... args) {
+        if (pattern.count == 0) {
+            append(out, pattern.pattern);
+            return;
         }
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < pattern.count; ++i) {
+            const auto &seg = pattern.segments[i];
+            append(out, pattern.pattern.substr(pos, seg.end - pos));
+            if (seg.arg != LogPattern::no_arg) format_nth_item(seg.arg, out, args...);
+            pos = seg.end + seg.skip;
+        }
+    }
+
+    template<typename ... Args>
+    static void format_nth_item(unsigned int index, std::vector<char> &out, const Args & ... args) {
+        unsigned int i = 0;
+        ((i++ == index?format_item(out, args):void()),...);
+    }
+
+    enum class DeferredKind {
+        ///copied as string
+        string,
+        ///copied as bytes
+        raw,
+        ///formatted immediately, copied as string
+        text
+    };
+
+    template<typename T>
+    static constexpr DeferredKind deferred_kind() {
+        if constexpr(std::is_convertible_v<const T &, std::string_view>) return DeferredKind::string;
+        else if constexpr(std::is_invocable_v<T> || is_container<T> || is_pair<T>) return DeferredKind::text;
+        else if constexpr(std::is_trivially_copyable_v<T>) return DeferredKind::raw;
+        else return DeferredKind::text;
     }
 
-    template<typename T, typename ... Args>
-    void format_nth_item(unsigned int index, std::ostream &out, T && val, Args && ... args) {
-        if (index) {
-            format_nth_item(index-1, out, std::forward<Args>(args)...);
+    ///type of argument stored in the record
+    template<typename T>
+    using DeferredType = std::conditional_t<deferred_kind<T>() == DeferredKind::raw, T, std::string_view>;
+
+    template<typename T>
+    static auto prepare_deferred(const T &val) {
+        constexpr auto kind = deferred_kind<std::decay_t<T> >();
+        if constexpr(kind == DeferredKind::string) {
+            return std::string_view(val);
+        } else if constexpr(kind == DeferredKind::raw) {
+            return static_cast<std::decay_t<T> >(val);
+        } else {
+            std::vector<char> buf;
+            format_item(buf, val);
+            return std::string(buf.begin(), buf.end());
+        }
+    }
+
+    template<typename T>
+    static std::size_t deferred_size(const T &val) {
+        if constexpr(std::is_convertible_v<const T &, std::string_view>) {
+            return sizeof(std::uint32_t) + std::string_view(val).size();
         } else {
-            format_item(out, val);
+            return sizeof(T);
         }
     }
-    void format_nth_item(unsigned int index, std::ostream &out) {
-        out << "{" << index << "}";
+
+    template<typename T>
+    static void write_deferred(char *&ptr, const T &val) {
+        if constexpr(std::is_convertible_v<const T &, std::string_view>) {
+            std::string_view s(val);
+            auto sz = static_cast<std::uint32_t>(s.size());
+            std::memcpy(ptr, &sz, sizeof(sz));
+            std::memcpy(ptr + sizeof(sz), s.data(), s.size());
+            ptr += sizeof(sz) + s.size();
+        } else {
+            std::memcpy(ptr, &val, sizeof(T));
+            ptr += sizeof(T);
+        }
+    }
+
+    template<typename T>
+    static T read_deferred(const char *&ptr) {
+        if constexpr(std::is_same_v<T, std::string_view>) {
+            std::uint32_t sz;
+            std::memcpy(&sz, ptr, sizeof(sz));
+            std::string_view s(ptr + sizeof(sz), sz);
+            ptr += sizeof(sz) + sz;
+            return s;
+        } else {
+            alignas(T) char buf[sizeof(T)];
+            std::memcpy(buf, ptr, sizeof(T));
+            ptr += sizeof(T);
+            return *std::launder(reinterpret_cast<const T *>(buf));
+        }
+    }
+
+    template<typename ... Stored>
+    static void format_deferred(std::string_view pattern, const char *args, std::vector<char> &out) {
+        LogPattern p;
+        p.pattern = pattern;
+        p.count = static_cast<std::uint8_t>(*args++);
+        std::memcpy(p.segments.data(), args, p.count * sizeof(LogPattern::Segment));
+        args += p.count * sizeof(LogPattern::Segment);
+        //braced initialization guarantees order of evaluation
+        std::tuple<Stored...> vals{read_deferred<Stored>(args)...};
+        std::apply([&](const auto & ... v){format(out, p, v...);}, vals);
+    }
+
+    template<typename ... Args>
+    void output_deferred(Serverity level, const LogPattern &parsed, const Args & ... args) {
+        using Header = ILog::Deferred::Header;
+        std::string_view pattern = parsed.pattern;
+        bool static_pattern = parsed.is_static;
+        std::tuple<decltype(prepare_deferred(args))...> prepared{prepare_deferred(args)...};
+        std::size_t segments_size = parsed.count * sizeof(LogPattern::Segment);
+        std::size_t size = sizeof(Header) + _context_size + (static_pattern?0:pattern.size())
+                + 1 + segments_size;
+        std::apply([&](const auto & ... v){((size += deferred_size(v)),...);}, prepared);
+        char *ptr = _deferred->reserve(size);
+        if (!ptr) return;
+        Header hdr{&format_deferred<DeferredType<std::decay_t<Args> >...>,
+            static_pattern?pattern.data():nullptr,
+            static_cast<std::uint32_t>(pattern.size()),
+            static_cast<std::uint32_t>(_context_size),
+            level};
+        std::memcpy(ptr, &hdr, sizeof(hdr));
+        ptr += sizeof(hdr);
+        std::memcpy(ptr, _buffer.data(), _context_size);
+        ptr += _context_size;
+        if (!static_pattern) {
+            std::memcpy(ptr, pattern.data(), pattern.size());
+            ptr += pattern.size();
+        }
+        //segments are stored, the pattern is not parsed again by the log thread
+        *ptr++ = static_cast<char>(parsed.count);
+        std::memcpy(ptr, parsed.segments.data(), segments_size);
+        ptr += segments_size;
+        std::apply([&](const auto & ... v){(write_deferred(ptr, v),...);}, prepared);
+        _deferred->commit();
     }
 
 };
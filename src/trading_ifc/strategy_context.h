@@ -148,7 +148,7 @@ public:
     virtual void allocate(const Account &a, double equity) = 0;
 
     ///subscribe market events
-    virtual void subscribe(SubscriptionType type, const Instrument &i) = 0;
+    virtual void subscribe(SubscriptionType type, const Instrument &i, const SubscriptionPolicy &policy) = 0;
 
     ///unsubscribe instrument
     virtual void unsubscribe(SubscriptionType type, const Instrument &i) = 0;
@@ -177,7 +177,7 @@ public:
     virtual void allocate(const Account &, double ) override {throw_error();}
     virtual void set_var(std::string_view , std::string_view ) override{throw_error();};
     virtual void unset_var(std::string_view ) override{throw_error();};
-    virtual void subscribe(SubscriptionType , const Instrument &) override {throw_error();}
+    virtual void subscribe(SubscriptionType , const Instrument &, const SubscriptionPolicy &) override {throw_error();}
     virtual void unsubscribe(SubscriptionType , const Instrument &) override {throw_error();}
     virtual std::string get_var(std::string_view ) const override  {throw_error();}
     virtual void enum_vars(std::string_view ,  Function<void(std::string_view, std::string_view)> &) const override {throw_error();}
@@ -539,27 +539,38 @@ public:
      *
      */
     void subscribe(SubscriptionType type, const Instrument &i) {
-        _ptr->subscribe(type, i, std::chrono::seconds(0));
+        _ptr->subscribe(type, i, {});
     }
 
     ///Subscribe market data
     /**
      * @param type type of subscription (ticker, orderbook)
      * @param i instrument instance
-     * @param interval interval of generating market events. When this value is specified
-     * market events are generated in this specified interval regardless on, whether
-     * there were change in the event. Some exchanges cannot sent market events
-     * as a stream, so each event is actually full query on market state polled in
-     * specified interval. The service provider can adjust this interval to lowest
-     * allowed value (for example, exchanges where price is polled, you probably don't
-     * get interval under 1 minute)
+     * @param policy specifies how often events are generated. Use conflation or
+     * throttling when the strategy cannot process every update
+     *
+     * @note if called multiple times on single instrument, it only adjusts the
+     * policy.
+     */
+    void subscribe(SubscriptionType type, const Instrument &i, const SubscriptionPolicy &policy) {
+        _ptr->subscribe(type, i, policy);
+    }
+
+    ///Subscribe market data
+    /**
+     * @param type type of subscription (ticker, orderbook)
+     * @param i instrument instance
+     * @param interval minimal interval between two market events. Updates
+     * received during the interval are merged into single event, which is
+     * generated at the end of the interval
      *
      * @note if called multiple times on single instrument, it only adjusts the
      * interval.
      */
     template<typename A, typename B>
     void subscribe(SubscriptionType type, const Instrument &i, std::chrono::duration<A,B> interval) {
-        _ptr->subscribe(type, i, std::chrono::duration_cast<TimeSpan>(interval));
+        _ptr->subscribe(type, i, {SubscriptionPolicy::Mode::throttle,
+                        std::chrono::duration_cast<TimeSpan>(interval)});
     }
 
     ///Unsubscribe market data
@@ -1,5 +1,8 @@
 #pragma once
+#include "dense_index.h"
+
 #include <memory>
+#include <type_traits>
 
 namespace trading_api {
 
@@ -21,7 +24,7 @@ public:
     std::strong_ordering operator<=>(const Wrapper<T> &other) const = default;
 
     struct Hasher {
-        auto operator()(const Wrapper &wrp) {
+        auto operator()(const Wrapper &wrp) const {
             std::hash<std::shared_ptr<const T> > hasher;
             return hasher(wrp._ptr);
         }
@@ -29,6 +32,15 @@ public:
 
     auto get_handle() const {return _ptr;}
 
+    ///Retrieve dense index of the object
+    /**
+     * @return small integer unique for the object in the process. Null object
+     * has index 0. Use the index to access tables implemented as arrays
+     */
+    std::uint32_t get_index() const requires(std::is_base_of_v<DenseIndex<T>, T>) {
+        return defined()?_ptr->get_dense_index():0;
+    }
+
     explicit operator bool() const {return _ptr != null_instance_ptr;}
     bool defined() const {return _ptr != null_instance_ptr;}
     bool operator!() const {return _ptr == null_instance_ptr;}